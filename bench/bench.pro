@@ -0,0 +1,7 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    framerbench
+
+# Need openpty()
+linux: SUBDIRS += ptybench pipelinebench
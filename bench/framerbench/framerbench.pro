@@ -0,0 +1,15 @@
+TEMPLATE = app
+TARGET = framerbench
+
+QT = core
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../../src
+
+SOURCES += \
+    main.cpp \
+    ../../src/eomframer.cpp
+
+HEADERS += \
+    ../../src/eomframer.h
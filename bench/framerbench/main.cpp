@@ -0,0 +1,248 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+// Throughput of EOM framing: EomFramer against the QString/indexOf loop SimpleTerminal::modifyDspText() used before.
+// Frame ends for overlapping delimiters are checked first, whole and byte by byte; exits non-zero if any are wrong.
+
+#include "eomframer.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QByteArray>
+#include <QString>
+#include <QList>
+#include <QVector>
+
+//**********************************************************************************************************************
+// Former READ_MESSAGE framing, with the display signals replaced by counters
+class LegacyFramer
+{
+public:
+    explicit LegacyFramer(const QString &eom) : _eom(eom), _prevMsg(""), _frames(0), _chars(0) {}
+
+    void process(const QByteArray &data)
+    {
+        QString msg(QString(data).toHtmlEscaped());
+
+        int start_pos = 0;
+        int eom_pos = 0;
+        do
+        {
+            QString shared_msg(_prevMsg + msg);
+            eom_pos = shared_msg.indexOf(_eom, start_pos);
+            if (eom_pos >= 0)
+            {
+                if (eom_pos < _prevMsg.length())
+                    start_pos += _prevMsg.length();
+
+                int len = (eom_pos + _eom.length()) - start_pos;
+                _chars += shared_msg.mid(start_pos, len).length();
+                ++_frames;
+
+                start_pos = eom_pos + _eom.length();
+            }
+            else if (start_pos < shared_msg.length())
+            {
+                _chars += shared_msg.mid(start_pos).length();
+            }
+        } while(eom_pos >= 0);
+
+        if (_eom.length() > 0)
+        {
+            int num_prev_msg_keep = _eom.length() - msg.length();
+            if (num_prev_msg_keep > 0)
+                _prevMsg = _prevMsg.right(num_prev_msg_keep) + msg;
+            else
+                _prevMsg = msg.right(_eom.length() - 1);
+        }
+        else
+            _prevMsg = "";
+    }
+
+    qint64 frames() const { return _frames; }
+
+private:
+    QString _eom;
+    QString _prevMsg;
+    qint64 _frames;
+    qint64 _chars;
+};
+
+//**********************************************************************************************************************
+static QByteArray makeTraffic(int bytes, int lineLen, const QByteArray &eom)
+{
+    QByteArray data;
+    data.reserve(bytes + lineLen + eom.size());
+
+    quint32 seed = 12345;
+    while (data.size() < bytes)
+    {
+        // Vary line length a bit around lineLen
+        seed = seed * 1103515245 + 12345;
+        int len = lineLen / 2 + static_cast<int>((seed >> 16) % static_cast<quint32>(lineLen + 1));
+        for (int i = 0; i < len; ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            data.append(static_cast<char>(' ' + (seed >> 16) % 95));
+        }
+        data.append(eom);
+    }
+
+    return data;
+}
+
+//**********************************************************************************************************************
+static QList<QByteArray> split(const QByteArray &data, int chunkSize)
+{
+    QList<QByteArray> chunks;
+    for (int pos = 0; pos < data.size(); pos += chunkSize)
+        chunks << data.mid(pos, chunkSize);
+
+    return chunks;
+}
+
+//**********************************************************************************************************************
+static double megabytesPerSecond(qint64 bytes, qint64 nsecs)
+{
+    return nsecs > 0 ? (bytes / (1024.0 * 1024.0)) / (nsecs / 1e9) : 0.0;
+}
+
+//**********************************************************************************************************************
+// Frame ends of input scanned in one chunk, and the number found when it is fed one byte at a time
+static bool framesAs(const QList<QByteArray> &delimiters, const QByteArray &input, const QVector<int> &expected)
+{
+    EomFramer whole(delimiters);
+    QVector<int> ends;
+    whole.scan(input, ends);
+
+    EomFramer bytewise(delimiters);
+    QVector<int> byteEnds;
+    int count = 0;
+    for (int i = 0; i < input.size(); ++i)
+        count += bytewise.scan(input.constData() + i, 1, byteEnds);
+
+    return ends == expected && count == expected.size();
+}
+
+//**********************************************************************************************************************
+static int checkOverlaps(QTextStream &out)
+{
+    struct Case
+    {
+        const char *name;
+        QList<QByteArray> delimiters;
+        QByteArray input;
+        QVector<int> ends;
+    };
+
+    const QList<Case> cases = {
+        { "CR|LF|CR+LF", { "\r", "\n", "\r\n" }, "a\r\nb\rc\nd\n\r", { 3, 5, 7, 9 } },
+        { "CR|CR+LF+CR+LF", { "\r", "\r\n\r\n" }, "\r\n\r\nx", { 4 } },
+        { "CR|CR+LF+CR+LF", { "\r", "\r\n\r\n" }, "\r\n\rx", { 1, 3 } },
+        { "CR|CR+LF+CR+LF", { "\r", "\r\n\r\n" }, "\r\n\r\r\n\r\n", { 1, 3, 7 } },
+        { "CR|LF|CR+LF+X", { "\r", "\n", "\r\nX" }, "\r\ny", { 1, 2 } },
+    };
+
+    int failures = 0;
+    foreach (const Case &c, cases)
+    {
+        if (!framesAs(c.delimiters, c.input, c.ends))
+        {
+            out << "FAIL: " << c.name << " frames " << QString::fromLatin1(c.input.toPercentEncoding()) << "\n";
+            ++failures;
+        }
+    }
+
+    return failures;
+}
+
+//**********************************************************************************************************************
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    out.setFieldAlignment(QTextStream::AlignLeft);
+
+    int failures = checkOverlaps(out);
+
+    const int TRAFFIC_BYTES = 8 * 1024 * 1024;
+    const QList<int> chunkSizes = { 16, 256, 4096, 65536 };
+
+    struct Case
+    {
+        const char *name;
+        QByteArray eom;
+        QList<QByteArray> delimiters;
+    };
+
+    const QList<Case> cases = {
+        { "CR", "\r", { "\r" } },
+        { "CR+LF", "\r\n", { "\r\n" } },
+        { "CR|LF|CR+LF", "\r\n", { "\r", "\n", "\r\n" } },
+    };
+
+    out << qSetFieldWidth(14) << "EOM" << "chunk (B)" << "legacy MB/s" << "framer MB/s" << "speedup"
+        << qSetFieldWidth(0) << "\n";
+
+    foreach (const Case &c, cases)
+    {
+        QByteArray traffic = makeTraffic(TRAFFIC_BYTES, 80, c.eom);
+
+        foreach (int chunkSize, chunkSizes)
+        {
+            QList<QByteArray> chunks = split(traffic, chunkSize);
+            QElapsedTimer timer;
+
+            // Legacy only understands a single EOM
+            LegacyFramer legacy(QString::fromLatin1(c.eom));
+            timer.start();
+            foreach (const QByteArray &chunk, chunks)
+                legacy.process(chunk);
+            qint64 legacyNs = timer.nsecsElapsed();
+
+            EomFramer framer(c.delimiters);
+            QVector<int> ends;
+            ends.reserve(chunkSize);
+            qint64 frames = 0;
+            timer.start();
+            foreach (const QByteArray &chunk, chunks)
+                frames += framer.scan(chunk, ends);
+            qint64 framerNs = timer.nsecsElapsed();
+
+            double legacyRate = megabytesPerSecond(traffic.size(), legacyNs);
+            double framerRate = megabytesPerSecond(traffic.size(), framerNs);
+
+            out << qSetFieldWidth(14) << c.name << chunkSize
+                << QString::number(legacyRate, 'f', 1) << QString::number(framerRate, 'f', 1)
+                << QString::number(legacyRate > 0 ? framerRate / legacyRate : 0.0, 'f', 1) + "x"
+                << qSetFieldWidth(0) << "\n";
+
+            if (frames != legacy.frames())
+                out << "  note: frame counts differ (legacy " << legacy.frames() << ", framer " << frames << ")\n";
+        }
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,973 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+// Microbenchmarks of the terminal's framing and command paths, each preceded by a correctness pass:
+//
+//  * modifyDspText(READ_MESSAGE, ...) for several EOMs and chunk sizes; verified with random chunking so EOMs are
+//    split across chunk boundaries
+//  * TextDecoder throughput for ASCII and mixed UTF-8 fed in small chunks, after checks of split characters, control
+//    bytes and invalid input
+//  * CommandParser::processCommand() dispatch, including quoted arguments, and script compilation
+//  * ScrollbackModel::find() over a large scrollback, once the index has caught up, waiting for each answer
+//  * SimpleTerminal write framing with SOM/EOM, through a pseudo-terminal so the transmitted bytes can be checked
+//  * Trigger response time through a pseudo-terminal, with the UI thread blocked the whole time
+//  * Capture log replay at max speed, after checks that the log reads back whole and seeks through its index
+//
+// Exits non-zero if any check fails, so it can gate an optimization of these paths as well as measure it.
+
+#include "simpleterminal.h"
+#include "commandparser.h"
+#include "scrollbackmodel.h"
+#include "textdecoder.h"
+#include "ansiparser.h"
+#include "capturelogger.h"
+#include "capturereader.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QLoggingCategory>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+#include <QThread>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QVector>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#include <cstring>
+
+#include <errno.h>
+#include <poll.h>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+
+//**********************************************************************************************************************
+static int failures = 0;
+
+//**********************************************************************************************************************
+static void check(bool ok, const QString &what)
+{
+    if (!ok)
+    {
+        QTextStream(stdout) << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+//**********************************************************************************************************************
+static quint32 nextRandom(quint32 &seed)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 16;
+}
+
+//**********************************************************************************************************************
+// Printable lines of 1-160 bytes, each ended by the next of eoms in turn. frames gets each line with its EOM.
+static QByteArray makeTraffic(int bytes, const QList<QByteArray> &eoms, quint32 seed, QList<QByteArray> &frames)
+{
+    QByteArray data;
+    data.reserve(bytes + 256);
+    frames.clear();
+
+    while (data.size() < bytes)
+    {
+        QByteArray frame;
+        int len = 1 + static_cast<int>(nextRandom(seed) % 160);
+        for (int i = 0; i < len; ++i)
+            frame.append(static_cast<char>(' ' + nextRandom(seed) % 95));
+
+        frame.append(eoms.at(frames.size() % eoms.size()));
+        data.append(frame);
+        frames << frame;
+    }
+
+    return data;
+}
+
+//**********************************************************************************************************************
+static QList<QString> split(const QByteArray &data, int chunkSize)
+{
+    QList<QString> chunks;
+    for (int pos = 0; pos < data.size(); pos += chunkSize)
+        chunks << QString::fromLatin1(data.mid(pos, chunkSize));
+
+    return chunks;
+}
+
+//**********************************************************************************************************************
+static QList<QString> splitRandomly(const QByteArray &data, int maxChunkSize, quint32 seed)
+{
+    QList<QString> chunks;
+    int pos = 0;
+    while (pos < data.size())
+    {
+        int len = 1 + static_cast<int>(nextRandom(seed) % static_cast<quint32>(maxChunkSize));
+        chunks << QString::fromLatin1(data.mid(pos, len));
+        pos += len;
+    }
+
+    return chunks;
+}
+
+//**********************************************************************************************************************
+static bool sameFrames(const ScrollbackModel &model, ScrollbackModel::FrameType type, const QList<QByteArray> &frames)
+{
+    if (model.rowCount() != frames.size())
+        return false;
+
+    for (int row = 0; row < frames.size(); ++row)
+    {
+        if (model.frameType(row) != type || model.frameData(row) != frames.at(row))
+            return false;
+    }
+
+    return true;
+}
+
+//**********************************************************************************************************************
+static void setRxEom(SimpleTerminal &st, const QList<QByteArray> &eoms)
+{
+    QStringList rxEom;
+    foreach (const QByteArray &eom, eoms)
+    {
+        rxEom << QString::fromLatin1(eom);
+    }
+
+    st.setRxEOM(rxEom);
+}
+
+//**********************************************************************************************************************
+static void benchRead(SimpleTerminal &st, QTextStream &out)
+{
+    const int TRAFFIC_BYTES = 4 * 1024 * 1024;
+    const int VERIFY_BYTES = 64 * 1024;
+    const int VERIFY_ROUNDS = 16;
+    const QList<int> chunkSizes = { 16, 256, 4096 };
+
+    struct Case
+    {
+        const char *name;
+        QList<QByteArray> eoms;
+    };
+
+    const QList<Case> cases = {
+        { "CR", { "\r" } },
+        { "CR+LF", { "\r\n" } },
+        { "CR+LF x2", { "\r\n\r\n" } },
+        { "CR|LF|CR+LF", { "\r", "\n", "\r\n" } },
+    };
+
+    out << "modifyDspText(READ_MESSAGE)\n";
+    out << qSetFieldWidth(14) << "EOM" << "chunk (B)" << "MB/s" << "frames/s" << qSetFieldWidth(0) << "\n";
+
+    foreach (const Case &c, cases)
+    {
+        setRxEom(st, c.eoms);
+
+        QList<QByteArray> frames;
+        for (int round = 0; round < VERIFY_ROUNDS; ++round)
+        {
+            QByteArray traffic = makeTraffic(VERIFY_BYTES, c.eoms, 1000 + round, frames);
+
+            st.clearDisplay();
+            foreach (const QString &chunk, splitRandomly(traffic, 1 + round * 4, 2000 + round))
+                st.modifyDspText(SimpleTerminal::DspType::READ_MESSAGE, chunk);
+            st.flushDisplay();
+
+            check(sameFrames(*st.scrollback(), ScrollbackModel::FrameType::RECEIVED, frames),
+                  QString("%1 framing with random chunks of up to %2 bytes").arg(c.name).arg(1 + round * 4));
+
+            ScrollbackModel &model = *st.scrollback();
+            bool ordered = true;
+            for (int row = 1; row < model.rowCount(); ++row)
+                ordered = ordered && model.frameTimestamp(row) >= model.frameTimestamp(row - 1);
+            check(ordered, QString("%1 frame timestamps never go back").arg(c.name));
+        }
+
+        QByteArray traffic = makeTraffic(TRAFFIC_BYTES, c.eoms, 12345, frames);
+        foreach (int chunkSize, chunkSizes)
+        {
+            QList<QString> chunks = split(traffic, chunkSize);
+
+            st.clearDisplay();
+            QElapsedTimer timer;
+            timer.start();
+            foreach (const QString &chunk, chunks)
+                st.modifyDspText(SimpleTerminal::DspType::READ_MESSAGE, chunk);
+            st.flushDisplay();
+            double secs = timer.nsecsElapsed() / 1e9;
+
+            check(st.scrollback()->rowCount() == frames.size(), QString("%1 frame count").arg(c.name));
+
+            out << qSetFieldWidth(14) << c.name << chunkSize
+                << QString::number(traffic.size() / (1024.0 * 1024.0) / secs, 'f', 1)
+                << QString::number(frames.size() / secs, 'f', 0) << qSetFieldWidth(0) << "\n";
+        }
+    }
+
+    st.setRxEOM();
+    st.clearDisplay();
+}
+
+//**********************************************************************************************************************
+static void benchCommands(SimpleTerminal &st, QTextStream &out)
+{
+    const int ITERATIONS = 20000;
+
+    CommandParser parser(st);
+
+    // Correctness of dispatch and argument handling
+    parser.processCommand("/som >");
+    check(st.getSOM() == ">", "/som sets the SOM");
+    parser.processCommand("/rxeom \\r \\x0a");
+    check(st.getRxEOM() == QStringList({ "\r", "\n" }), "/rxeom unescapes its arguments");
+    parser.processCommand("/flushrate 30");
+    check(st.maxFlushRate() == 30, "/flushrate sets the rate");
+    parser.processCommand("/som  \"> \"");
+    check(st.getSOM() == "> ", "quoted arguments keep their spaces");
+    QStringList tokens;
+    check(CommandParser::tokenize("a  \"b \\\" c\" 'd e' \"\"", tokens) &&
+          tokens == QStringList({ "a", "b \" c", "d e", "" }), "tokenize() handles quotes and empty arguments");
+    check(!CommandParser::tokenize("\"open", tokens), "tokenize() rejects an unterminated quote");
+    QVector<ScriptRunner::Op> ops;
+    QString error;
+    check(ScriptRunner::compile("# login\nconnect\nsend \"root\"\nwait \"/[#$] $/\" 2000\ndelay 10\n", ops, error) &&
+          ops.size() == 4 && ops.at(1).data == "root" && ops.at(2).ms == 2000, "scripts compile to operations");
+    check(!ScriptRunner::compile("send a\nsleep 5\n", ops, error) && error.startsWith("Line 2"),
+          "script errors give the line");
+    st.clearDisplay();
+    parser.processCommand("/nosuchcommand");
+    st.flushDisplay();
+    const ScrollbackModel &model = *st.scrollback();
+    check(model.rowCount() == 2 && model.frameType(1) == ScrollbackModel::FrameType::ERROR &&
+          model.frameData(1).contains("Invalid command"), "unknown commands are rejected");
+
+    const QStringList commands = { "/som >", "/som \"> \"", "/rxeom \\r \\n", "/flushrate 60", "/hex off",
+                                   "/help /som", "/nosuchcommand" };
+
+    out << "\nCommandParser::processCommand()\n";
+    out << qSetFieldWidth(14) << "command" << "ns/call" << qSetFieldWidth(0) << "\n";
+
+    foreach (const QString &cmd, commands)
+    {
+        st.clearDisplay();
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < ITERATIONS; ++i)
+            parser.processCommand(cmd);
+        qint64 ns = timer.nsecsElapsed();
+
+        out << qSetFieldWidth(14) << cmd << ns / ITERATIONS << qSetFieldWidth(0) << "\n";
+    }
+
+    st.setSOM();
+    st.setRxEOM();
+    st.setMaxFlushRate(DisplayBatcher::DEFAULT_MAX_FLUSH_RATE);
+    st.clearDisplay();
+}
+
+//**********************************************************************************************************************
+static void benchDecode(QTextStream &out)
+{
+    const int BYTES = 4 * 1024 * 1024;
+    const int CHUNK = 61; // Odd size so multi-byte characters straddle chunks
+    const int ITERATIONS = 10;
+
+    // Correctness: partial sequences, invalid bytes and control bytes
+    const QByteArray text = QByteArray("caf\xc3\xa9 \xe2\x82\xac" "5 \xf0\x9f\x98\x80 <b>&\"");
+    const QString expected = QString::fromUtf8(text);
+    check(TextDecoder::toText(text.constData(), text.size(), TextDecoder::Encoding::UTF8) == expected,
+          "UTF-8 text decodes like QString::fromUtf8()");
+
+    bool sameSplit = true;
+    for (int split = 0; split <= text.size(); ++split)
+    {
+        TextDecoder decoder;
+        QString decoded;
+        decoder.decode(text.constData(), split, decoded);
+        decoder.decode(text.constData() + split, text.size() - split, decoded);
+        decoder.flush(decoded);
+        sameSplit = sameSplit && decoded == expected;
+    }
+    check(sameSplit, "characters split between decode() calls are put back together");
+
+    QString shown = TextDecoder::toText("a\0b\x1b[0m\x7f\tc\r\n", 12, TextDecoder::Encoding::UTF8);
+    check(!shown.contains(QChar(0)) && !shown.contains(QChar(0x1b)) && shown.contains("^@") && shown.contains("^[") &&
+          shown.contains("^?") && shown.contains("\tc\r\n"), "control bytes are shown in caret notation");
+    check(TextDecoder::toText("\xe2\x82x\xff", 4, TextDecoder::Encoding::UTF8) == QString("\ufffdx\ufffd"),
+          "invalid UTF-8 becomes replacement characters");
+    check(TextDecoder::toText("\xe9\x85", 2, TextDecoder::Encoding::LATIN1).startsWith(QChar(0xe9)) &&
+          TextDecoder::toText("\xe9", 1, TextDecoder::Encoding::RAW).contains("\\xE9"),
+          "Latin-1 and raw encodings");
+    check(TextDecoder::wholeLength("ab\xe2\x82", 4) == 2 && TextDecoder::wholeLength("ab\xe2\x82\xac", 5) == 5,
+          "wholeLength() stops before an unfinished character");
+
+    // Timing: pure ASCII (the fast path) against text with a non-ASCII character every few words
+    QByteArray ascii;
+    QByteArray mixed;
+    quint32 seed = 4242;
+    while (ascii.size() < BYTES)
+    {
+        char c = static_cast<char>('a' + nextRandom(seed) % 26);
+        ascii.append(c);
+        mixed.append(nextRandom(seed) % 16 == 0 ? QByteArray("\xc3\xa9") : QByteArray(1, c));
+    }
+
+    out << "\nTextDecoder::decode() in " << CHUNK << " byte chunks\n";
+    out << qSetFieldWidth(14) << "text" << "MB/s" << qSetFieldWidth(0) << "\n";
+
+    const QList<QPair<QString, QByteArray>> inputs = { { "ASCII", ascii }, { "mixed UTF-8", mixed } };
+    for (const QPair<QString, QByteArray> &input : inputs)
+    {
+        const QByteArray &data = input.second;
+        QString result;
+        result.reserve(data.size());
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < ITERATIONS; ++i)
+        {
+            TextDecoder decoder;
+            result.clear();
+            for (int offset = 0; offset < data.size(); offset += CHUNK)
+                decoder.decode(data.constData() + offset, qMin(CHUNK, data.size() - offset), result);
+            decoder.flush(result);
+        }
+        qint64 ns = qMax(timer.nsecsElapsed(), Q_INT64_C(1));
+
+        check(result == QString::fromUtf8(data), input.first + " decodes correctly in chunks");
+        out << qSetFieldWidth(14) << input.first << static_cast<qint64>(1000.0 * data.size() * ITERATIONS / ns)
+            << qSetFieldWidth(0) << "\n";
+    }
+}
+
+//**********************************************************************************************************************
+static bool sameRuns(const QVector<ScrollbackModel::AttrRun> &runs, const QVector<QPair<quint32, quint32>> &expected)
+{
+    if (runs.size() != expected.size())
+        return false;
+
+    for (int i = 0; i < runs.size(); ++i)
+    {
+        if (runs.at(i).offset != expected.at(i).first || runs.at(i).attr != expected.at(i).second)
+            return false;
+    }
+
+    return true;
+}
+
+//**********************************************************************************************************************
+// Each chunk is shown before the next one arrives, so lines redrawn across chunks go through the model
+static void receiveShown(SimpleTerminal &st, const QList<QByteArray> &chunks)
+{
+    st.clearDisplay();
+    foreach (const QByteArray &chunk, chunks)
+    {
+        st.modifyDspText(SimpleTerminal::DspType::READ_MESSAGE, QString::fromLatin1(chunk));
+        st.flushDisplay();
+    }
+}
+
+//**********************************************************************************************************************
+static void benchAnsi(SimpleTerminal &st, QTextStream &out)
+{
+    const int TRAFFIC_BYTES = 4 * 1024 * 1024;
+    const int CHUNK = 256;
+    const quint32 RED = 2; // Palette index + 1
+
+    st.setRxEOM({ "\n" });
+    st.setAnsi(true);
+    const ScrollbackModel &model = *st.scrollback();
+
+    // Correctness: attribute runs, sequences split anywhere, lines redrawn with CR and erase-line
+    receiveShown(st, { "a\x1b[31mred\x1b[0m b\r\n" });
+    check(model.rowCount() == 1 && model.frameData(0) == "ared b\r\n" &&
+          sameRuns(model.frameRuns(0), { { 1, RED }, { 4, 0 } }), "SGR becomes attribute runs");
+
+    const QByteArray line = "a\x1b[31mred\x1b[0m b\r\n";
+    QList<QByteArray> bytes;
+    for (int i = 0; i < line.size(); ++i)
+        bytes << line.mid(i, 1);
+    receiveShown(st, bytes);
+    check(model.rowCount() == 1 && model.frameData(0) == "ared b\r\n" &&
+          sameRuns(model.frameRuns(0), { { 1, RED }, { 4, 0 } }), "sequences split between chunks");
+
+    receiveShown(st, { "50%", "\r75%", "\r\x1b[1m100%\x1b[0m done\n" });
+    check(model.rowCount() == 1 && model.frameData(0) == "100% done\n" &&
+          sameRuns(model.frameRuns(0), { { 0, AnsiParser::BOLD }, { 4, 0 } }), "CR redraws the line");
+
+    // What the output pane draws: text with no markup and the runs over it
+    receiveShown(st, { "a\x1b[31m<red>\x1b[0m\x01\r\n" });
+    QString text;
+    QVector<ScrollbackModel::AttrRun> runs;
+    model.rowText(0, text, runs);
+    check(text == "a<red>^A\r\n" && sameRuns(runs, { { 1, RED }, { 6, 0 } }), "row text and runs without HTML");
+
+    // Command responses: runs in QChars become byte offsets in the frame and go on top of the response colour
+    const quint32 GREEN = 29; // Of command responses
+    QString rsp;
+    QVector<ScrollbackModel::AttrRun> rspRuns;
+    SimpleTerminal::appendStyled(rsp, rspRuns, QString::fromUtf8("caf\xc3\xa9"), AnsiParser::BOLD);
+    SimpleTerminal::appendStyled(rsp, rspRuns, " <b>", 0);
+    st.clearDisplay();
+    st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, rsp, rspRuns);
+    st.flushDisplay();
+    model.rowText(0, text, runs);
+    check(model.frameData(0) == "caf\xc3\xa9 <b>" &&
+          sameRuns(model.frameRuns(0), { { 0, AnsiParser::BOLD }, { 5, 0 } }) && text == rsp &&
+          sameRuns(runs, { { 0, GREEN | AnsiParser::BOLD }, { 4, GREEN } }),
+          "command responses are plain text with runs");
+
+    receiveShown(st, { "abcdef\r\x1b[K", "xy\n", "\x1b]0;title\x07" "ok\n" });
+    check(model.rowCount() == 2 && model.frameData(0) == "xy\n" && model.frameData(1) == "ok\n",
+          "erase-line and OSC strings");
+
+    st.setAnsi(false);
+    receiveShown(st, { "\x1b[1mb\n" });
+    check(model.frameData(0) == "\x1b[1mb\n" && model.frameRuns(0).isEmpty(), "/ansi off keeps sequences");
+    st.setAnsi(true);
+
+    // Timing: coloured log lines (a level tag, then text) against the same text without sequences
+    static const char *const TAGS[] = { "\x1b[32mINFO\x1b[0m ", "\x1b[1;33mWARN\x1b[0m ", "\x1b[1;31mERROR\x1b[0m " };
+    QByteArray coloured;
+    QByteArray plain;
+    quint32 seed = 777;
+    while (coloured.size() < TRAFFIC_BYTES)
+    {
+        QByteArray text;
+        int len = 20 + static_cast<int>(nextRandom(seed) % 100);
+        for (int i = 0; i < len; ++i)
+            text.append(static_cast<char>(' ' + nextRandom(seed) % 95));
+
+        const char *tag = TAGS[nextRandom(seed) % 3];
+        coloured += tag + text + "\r\n";
+        plain += "INFO " + text + "\r\n";
+    }
+
+    out << "\nANSI parsing in " << CHUNK << " byte chunks\n";
+    out << qSetFieldWidth(14) << "text" << "ansi" << "MB/s" << qSetFieldWidth(0) << "\n";
+
+    const QList<QPair<QString, QByteArray>> inputs = { { "coloured", coloured }, { "plain", plain } };
+    for (const QPair<QString, QByteArray> &input : inputs)
+    {
+        foreach (bool ansi, QList<bool>({ true, false }))
+        {
+            QList<QString> chunks = split(input.second, CHUNK);
+            st.setAnsi(ansi);
+            st.clearDisplay();
+
+            QElapsedTimer timer;
+            timer.start();
+            foreach (const QString &chunk, chunks)
+                st.modifyDspText(SimpleTerminal::DspType::READ_MESSAGE, chunk);
+            st.flushDisplay();
+            double secs = timer.nsecsElapsed() / 1e9;
+
+            if (ansi && input.first == "coloured")
+            {
+                bool stripped = true;
+                for (int row = 0; row < model.rowCount(); ++row)
+                    stripped = stripped && !model.frameData(row).contains('\x1b');
+                check(stripped && model.rowCount() > 0, "no escape sequences are left in the frames");
+            }
+
+            out << qSetFieldWidth(14) << input.first << (ansi ? "on" : "off")
+                << QString::number(input.second.size() / (1024.0 * 1024.0) / secs, 'f', 1) << qSetFieldWidth(0)
+                << "\n";
+        }
+    }
+
+    st.setAnsi(true);
+    st.setRxEOM();
+    st.clearDisplay();
+}
+
+//**********************************************************************************************************************
+// ScrollbackModel::find() runs on the index thread; this waits for its answer. False if nothing was found.
+static bool findNow(ScrollbackModel &model, const QByteArray &text, bool backward, int &row, int &offset)
+{
+    QEventLoop loop;
+    bool matched = false;
+    QMetaObject::Connection done = QObject::connect(&model, &ScrollbackModel::found, [&](int r, int o) {
+        matched = r >= 0;
+        if (matched)
+        {
+            row = r;
+            offset = o;
+        }
+        loop.quit();
+    });
+
+    model.find(text, backward, row, offset);
+    loop.exec();
+    QObject::disconnect(done);
+
+    return matched;
+}
+
+//**********************************************************************************************************************
+static void benchFind(SimpleTerminal &st, QTextStream &out)
+{
+    const int TRAFFIC_BYTES = 32 * 1024 * 1024;
+    const int PARTS = 3;
+    const int ITERATIONS = 20;
+
+    // Tabs never occur in the generated traffic, so only the needle lines can match
+    const QByteArray needleLine = "ERROR: \tNeedle\t\n";
+    const QByteArray needle = "\tneedle\t";
+    const QByteArray missing = "\tmissing\t";
+
+    setRxEom(st, { "\n" });
+    st.clearDisplay();
+
+    QList<int> rows;
+    QList<QByteArray> frames;
+    for (int part = 0; part < PARTS; ++part)
+    {
+        QByteArray traffic = makeTraffic(TRAFFIC_BYTES / PARTS, { "\n" }, 3000 + part, frames);
+        traffic.append(needleLine);
+        foreach (const QString &chunk, split(traffic, 4096))
+            st.modifyDspText(SimpleTerminal::DspType::READ_MESSAGE, chunk);
+        st.flushDisplay();
+
+        rows << st.scrollback()->rowCount() - 1;
+    }
+
+    // Let the index thread catch up
+    QThread::msleep(1000);
+
+    const ScrollbackModel &model = *st.scrollback();
+    int row = -1, offset = 0;
+    check(findNow(model, needle, false, row, offset) && row == rows.at(0) && offset == 7, "find ignores case");
+    for (int i = 1; i <= PARTS; ++i)
+    {
+        ++offset;
+        check(findNow(model, needle, false, row, offset) && row == rows.at(i % PARTS), "find continues and wraps");
+    }
+
+    row = -1;
+    check(findNow(model, needle, true, row, offset) && row == rows.at(PARTS - 1), "backward find starts at the end");
+    row = -1;
+    check(!findNow(model, missing, false, row, offset), "missing text is not found");
+
+    // Full chunks are packed; reading one that is no longer held unpacked restores it
+    check(model.residentBytes() < model.bytes(), "full chunks are packed");
+    bool readBack = true;
+    foreach (int r, rows)
+        readBack = readBack && model.frameData(r) == needleLine;
+    check(readBack, "packed chunks read back");
+
+    out << "\nScrollbackModel::find() in " << model.rowCount() << " rows, "
+        << model.bytes() / (1024 * 1024) << " MB, " << model.residentBytes() / (1024 * 1024) << " MB resident ("
+        << QString::number(model.compressionRatio(), 'f', 1) << ":1)\n";
+    out << qSetFieldWidth(14) << "text" << "ms/call" << qSetFieldWidth(0) << "\n";
+
+    const QList<QByteArray> texts = { needle, missing, "a" };
+    foreach (const QByteArray &text, texts)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < ITERATIONS; ++i)
+        {
+            row = -1;
+            findNow(model, text, true, row, offset);
+        }
+        double ms = timer.nsecsElapsed() / 1e6 / ITERATIONS;
+
+        out << qSetFieldWidth(14) << QString::fromLatin1(text.toPercentEncoding()) << QString::number(ms, 'f', 3)
+            << qSetFieldWidth(0) << "\n";
+    }
+
+    st.setRxEOM();
+    st.clearDisplay();
+}
+
+//**********************************************************************************************************************
+static bool waitFor(const std::function<bool()> &done, int msecs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!done())
+    {
+        if (timer.elapsed() > msecs)
+            return false;
+
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+
+    return true;
+}
+
+//**********************************************************************************************************************
+static void benchWrite(SimpleTerminal &st, QTextStream &out)
+{
+    const int MESSAGES = 20000;
+    const int BATCH = 256; // Stay well inside the transmit queue
+
+    int master = -1;
+    int slave = -1;
+    char slaveName[256];
+    struct termios tio;
+    memset(&tio, 0, sizeof(tio));
+    cfmakeraw(&tio);
+    if (openpty(&master, &slave, slaveName, &tio, nullptr) < 0)
+    {
+        check(false, QString("openpty(): %1").arg(strerror(errno)));
+        return;
+    }
+
+    st.setPort(QString::fromLocal8Bit(slaveName));
+    st.connect();
+    if (!waitFor([&]() { return st.isConnected(); }, 5000))
+    {
+        check(false, "connect to " + QString::fromLocal8Bit(slaveName));
+        ::close(slave);
+        ::close(master);
+        return;
+    }
+
+    // Everything the terminal transmits
+    QByteArray received;
+    std::atomic<int> receivedSize(0);
+    std::atomic<bool> stop(false);
+    std::thread reader([&]() {
+        char buffer[65536];
+        while (!stop)
+        {
+            struct pollfd pfd = { master, POLLIN, 0 };
+            if (poll(&pfd, 1, 50) <= 0)
+                continue;
+
+            ssize_t n = ::read(master, buffer, sizeof(buffer));
+            if (n > 0)
+            {
+                received.append(buffer, static_cast<int>(n));
+                receivedSize.store(received.size());
+            }
+        }
+    });
+
+    st.setSOM("<");
+    st.setEOM("\r\n");
+
+    QList<QByteArray> expected;
+    QByteArray expectedBytes;
+    quint32 seed = 777;
+    QStringList messages;
+    for (int i = 0; i < MESSAGES; ++i)
+    {
+        QString msg;
+        int len = 1 + static_cast<int>(nextRandom(seed) % 64);
+        for (int j = 0; j < len; ++j)
+            msg.append(QChar(static_cast<char>('0' + nextRandom(seed) % 75)));
+
+        messages << msg;
+        expected << ("<" + msg + "\r\n").toLatin1();
+        expectedBytes.append(expected.last());
+    }
+
+    st.clearDisplay();
+    qint64 ns = 0;
+    QElapsedTimer timer;
+    for (int i = 0; i < MESSAGES; i += BATCH)
+    {
+        timer.start();
+        for (int j = i; j < qMin(i + BATCH, MESSAGES); ++j)
+            st.parseInput(messages.at(j));
+        ns += timer.nsecsElapsed();
+
+        int want = 0;
+        for (int j = 0; j < qMin(i + BATCH, MESSAGES); ++j)
+            want += expected.at(j).size();
+
+        waitFor([&]() { return receivedSize.load() >= want; }, 5000);
+    }
+    st.flushDisplay();
+
+    stop = true;
+    reader.join();
+
+    check(received == expectedBytes, "transmitted bytes are SOM + message + EOM");
+    check(sameFrames(*st.scrollback(), ScrollbackModel::FrameType::SENT, expected),
+          "sent frames are displayed with SOM and EOM, without errors");
+
+    out << "\nSimpleTerminal write (SOM + message + EOM)\n";
+    out << qSetFieldWidth(14) << "messages" << "ns/call" << qSetFieldWidth(0) << "\n";
+    out << qSetFieldWidth(14) << MESSAGES << ns / MESSAGES << qSetFieldWidth(0) << "\n";
+
+    st.disconnect();
+    waitFor([&]() { return !st.isConnected(); }, 5000);
+    st.setSOM();
+    st.setEOM();
+    st.clearDisplay();
+
+    ::close(slave);
+    ::close(master);
+}
+
+//**********************************************************************************************************************
+static void benchTrigger(SimpleTerminal &st, QTextStream &out)
+{
+    const int ROUNDS = 1000;
+    const QByteArray prompt = "\nHit any key to stop autoboot:  3";
+
+    int master = -1;
+    int slave = -1;
+    char slaveName[256];
+    struct termios tio;
+    memset(&tio, 0, sizeof(tio));
+    cfmakeraw(&tio);
+    if (openpty(&master, &slave, slaveName, &tio, nullptr) < 0)
+    {
+        check(false, QString("openpty(): %1").arg(strerror(errno)));
+        return;
+    }
+
+    st.setRxEOM({ "\n" });
+    st.setPort(QString::fromLocal8Bit(slaveName));
+    st.connect();
+    if (!waitFor([&]() { return st.isConnected(); }, 5000))
+    {
+        check(false, "connect to " + QString::fromLocal8Bit(slaveName));
+        ::close(slave);
+        ::close(master);
+        return;
+    }
+
+    Trigger trigger;
+    trigger.name = "autoboot";
+    trigger.pattern = "stop autoboot";
+    trigger.action = Trigger::Action::SEND;
+    trigger.argument = " ";
+    st.addTrigger(trigger);
+
+    // Let the I/O thread pick up the trigger
+    waitFor([]() { return false; }, 100);
+
+    // The UI thread sits in poll() below, so only the I/O thread can answer
+    QVector<qint64> latencies;
+    int answered = 0;
+    QElapsedTimer timer;
+    for (int i = 0; i < ROUNDS; ++i)
+    {
+        timer.start();
+        if (::write(master, prompt.constData(), static_cast<size_t>(prompt.size())) != prompt.size())
+            break;
+
+        struct pollfd pfd = { master, POLLIN, 0 };
+        char response[16];
+        if (poll(&pfd, 1, 1000) <= 0 || ::read(master, response, sizeof(response)) != 1 || response[0] != ' ')
+            break;
+
+        latencies << timer.nsecsElapsed();
+        ++answered;
+    }
+
+    check(answered == ROUNDS, "trigger answers every prompt");
+
+    check(waitFor([&]() { return st.triggerStats("autoboot").count == answered; }, 5000),
+          "trigger matches are counted");
+
+    if (!latencies.isEmpty())
+    {
+        std::sort(latencies.begin(), latencies.end());
+        out << "\nTrigger response through a pty (UI thread blocked)\n";
+        out << qSetFieldWidth(14) << "rounds" << "p50 (us)" << "p99 (us)" << "max (us)" << qSetFieldWidth(0) << "\n";
+        out << qSetFieldWidth(14) << latencies.size() << latencies.at(latencies.size() / 2) / 1000
+            << latencies.at(latencies.size() * 99 / 100) / 1000 << latencies.last() / 1000 << qSetFieldWidth(0) << "\n";
+    }
+
+    st.removeTrigger("autoboot");
+    st.disconnect();
+    waitFor([&]() { return !st.isConnected(); }, 5000);
+    st.setRxEOM();
+    st.clearDisplay();
+
+    ::close(slave);
+    ::close(master);
+}
+
+//**********************************************************************************************************************
+// A capture log written by CaptureLogger reads back whole through its index, and replays into the same frames
+static void benchReplay(SimpleTerminal &st, QTextStream &out)
+{
+    const int TRAFFIC_BYTES = 3 * 1024 * 1024;
+    const int CHUNK_BYTES = 4096;
+    const QList<QByteArray> eoms = { "\r\n" };
+
+    QTemporaryDir dir;
+    QString fileName = dir.filePath("session.ytl");
+
+    QList<QByteArray> frames;
+    QByteArray traffic = makeTraffic(TRAFFIC_BYTES, eoms, 777, frames);
+
+    CaptureLogger logger;
+    if (!dir.isValid() || !logger.open(fileName))
+    {
+        check(false, "open capture log: " + logger.errorString());
+        return;
+    }
+
+    for (int i = 0; i < traffic.size(); i += CHUNK_BYTES)
+        logger.log(CaptureLogger::Direction::RECEIVED, traffic.mid(i, CHUNK_BYTES));
+    logger.close();
+    check(logger.recordsDropped() == 0, "capture log keeps every record");
+
+    CaptureReader reader;
+    check(reader.open(fileName) && reader.hasStoredIndex() && reader.index().size() >= TRAFFIC_BYTES / (1024 * 1024),
+          "capture log has an index");
+
+    QVector<CaptureReader::Record> records;
+    CaptureReader::Record record;
+    QByteArray readBack;
+    while (reader.next(record))
+    {
+        records << record;
+        readBack += record.data;
+    }
+    check(readBack == traffic, "capture log reads back as written");
+
+    bool seeks = !records.isEmpty();
+    foreach (const CaptureLogger::IndexEntry &entry, reader.index())
+    {
+        auto first = std::find_if(records.constBegin(), records.constEnd(), [&](const CaptureReader::Record &r) {
+            return r.timestamp >= entry.timestamp + 1;
+        });
+        reader.seek(entry.timestamp + 1);
+        bool found = reader.next(record);
+        seeks = seeks && (first == records.constEnd() ? !found : found && record.data == first->data &&
+                                                                  record.timestamp == first->timestamp);
+    }
+    check(seeks, "seek() lands on the first record at or after the time");
+    reader.close();
+
+    setRxEom(st, eoms);
+    st.clearDisplay();
+
+    QElapsedTimer timer;
+    timer.start();
+    bool started = st.startReplay(fileName, 0);
+    bool done = started && waitFor([&]() { return !st.isReplaying(); }, 30000) &&
+                waitFor([&]() { st.flushDisplay(); return st.scrollback()->rowCount() >= frames.size(); }, 30000);
+    double secs = timer.nsecsElapsed() / 1e9;
+
+    check(done && sameFrames(*st.scrollback(), ScrollbackModel::FrameType::RECEIVED, frames),
+          "replay at max speed gives the recorded frames");
+
+    if (done)
+    {
+        out << "\nReplay of a capture log at max speed\n";
+        out << qSetFieldWidth(14) << "records" << "MB/s" << "frames/s" << qSetFieldWidth(0) << "\n";
+        out << qSetFieldWidth(14) << records.size()
+            << QString::number(traffic.size() / (1024.0 * 1024.0) / secs, 'f', 1)
+            << QString::number(frames.size() / secs, 'f', 0) << qSetFieldWidth(0) << "\n";
+    }
+
+    // Transmitted records come out in order with received ones, stamped with the recorded spacing
+    QString mixedName = dir.filePath("mixed.ytl");
+    CaptureLogger mixedLogger;
+    bool logged = mixedLogger.open(mixedName);
+    mixedLogger.log(CaptureLogger::Direction::RECEIVED, "a\r\n");
+    mixedLogger.log(CaptureLogger::Direction::TRANSMITTED, "b");
+    mixedLogger.log(CaptureLogger::Direction::RECEIVED, "c\r\n");
+    mixedLogger.close();
+
+    QVector<qint64> stamps;
+    logged = logged && reader.open(mixedName);
+    while (logged && reader.next(record))
+        stamps << record.timestamp;
+    reader.close();
+
+    // The replay's own summary may come in between; only the data rows count
+    st.clearDisplay();
+    ScrollbackModel &model = *st.scrollback();
+    QVector<int> rows;
+    auto dataRows = [&]() {
+        st.flushDisplay();
+        rows.clear();
+        for (int row = 0; row < model.rowCount(); ++row)
+        {
+            if (model.frameType(row) != ScrollbackModel::FrameType::COMMAND_RSP)
+                rows << row;
+        }
+        return rows.size() >= 3;
+    };
+    done = logged && stamps.size() == 3 && st.startReplay(mixedName, 0) &&
+           waitFor([&]() { return !st.isReplaying(); }, 5000) && waitFor(dataRows, 5000);
+    check(done && rows.size() == 3 && model.frameType(rows.at(0)) == ScrollbackModel::FrameType::RECEIVED &&
+          model.frameType(rows.at(1)) == ScrollbackModel::FrameType::SENT && model.frameData(rows.at(1)) == "b" &&
+          model.frameType(rows.at(2)) == ScrollbackModel::FrameType::RECEIVED &&
+          model.frameTimestamp(rows.at(1)) - model.frameTimestamp(rows.at(0)) == stamps.at(1) - stamps.at(0) &&
+          model.frameTimestamp(rows.at(2)) - model.frameTimestamp(rows.at(0)) == stamps.at(2) - stamps.at(0),
+          "replayed transmitted data stays in order and keeps the recorded timing");
+
+    st.setRxEOM();
+    st.clearDisplay();
+}
+
+//**********************************************************************************************************************
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Keep away from the real application's settings
+    app.setOrganizationName("No Org");
+    app.setOrganizationDomain("noorg.org");
+    app.setApplicationName("yaTerm-pipelinebench");
+
+    // Command tracing would dominate the command timings
+    QLoggingCategory::setFilterRules("default.debug=false");
+
+    QTextStream out(stdout);
+    out.setFieldAlignment(QTextStream::AlignLeft);
+
+    SimpleTerminal terminal;
+    terminal.setMaxScrollbackBytes(ScrollbackModel::DEFAULT_MAX_BYTES);
+    terminal.setSOM();
+    terminal.setEOM();
+    terminal.setRxEOM();
+
+    benchRead(terminal, out);
+    benchDecode(out);
+    benchAnsi(terminal, out);
+    benchCommands(terminal, out);
+    benchFind(terminal, out);
+    benchWrite(terminal, out);
+    benchTrigger(terminal, out);
+    benchReplay(terminal, out);
+
+    out << "\n" << (failures ? QString("%1 check(s) failed").arg(failures) : QString("All checks passed")) << "\n";
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,12 @@
+TEMPLATE = app
+TARGET = pipelinebench
+
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../../src/core.pri)
+
+LIBS += -lutil
+
+SOURCES += \
+    main.cpp
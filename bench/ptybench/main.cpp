@@ -0,0 +1,371 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+// End-to-end receive path over a pseudo-terminal: a generator thread writes lines to the master side while a
+// SimpleTerminal (no QML) reads the slave side. Reports throughput, arrival-to-display latency, CPU time and peak RSS.
+// With --rate the generator holds a steady byte rate, e.g. 1 MB/s, so CPU and RSS of builds can be compared under the
+// same sustained load.
+//
+// Latency is measured per line from just before it is written to the master until its row is inserted into the
+// scrollback model, i.e. until the display would be told about it. It therefore includes display batching; use
+// --flush-rate to see its effect.
+
+#include "simpleterminal.h"
+#include "scrollbackmodel.h"
+#include "tracer.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QTimer>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <cstring>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <sys/resource.h>
+#include <termios.h>
+#include <unistd.h>
+
+//**********************************************************************************************************************
+struct Traffic
+{
+    int lines = 100000;
+    int minLength = 80;
+    int maxLength = 80;
+    QString eomStyle = "crlf";
+    int burst = 1;    // Lines per write()
+    int gapUsecs = 0; // Pause between bursts
+    qint64 bytesPerSec = 0; // Pace to this rate if not 0
+    quint32 seed = 12345;
+};
+
+//**********************************************************************************************************************
+static QList<QByteArray> eomsFor(const QString &style)
+{
+    if (style == "cr")
+        return { "\r" };
+    else if (style == "lf")
+        return { "\n" };
+    else if (style == "crlf")
+        return { "\r\n" };
+    else if (style == "mixed")
+        return { "\r", "\n", "\r\n" };
+
+    return {};
+}
+
+//**********************************************************************************************************************
+// fd is non-blocking so a stalled reader cannot wedge the generator once stop is raised
+static bool writeAll(int fd, const char *data, int len, const std::atomic<bool> &stop)
+{
+    while (len > 0)
+    {
+        if (stop)
+            return false;
+
+        ssize_t n = ::write(fd, data, static_cast<size_t>(len));
+        if (n < 0)
+        {
+            if (errno == EAGAIN)
+            {
+                struct pollfd pfd = { fd, POLLOUT, 0 };
+                poll(&pfd, 1, 100);
+                continue;
+            }
+            else if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        data += n;
+        len -= static_cast<int>(n);
+    }
+
+    return true;
+}
+
+//**********************************************************************************************************************
+static qint64 cpuTimeNs(const struct rusage &usage)
+{
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * Q_INT64_C(1000000000) +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * Q_INT64_C(1000);
+}
+
+//**********************************************************************************************************************
+// Writes traffic.lines lines and one sentinel line; the sentinel's row showing up means every line before it has been
+// read and framed. writeTimes[i] is the monotonic time line i was handed to the kernel. cpuNs gets the CPU time of the
+// generator itself, so it can be left out of the terminal's.
+static void generate(int fd, const Traffic &traffic, std::atomic<qint64> *writeTimes, std::atomic<qint64> &bytesWritten,
+                     const std::atomic<bool> &stop, std::atomic<qint64> &cpuNs)
+{
+    const QList<QByteArray> eoms = eomsFor(traffic.eomStyle);
+    quint32 seed = traffic.seed;
+    qint64 start = Tracer::now();
+
+    QByteArray buffer;
+    int line = 0;
+    while (line <= traffic.lines)
+    {
+        buffer.clear();
+        int first = line;
+        for (int i = 0; i < traffic.burst && line <= traffic.lines; ++i, ++line)
+        {
+            seed = seed * 1103515245 + 12345;
+            int span = traffic.maxLength - traffic.minLength + 1;
+            int len = traffic.minLength + static_cast<int>((seed >> 16) % static_cast<quint32>(span));
+            if (line == traffic.lines)
+                len = 3; // Sentinel
+
+            for (int j = 0; j < len; ++j)
+                buffer.append(static_cast<char>('!' + (line + j) % 94));
+
+            buffer.append(eoms.at(line % eoms.size()));
+        }
+
+        qint64 now = Tracer::now();
+        for (int i = first; i < line; ++i)
+            writeTimes[i].store(now, std::memory_order_relaxed);
+
+        if (!writeAll(fd, buffer.constData(), buffer.size(), stop))
+            break;
+
+        bytesWritten += buffer.size();
+
+        if (traffic.gapUsecs > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(traffic.gapUsecs));
+
+        // Wait until the bytes written so far are due at the rate
+        if (traffic.bytesPerSec > 0)
+        {
+            qint64 dueNs = start + bytesWritten * Q_INT64_C(1000000000) / traffic.bytesPerSec;
+            qint64 waitNs = dueNs - Tracer::now();
+            if (waitNs > 0)
+                std::this_thread::sleep_for(std::chrono::nanoseconds(waitNs));
+        }
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    cpuNs = cpuTimeNs(usage);
+}
+
+//**********************************************************************************************************************
+static qint64 percentile(const std::vector<qint64> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+
+    size_t idx = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+//**********************************************************************************************************************
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Keep away from the real application's settings
+    app.setOrganizationName("No Org");
+    app.setOrganizationDomain("noorg.org");
+    app.setApplicationName("yaTerm-ptybench");
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless serial receive path benchmark over a pseudo-terminal");
+    parser.addHelpOption();
+    parser.addOptions({
+        { "lines", "Number of lines to send.", "count", "100000" },
+        { "length", "Line length in bytes, without EOM; min-max picks a random length per line.", "min[-max]", "80" },
+        { "eom", "EOM style: cr, lf, crlf or mixed (cycles through all three).", "style", "crlf" },
+        { "burst", "Lines per write.", "count", "1" },
+        { "gap", "Pause between writes in microseconds.", "usecs", "0" },
+        { "rate", "Hold the generator to this many bytes per second; 0 for as fast as possible.", "bytes/s", "0" },
+        { "flush-rate", "Display flush rate limit per second.", "rate", QString::number(DisplayBatcher::DEFAULT_MAX_FLUSH_RATE) },
+        { "timeout", "Give up after this many seconds.", "secs", "120" },
+    });
+    parser.process(app);
+
+    Traffic traffic;
+    traffic.lines = qMax(1, parser.value("lines").toInt());
+    QStringList length = parser.value("length").split('-');
+    traffic.minLength = qMax(1, length.value(0).toInt()); // An empty line would merge CR and LF into CR+LF
+    traffic.maxLength = qMax(traffic.minLength, length.value(1, length.value(0)).toInt());
+    traffic.eomStyle = parser.value("eom");
+    traffic.burst = qMax(1, parser.value("burst").toInt());
+    traffic.gapUsecs = qMax(0, parser.value("gap").toInt());
+    traffic.bytesPerSec = qMax(Q_INT64_C(0), parser.value("rate").toLongLong());
+
+    const QList<QByteArray> eoms = eomsFor(traffic.eomStyle);
+    if (eoms.isEmpty())
+    {
+        err << "Unknown EOM style " << traffic.eomStyle << "\n";
+        return 1;
+    }
+
+    // Longer lines would be split into several rows by SimpleTerminal and throw off the row accounting
+    if (traffic.maxLength + 2 > 4096)
+    {
+        err << "Line length must be at most 4094 bytes\n";
+        return 1;
+    }
+
+    // Raw mode so the line discipline passes bytes through untouched
+    int master = -1;
+    int slave = -1;
+    char slaveName[256];
+    struct termios tio;
+    memset(&tio, 0, sizeof(tio));
+    cfmakeraw(&tio);
+    if (openpty(&master, &slave, slaveName, &tio, nullptr) < 0)
+    {
+        err << "openpty() failed: " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    SimpleTerminal terminal;
+    terminal.setMaxFlushRate(parser.value("flush-rate").toInt());
+    terminal.setMaxScrollbackBytes(ScrollbackModel::DEFAULT_MAX_BYTES);
+    terminal.setSOM();
+    terminal.setEOM(QString::fromLatin1(eoms.last()));
+    QStringList rxEom;
+    foreach (const QByteArray &eom, eoms)
+    {
+        rxEom << QString::fromLatin1(eom);
+    }
+    terminal.setRxEOM(eoms.size() > 1 ? rxEom : QStringList());
+    terminal.setPort(QString::fromLocal8Bit(slaveName));
+
+    std::unique_ptr<std::atomic<qint64>[]> writeTimes(new std::atomic<qint64>[traffic.lines + 1]);
+    std::atomic<qint64> bytesWritten(0);
+    std::atomic<bool> stop(false);
+    std::atomic<qint64> generatorCpuNs(0);
+    std::vector<qint64> latencies;
+    latencies.reserve(static_cast<size_t>(traffic.lines));
+
+    std::thread generator;
+    qint64 startTime = 0;
+    qint64 endTime = 0;
+    int rowsSeen = 0;
+    bool generating = false;
+
+    QObject::connect(&terminal, &SimpleTerminal::connStateChanged, [&]() {
+        if (!terminal.isConnected() || generating)
+            return;
+
+        generating = true;
+        startTime = Tracer::now();
+        generator = std::thread(generate, master, std::cref(traffic), writeTimes.get(), std::ref(bytesWritten),
+                                std::cref(stop), std::ref(generatorCpuNs));
+    });
+
+    QObject::connect(terminal.scrollback(), &ScrollbackModel::rowsInserted,
+                     [&](const QModelIndex &, int first, int last) {
+        if (!generating)
+        {
+            // E.g. the port failed to open
+            for (int row = first; row <= last; ++row)
+            {
+                if (terminal.scrollback()->frameType(row) == ScrollbackModel::FrameType::ERROR)
+                {
+                    err << "Terminal error: " << terminal.scrollback()->frameData(row) << "\n";
+                    app.exit(1);
+                }
+            }
+
+            return;
+        }
+
+        qint64 now = Tracer::now();
+        for (int row = first; row <= last; ++row, ++rowsSeen)
+        {
+            if (rowsSeen < traffic.lines)
+            {
+                latencies.push_back(now - writeTimes[rowsSeen].load(std::memory_order_relaxed));
+            }
+            else
+            {
+                endTime = now;
+                app.quit();
+                break;
+            }
+        }
+    });
+
+    QTimer::singleShot(parser.value("timeout").toInt() * 1000, [&]() {
+        err << "Timed out after " << rowsSeen << " of " << traffic.lines << " lines\n";
+        app.exit(1);
+    });
+
+    terminal.connect();
+    int result = app.exec();
+
+    stop = true;
+    if (generator.joinable())
+        generator.join();
+
+    ::close(slave);
+    ::close(master);
+
+    if (result != 0)
+        return result;
+
+    std::sort(latencies.begin(), latencies.end());
+    double secs = (endTime - startTime) / 1e9;
+
+    // All threads of the process, less the generator
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double cpuSecs = (cpuTimeNs(usage) - generatorCpuNs) / 1e9;
+
+    out << "lines:        " << traffic.lines << " (" << traffic.minLength << "-" << traffic.maxLength << " B, "
+        << traffic.eomStyle << ", " << traffic.burst << " per write)\n";
+    out << "elapsed:      " << QString::number(secs, 'f', 3) << " s\n";
+    out << "throughput:   " << QString::number(bytesWritten / (1024.0 * 1024.0) / secs, 'f', 2) << " MB/s, "
+        << QString::number(traffic.lines / secs, 'f', 0) << " frames/s\n";
+    out << "latency p50:  " << QString::number(percentile(latencies, 0.50) / 1e6, 'f', 3) << " ms\n";
+    out << "latency p99:  " << QString::number(percentile(latencies, 0.99) / 1e6, 'f', 3) << " ms\n";
+    out << "CPU:          " << QString::number(cpuSecs, 'f', 3) << " s ("
+        << QString::number(100 * cpuSecs / secs, 'f', 1) << "% of one core)\n";
+    out << "peak RSS:     " << QString::number(usage.ru_maxrss / 1024.0, 'f', 1) << " MiB\n";
+
+    return 0;
+}
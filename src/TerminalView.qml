@@ -0,0 +1,201 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+import QtQuick 2.11
+import QtQuick.Controls 1.6
+import yaTerm 1.0
+
+// Output and input of one terminal session
+Item {
+    id: view
+
+    property QtObject terminal
+    property bool autoscroll: true
+    property int wrapMode: TextEdit.WrapAtWordBoundaryOrAnywhere
+    property font font: Qt.font({ family: "Courier New", pointSize: 10, weight: Font.Normal })
+
+    // Row of the highlighted search match; autoscroll is paused while there is one
+    property int foundRow: -1
+
+    function inputEntered() {
+        terminal.parseInput(consoleInput.text)
+        consoleInput.text = ""
+    }
+
+    function showFind() {
+        findBar.visible = true
+        findInput.forceActiveFocus()
+        findInput.selectAll()
+    }
+
+    function hideFind() {
+        findBar.visible = false
+        terminal.clearFind()
+        consoleInput.forceActiveFocus()
+    }
+
+    function find(backward) {
+        findStatus.text = ""
+        if (findInput.text.length > 0)
+            terminal.find(findInput.text, backward)
+    }
+
+    Row {
+        id: findBar
+
+        anchors.left: parent.left
+        anchors.right: parent.right
+        anchors.top: parent.top
+
+        visible: false
+        height: visible ? findInput.implicitHeight : 0
+        spacing: 4
+
+        TextField {
+            id: findInput
+
+            width: parent.width / 3
+            placeholderText: qsTr("Find")
+
+            // Enter finds the next match, Shift+Enter the previous one
+            Keys.onReturnPressed: view.find((event.modifiers & Qt.ShiftModifier) !== 0)
+            Keys.onEnterPressed: view.find((event.modifiers & Qt.ShiftModifier) !== 0)
+            Keys.onEscapePressed: view.hideFind()
+        }
+
+        Button {
+            text: qsTr("Previous")
+            onClicked: view.find(true)
+        }
+
+        Button {
+            text: qsTr("Next")
+            onClicked: view.find(false)
+        }
+
+        Button {
+            text: qsTr("Close")
+            onClicked: view.hideFind()
+        }
+
+        Label {
+            id: findStatus
+
+            anchors.verticalCenter: parent.verticalCenter
+            color: "red"
+        }
+    }
+
+    TextField {
+        id: consoleInput
+
+        anchors.left: parent.left
+        anchors.right: parent.right
+        anchors.bottom: parent.bottom
+
+        placeholderText: "Enter command or text to send followed by Enter"
+
+        Keys.onEnterPressed: view.inputEntered()
+        Keys.onReturnPressed: view.inputEntered()
+        Keys.onUpPressed: { text = view.terminal.getPrevHistory() }
+        Keys.onDownPressed: { text = view.terminal.getNextHistory() }
+        Keys.onEscapePressed: {
+            text = ""
+            view.terminal.resetHistoryIdx()
+            view.terminal.clearFind()
+        }
+
+        KeyNavigation.tab: consoleOutput
+        focus: true
+        font: view.font
+    }
+
+    ScrollView {
+        id: consoleScroll
+
+        anchors.left: parent.left
+        anchors.right: parent.right
+        anchors.bottom: consoleInput.top
+        anchors.top: findBar.bottom
+
+        // Scrolls the terminal item, which stays in view and draws the rows at its view position
+        Flickable {
+            id: consoleFlick
+
+            interactive: false
+            boundsBehavior: Flickable.StopAtBounds
+            contentWidth: consoleOutput.contentWidth
+            contentHeight: consoleOutput.contentHeight
+
+            TerminalItem {
+                id: consoleOutput
+
+                x: consoleFlick.contentX
+                y: consoleFlick.contentY
+                width: consoleFlick.width
+                height: consoleFlick.height
+                clip: true
+
+                KeyNavigation.tab: consoleInput
+
+                // Only rows in view are laid out; history lives in the C++ scrollback model
+                model: view.terminal.scrollback
+                font: view.font
+                wrap: view.wrapMode !== TextEdit.NoWrap
+                viewX: consoleFlick.contentX
+                viewY: consoleFlick.contentY
+
+                Connections {
+                    target: view.terminal
+
+                    onDisplayUpdated: {
+                        var t = tracer.begin()
+                        consoleOutput.auto_scroll()
+                        tracer.end("qml.onDisplayUpdated", t)
+                    }
+
+                    onNotFound: findStatus.text = qsTr("Not found")
+
+                    onFound: {
+                        view.foundRow = row
+                        if (row >= 0)
+                            consoleOutput.scroll_to(consoleOutput.rowY(row) - consoleFlick.height / 2)
+                        else
+                            consoleOutput.auto_scroll()
+                    }
+                }
+
+                function scroll_to(y) {
+                    consoleFlick.contentY = Math.max(0, Math.min(y, consoleFlick.contentHeight - consoleFlick.height))
+                }
+
+                function auto_scroll() {
+                    if (view.autoscroll && view.foundRow < 0) {
+                        consoleOutput.scroll_to(consoleFlick.contentHeight)
+                    }
+                }
+            }
+        }
+    }
+}
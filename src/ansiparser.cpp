@@ -0,0 +1,402 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "ansiparser.h"
+
+namespace
+{
+    enum State : quint8
+    {
+        GROUND,
+        ESCAPE,
+        ESCAPE_INTERMEDIATE,
+        CSI_ENTRY,
+        CSI_PARAM,
+        CSI_INTERMEDIATE,
+        CSI_IGNORE,
+        STRING, // OSC, DCS, SOS, PM and APC, all dropped
+        STATE_COUNT
+    };
+
+    enum Action : quint8
+    {
+        NONE,
+        PRINT,
+        EXECUTE,
+        CLEAR,
+        COLLECT,
+        PARAM,
+        ESC_DISPATCH,
+        CSI_DISPATCH
+    };
+
+    //******************************************************************************************************************
+    // Transitions and colours, built once
+    struct Tables
+    {
+        quint8 transitions[STATE_COUNT][256]; // Action << 4 | next state
+        bool text[256];                       // Printed as is in GROUND
+        QRgb colors[256];
+
+        Tables()
+        {
+            for (int b = 0; b < 256; ++b)
+                text[b] = b >= 0x20 && b != 0x7f;
+
+            for (int s = 0; s < STATE_COUNT; ++s)
+            {
+                set(s, 0x00, 0xff, NONE, s);
+
+                // C0 controls act right away, even in the middle of a sequence; strings ignore them
+                if (s != STRING)
+                {
+                    set(s, 0x00, 0x17, EXECUTE, s);
+                    set(s, 0x19, 0x19, EXECUTE, s);
+                    set(s, 0x1c, 0x1f, EXECUTE, s);
+                }
+            }
+
+            set(GROUND, 0x20, 0xff, PRINT, GROUND);
+            set(GROUND, 0x7f, 0x7f, NONE, GROUND);
+
+            set(ESCAPE, 0x20, 0x2f, COLLECT, ESCAPE_INTERMEDIATE);
+            set(ESCAPE, 0x30, 0x7e, ESC_DISPATCH, GROUND);
+            set(ESCAPE, 0x5b, 0x5b, NONE, CSI_ENTRY);
+            set(ESCAPE, 0x5d, 0x5d, NONE, STRING);
+            set(ESCAPE, 0x50, 0x50, NONE, STRING);
+            set(ESCAPE, 0x58, 0x58, NONE, STRING);
+            set(ESCAPE, 0x5e, 0x5f, NONE, STRING);
+            set(ESCAPE, 0x80, 0xff, PRINT, GROUND);
+
+            set(ESCAPE_INTERMEDIATE, 0x20, 0x2f, COLLECT, ESCAPE_INTERMEDIATE);
+            set(ESCAPE_INTERMEDIATE, 0x30, 0x7e, ESC_DISPATCH, GROUND);
+
+            // Colons separate sub-parameters (38:5:n); they are taken like semicolons
+            set(CSI_ENTRY, 0x20, 0x2f, COLLECT, CSI_INTERMEDIATE);
+            set(CSI_ENTRY, 0x30, 0x3b, PARAM, CSI_PARAM);
+            set(CSI_ENTRY, 0x3c, 0x3f, COLLECT, CSI_PARAM);
+            set(CSI_ENTRY, 0x40, 0x7e, CSI_DISPATCH, GROUND);
+            set(CSI_ENTRY, 0x80, 0xff, NONE, CSI_IGNORE);
+
+            set(CSI_PARAM, 0x20, 0x2f, COLLECT, CSI_INTERMEDIATE);
+            set(CSI_PARAM, 0x30, 0x3b, PARAM, CSI_PARAM);
+            set(CSI_PARAM, 0x3c, 0x3f, NONE, CSI_IGNORE);
+            set(CSI_PARAM, 0x40, 0x7e, CSI_DISPATCH, GROUND);
+            set(CSI_PARAM, 0x80, 0xff, NONE, CSI_IGNORE);
+
+            set(CSI_INTERMEDIATE, 0x20, 0x2f, COLLECT, CSI_INTERMEDIATE);
+            set(CSI_INTERMEDIATE, 0x30, 0x3f, NONE, CSI_IGNORE);
+            set(CSI_INTERMEDIATE, 0x40, 0x7e, CSI_DISPATCH, GROUND);
+            set(CSI_INTERMEDIATE, 0x80, 0xff, NONE, CSI_IGNORE);
+
+            set(CSI_IGNORE, 0x40, 0x7e, NONE, GROUND);
+
+            // BEL ends an OSC; ESC \ (ST) ends any string through ESCAPE
+            set(STRING, 0x07, 0x07, NONE, GROUND);
+
+            // From anywhere: CAN and SUB cancel a sequence, ESC starts a new one
+            for (int s = 0; s < STATE_COUNT; ++s)
+            {
+                set(s, 0x18, 0x18, s == STRING ? NONE : EXECUTE, GROUND);
+                set(s, 0x1a, 0x1a, s == STRING ? NONE : EXECUTE, GROUND);
+                set(s, 0x1b, 0x1b, CLEAR, ESCAPE);
+            }
+
+            // xterm colours: 16 system colours, a 6x6x6 cube and 24 greys
+            static const QRgb SYSTEM[16] = {
+                0x000000, 0xcd0000, 0x00cd00, 0xcdcd00, 0x0000ee, 0xcd00cd, 0x00cdcd, 0xe5e5e5,
+                0x7f7f7f, 0xff0000, 0x00ff00, 0xffff00, 0x5c5cff, 0xff00ff, 0x00ffff, 0xffffff
+            };
+            static const int LEVELS[6] = { 0, 95, 135, 175, 215, 255 };
+
+            for (int i = 0; i < 16; ++i)
+                colors[i] = 0xff000000 | SYSTEM[i];
+
+            for (int i = 0; i < 216; ++i)
+                colors[16 + i] = qRgb(LEVELS[i / 36], LEVELS[i / 6 % 6], LEVELS[i % 6]);
+
+            for (int i = 0; i < 24; ++i)
+                colors[232 + i] = qRgb(8 + 10 * i, 8 + 10 * i, 8 + 10 * i);
+        }
+
+        void set(int state, int first, int last, Action action, int next)
+        {
+            for (int b = first; b <= last; ++b)
+                transitions[state][b] = static_cast<quint8>(action << 4 | next);
+        }
+    };
+
+    //******************************************************************************************************************
+    const Tables &tables()
+    {
+        static const Tables t;
+        return t;
+    }
+
+    //******************************************************************************************************************
+    // Nearest colour of the 6x6x6 cube
+    int cubeIndex(int r, int g, int b)
+    {
+        auto level = [](int v) { return v < 48 ? 0 : v < 115 ? 1 : (v - 35) / 40; };
+        return 16 + 36 * level(qBound(0, r, 255)) + 6 * level(qBound(0, g, 255)) + level(qBound(0, b, 255));
+    }
+}
+
+//**********************************************************************************************************************
+AnsiParser::AnsiParser() :
+    _state(GROUND),
+    _attr(0),
+    _params(),
+    _paramCount(0),
+    _intermediate(0),
+    _private(0)
+{}
+
+//**********************************************************************************************************************
+void AnsiParser::feed(const char *data, int len, Handler &handler)
+{
+    const Tables &t = tables();
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+
+    int i = 0;
+    while (i < len)
+    {
+        if (_state == GROUND)
+        {
+            // Text goes out a run at a time
+            int start = i;
+            while (i < len && t.text[bytes[i]])
+                ++i;
+
+            if (i > start)
+                handler.print(data + start, i - start);
+
+            if (i == len)
+                break;
+        }
+
+        uchar b = bytes[i++];
+        quint8 transition = t.transitions[_state][b];
+        _state = transition & 0x0f;
+
+        switch (transition >> 4)
+        {
+            case PRINT:
+                handler.print(reinterpret_cast<const char *>(bytes + i - 1), 1);
+                break;
+
+            case EXECUTE:
+                if (b != 0x18 && b != 0x1a)
+                    handler.control(static_cast<char>(b));
+                break;
+
+            case CLEAR:
+                clear();
+                break;
+
+            case COLLECT:
+                if (b >= 0x3c && b <= 0x3f)
+                    _private = b;
+                else
+                    _intermediate = b;
+                break;
+
+            case PARAM:
+                param(b);
+                break;
+
+            case ESC_DISPATCH:
+                escDispatch(b, handler);
+                break;
+
+            case CSI_DISPATCH:
+                csiDispatch(b, handler);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+//**********************************************************************************************************************
+void AnsiParser::reset()
+{
+    _state = GROUND;
+    _attr = 0;
+    clear();
+}
+
+//**********************************************************************************************************************
+quint32 AnsiParser::attr() const
+{
+    return _attr;
+}
+
+//**********************************************************************************************************************
+QRgb AnsiParser::color(int index)
+{
+    return tables().colors[index & 0xff];
+}
+
+//**********************************************************************************************************************
+void AnsiParser::clear()
+{
+    _paramCount = 0;
+    _intermediate = 0;
+    _private = 0;
+}
+
+//**********************************************************************************************************************
+void AnsiParser::param(uchar b)
+{
+    if (_paramCount == 0)
+        _params[_paramCount++] = 0;
+
+    if (b >= '0' && b <= '9')
+    {
+        int &p = _params[_paramCount - 1];
+        p = qMin(p * 10 + (b - '0'), 65535);
+    }
+    else if (_paramCount < MAX_PARAMS)
+    {
+        // Separator
+        _params[_paramCount++] = 0;
+    }
+}
+
+//**********************************************************************************************************************
+void AnsiParser::csiDispatch(uchar final, Handler &handler)
+{
+    // Private and intermediate forms (modes, cursor styles, ...) do not change the text
+    if (_private || _intermediate)
+        return;
+
+    int n = qMax(_paramCount > 0 ? _params[0] : 0, 1);
+    switch (final)
+    {
+        case 'm':
+            sgr(handler);
+            break;
+
+        case 'K':
+            handler.eraseLine(_paramCount > 0 ? _params[0] : 0);
+            break;
+
+        case 'C':
+        case 'a':
+            handler.cursorForward(n);
+            break;
+
+        case 'D':
+            handler.cursorBack(n);
+            break;
+
+        case 'G':
+        case '`':
+            handler.cursorColumn(n - 1);
+            break;
+
+        default:
+            break;
+    }
+}
+
+//**********************************************************************************************************************
+void AnsiParser::escDispatch(uchar final, Handler &handler)
+{
+    // Full reset
+    if (final == 'c' && !_intermediate && _attr != 0)
+    {
+        _attr = 0;
+        handler.setAttr(_attr);
+    }
+}
+
+//**********************************************************************************************************************
+void AnsiParser::sgr(Handler &handler)
+{
+    quint32 attr = _attr;
+    if (_paramCount == 0)
+        attr = 0;
+
+    for (int i = 0; i < _paramCount; ++i)
+    {
+        int p = _params[i];
+        if (p == 0)
+            attr = 0;
+        else if (p == 1)
+            attr |= BOLD;
+        else if (p == 2)
+            attr |= FAINT;
+        else if (p == 3)
+            attr |= ITALIC;
+        else if (p == 4)
+            attr |= UNDERLINE;
+        else if (p == 7)
+            attr |= INVERSE;
+        else if (p == 22)
+            attr &= ~(BOLD | FAINT);
+        else if (p == 23)
+            attr &= ~ITALIC;
+        else if (p == 24)
+            attr &= ~UNDERLINE;
+        else if (p == 27)
+            attr &= ~INVERSE;
+        else if ((p >= 30 && p <= 37) || (p >= 90 && p <= 97))
+            attr = (attr & ~FG_MASK) | static_cast<quint32>(p >= 90 ? p - 90 + 8 + 1 : p - 30 + 1);
+        else if (p == 39)
+            attr &= ~FG_MASK;
+        else if ((p >= 40 && p <= 47) || (p >= 100 && p <= 107))
+            attr = (attr & ~BG_MASK) | static_cast<quint32>(p >= 100 ? p - 100 + 8 + 1 : p - 40 + 1) << BG_SHIFT;
+        else if (p == 49)
+            attr &= ~BG_MASK;
+        else if (p == 38 || p == 48)
+        {
+            // 5;n is a palette index, 2;r;g;b true colour mapped to the palette
+            int colour = -1;
+            if (i + 2 < _paramCount && _params[i + 1] == 5)
+            {
+                colour = qMin(_params[i + 2], 255);
+                i += 2;
+            }
+            else if (i + 4 < _paramCount && _params[i + 1] == 2)
+            {
+                colour = cubeIndex(_params[i + 2], _params[i + 3], _params[i + 4]);
+                i += 4;
+            }
+
+            if (colour >= 0 && p == 38)
+                attr = (attr & ~FG_MASK) | static_cast<quint32>(colour + 1);
+            else if (colour >= 0)
+                attr = (attr & ~BG_MASK) | static_cast<quint32>(colour + 1) << BG_SHIFT;
+        }
+    }
+
+    if (attr != _attr)
+    {
+        _attr = attr;
+        handler.setAttr(_attr);
+    }
+}
@@ -0,0 +1,93 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef ANSIPARSER_H
+#define ANSIPARSER_H
+
+#include <QRgb>
+
+//**********************************************************************************************************************
+// ANSI/VT100 escape sequence parser.
+//
+// A state machine driven by a transition table (after the DEC VT500 parser model) that is fed received bytes as they
+// arrive; sequences may be split anywhere between calls. Runs of text are handed to the Handler whole. SGR sequences
+// update a packed display attribute, and cursor left/right/column and erase-in-line sequences are passed on. All other
+// sequences (cursor up/down, modes, OSC titles and other strings) are consumed and dropped. Nothing is allocated.
+class AnsiParser
+{
+public:
+    // Display attributes packed in 32 bits; 0 is the default. Colours are a 256-colour palette index plus one, or 0
+    // for the default colour.
+    enum : quint32
+    {
+        FG_MASK = 0x1ff,
+        BG_SHIFT = 9,
+        BG_MASK = 0x1ff << BG_SHIFT,
+        BOLD = 1 << 18,
+        FAINT = 1 << 19,
+        ITALIC = 1 << 20,
+        UNDERLINE = 1 << 21,
+        INVERSE = 1 << 22
+    };
+
+    class Handler
+    {
+    public:
+        virtual ~Handler() {}
+
+        virtual void print(const char *data, int len) = 0; // Text, never control bytes
+        virtual void control(char c) = 0;                  // C0 controls other than ESC, CAN and SUB
+        virtual void setAttr(quint32 attr) = 0;
+        virtual void cursorForward(int n) = 0;
+        virtual void cursorBack(int n) = 0;
+        virtual void cursorColumn(int column) = 0;         // From 0
+        virtual void eraseLine(int mode) = 0;              // 0 to the end, 1 to the start, 2 all
+    };
+
+    AnsiParser();
+
+    void feed(const char *data, int len, Handler &handler);
+    void reset(); // Back to text in the default attribute, without telling the handler
+    quint32 attr() const;
+
+    static QRgb color(int index); // Of the 256-colour palette
+
+private:
+    static const int MAX_PARAMS = 16;
+
+    void clear();
+    void param(uchar b);
+    void csiDispatch(uchar final, Handler &handler);
+    void escDispatch(uchar final, Handler &handler);
+    void sgr(Handler &handler);
+
+    quint8 _state;
+    quint32 _attr;
+    int _params[MAX_PARAMS];
+    int _paramCount;
+    uchar _intermediate;
+    uchar _private; // Parameter prefix such as '?'
+};
+
+#endif // ANSIPARSER_H
@@ -0,0 +1,334 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "capturelogger.h"
+#include "capturereader.h"
+
+#include <QFileInfo>
+#include <QtEndian>
+#include <QtDebug>
+
+#include <chrono>
+#include <cstring>
+
+//**********************************************************************************************************************
+CaptureLogger::CaptureLogger(QObject *parent) :
+    QThread(parent),
+    _file(),
+    _queue(QUEUE_LEN),
+    _indexed(false),
+    _index(),
+    _offset(0),
+    _active(false),
+    _stopRequested(false),
+    _failed(false),
+    _writeError(),
+    _written(0),
+    _dropped(0),
+    _late(0)
+{
+    setObjectName("CaptureLogger");
+}
+
+//**********************************************************************************************************************
+CaptureLogger::~CaptureLogger()
+{
+    close();
+}
+
+//**********************************************************************************************************************
+bool CaptureLogger::open(const QString &fileName)
+{
+    close();
+
+    // Writer is stopped, so this thread may act as consumer; anything left belongs to a previous log
+    Record stale;
+    while (_queue.pop(stale))
+        ;
+
+    // Continue the index of an existing file; its records end where the index (or a record cut short) starts
+    _index.clear();
+    _indexed = true;
+    qint64 end = -1;
+    if (QFile::exists(fileName) && QFileInfo(fileName).size() > 0)
+    {
+        CaptureReader reader;
+        if (reader.open(fileName) && reader.version() >= 2)
+        {
+            _index = reader.index();
+            end = reader.dataEnd();
+        }
+        else
+        {
+            _indexed = false;
+        }
+    }
+
+    _file.setFileName(fileName);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        qWarning() << "Could not open log file" << fileName << ":" << _file.errorString();
+        return false;
+    }
+
+    if (end >= 0 && end < _file.size())
+        _file.resize(end);
+
+    _failed = false;
+    _writeError.clear();
+
+    if (_file.size() == 0)
+    {
+        QByteArray header("YATERMLG");
+        char version[sizeof(quint16)];
+        qToLittleEndian<quint16>(FORMAT_VERSION, version);
+        header.append(version, sizeof(version));
+        if (_file.write(header) != header.size() || !_file.flush())
+        {
+            qWarning() << "Could not write log file" << fileName << ":" << _file.errorString();
+            _writeError = _file.errorString();
+            _failed = true;
+            _file.close();
+            return false;
+        }
+
+        _offset = HEADER_SIZE;
+    }
+    else
+    {
+        _offset = _file.size();
+    }
+
+    _written = 0;
+    _dropped = 0;
+    _late = 0;
+    _stopRequested = false;
+    _active = true;
+
+    start(QThread::LowPriority);
+
+    return true;
+}
+
+//**********************************************************************************************************************
+void CaptureLogger::close()
+{
+    if (!isRunning())
+        return;
+
+    _active = false;
+    _stopRequested = true;
+
+    _wakeMutex.lock();
+    _wake.wakeAll();
+    _wakeMutex.unlock();
+
+    wait();
+
+    if (_indexed)
+        writeIndex();
+
+    _file.close();
+}
+
+//**********************************************************************************************************************
+bool CaptureLogger::isActive() const
+{
+    return _active.load(std::memory_order_relaxed);
+}
+
+//**********************************************************************************************************************
+QString CaptureLogger::fileName() const
+{
+    return _file.fileName();
+}
+
+//**********************************************************************************************************************
+QString CaptureLogger::errorString() const
+{
+    return _failed ? _writeError : _file.errorString();
+}
+
+//**********************************************************************************************************************
+void CaptureLogger::log(Direction direction, const QByteArray &data)
+{
+    if (!isActive() || data.isEmpty())
+        return;
+
+    if (!_queue.push({ direction, now(), data }))
+        ++_dropped;
+}
+
+//**********************************************************************************************************************
+quint64 CaptureLogger::recordsWritten() const
+{
+    return _written;
+}
+
+//**********************************************************************************************************************
+quint64 CaptureLogger::recordsDropped() const
+{
+    return _dropped;
+}
+
+//**********************************************************************************************************************
+quint64 CaptureLogger::recordsLate() const
+{
+    return _late;
+}
+
+//**********************************************************************************************************************
+void CaptureLogger::run()
+{
+    QByteArray buffer;
+    buffer.reserve(WRITE_BATCH_BYTES * 2);
+    int records = 0;
+
+    forever
+    {
+        // Sample before draining so nothing queued ahead of close() is lost
+        bool stopping = _stopRequested;
+
+        Record record;
+        qint64 writeTime = now();
+        while (_queue.pop(record))
+        {
+            // Nothing more goes to a file that failed a write
+            if (_failed)
+            {
+                ++_dropped;
+                continue;
+            }
+
+            addToIndex(_index, record.timestamp, _offset);
+            _offset += RECORD_HEADER_SIZE + record.data.size();
+
+            serialize(record, buffer);
+            ++records;
+
+            if (writeTime - record.timestamp > LATE_NS)
+                ++_late;
+
+            if (buffer.size() >= WRITE_BATCH_BYTES)
+                writeBatch(buffer, records);
+        }
+
+        if (!buffer.isEmpty())
+            writeBatch(buffer, records);
+
+        if (stopping)
+            break;
+
+        _wakeMutex.lock();
+        if (!_stopRequested)
+            _wake.wait(&_wakeMutex, FLUSH_INTERVAL_MS);
+        _wakeMutex.unlock();
+    }
+}
+
+//**********************************************************************************************************************
+void CaptureLogger::writeBatch(QByteArray &buffer, int &records)
+{
+    // Flushed as well, so a full disk shows up here rather than in a later batch
+    if (_file.write(buffer) == buffer.size() && _file.flush())
+    {
+        _written += records;
+    }
+    else
+    {
+        // Cut back to the last whole batch and forget the index entries that pointed past it. QFile::resize() would
+        // flush the rest of the batch first, so the file is closed (dropping it) and truncated by name.
+        qint64 start = _offset - buffer.size();
+        _writeError = _file.errorString();
+        qWarning() << "Could not write log file" << _file.fileName() << ":" << _writeError;
+
+        _file.close();
+        QFile::resize(_file.fileName(), start);
+        _file.open(QIODevice::WriteOnly | QIODevice::Append);
+        _offset = start;
+        while (!_index.isEmpty() && _index.last().offset >= start)
+            _index.removeLast();
+
+        _dropped += records;
+        _failed = true;
+
+        emit writeFailed(_writeError);
+    }
+
+    buffer.resize(0);
+    records = 0;
+}
+
+//**********************************************************************************************************************
+void CaptureLogger::addToIndex(QVector<IndexEntry> &index, qint64 timestamp, qint64 offset)
+{
+    if (index.isEmpty() || timestamp - index.last().timestamp >= INDEX_INTERVAL_NS ||
+        offset - index.last().offset >= INDEX_INTERVAL_BYTES)
+    {
+        index.append({ timestamp, offset });
+    }
+}
+
+//**********************************************************************************************************************
+void CaptureLogger::writeIndex()
+{
+    QByteArray trailer(_index.size() * INDEX_ENTRY_SIZE + INDEX_TRAILER_SIZE, Qt::Uninitialized);
+    char *out = trailer.data();
+    foreach (const IndexEntry &entry, _index)
+    {
+        qToLittleEndian<qint64>(entry.timestamp, out);
+        qToLittleEndian<qint64>(entry.offset, out + sizeof(qint64));
+        out += INDEX_ENTRY_SIZE;
+    }
+
+    qToLittleEndian<quint32>(static_cast<quint32>(_index.size()), out);
+    std::memcpy(out + sizeof(quint32), "YATERMIX", 8);
+
+    // A trailer cut short is taken off again; the file is then scanned when it is read
+    if (_file.write(trailer) != trailer.size() || !_file.flush())
+    {
+        qWarning() << "Could not write log index" << _file.fileName() << ":" << _file.errorString();
+        _file.close();
+        QFile::resize(_file.fileName(), _offset);
+    }
+}
+
+//**********************************************************************************************************************
+qint64 CaptureLogger::now()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+//**********************************************************************************************************************
+void CaptureLogger::serialize(const Record &record, QByteArray &buffer)
+{
+    char header[RECORD_HEADER_SIZE];
+    header[0] = static_cast<char>(record.direction);
+    qToLittleEndian<qint64>(record.timestamp, header + 1);
+    qToLittleEndian<quint32>(static_cast<quint32>(record.data.size()), header + 1 + sizeof(qint64));
+
+    buffer.append(header, sizeof(header));
+    buffer.append(record.data);
+}
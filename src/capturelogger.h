@@ -0,0 +1,158 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef CAPTURELOGGER_H
+#define CAPTURELOGGER_H
+
+#include "spscqueue.h"
+
+#include <QThread>
+#include <QByteArray>
+#include <QString>
+#include <QFile>
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <atomic>
+
+//**********************************************************************************************************************
+// Append-only capture of all received and transmitted bytes, written from a background thread.
+//
+// log() is called from the serial I/O thread and never blocks: records go into a bounded lock-free queue and are
+// counted as dropped if it is full. The writer thread drains the queue in large batched writes.
+//
+// On-disk format (all integers little-endian):
+//
+//   File header, written when a new (empty) file is started:
+//     8 bytes  magic "YATERMLG"
+//     2 bytes  format version (2)
+//
+//   Records, back to back:
+//     1 byte   direction: 'R' received, 'T' transmitted
+//     8 bytes  timestamp, nanoseconds since the Unix epoch, taken when the bytes left/entered the port
+//     4 bytes  payload length N
+//     N bytes  payload, raw
+//
+//   Index, written after the records when logging stops (version 2):
+//     N x 16   entries: timestamp (8 bytes) and file offset (8 bytes) of a record, one per INDEX_INTERVAL_NS of
+//              capture time or INDEX_INTERVAL_BYTES of records, whichever comes first
+//     4 bytes  entry count N
+//     8 bytes  magic "YATERMIX"
+//
+// Appending to a file that has an index takes the index off first and writes it again, extended, at the end. A file
+// left without one (version 1, or logging never stopped) is read by a scan instead; see CaptureReader.
+//
+// If a batch cannot be written (disk full, I/O error) the file is cut back to the end of the last batch that was, so
+// it still ends on a whole record, and writeFailed() is emitted. That batch and every record after it count as
+// dropped.
+class CaptureLogger : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum class Direction : char
+    {
+        RECEIVED = 'R',
+        TRANSMITTED = 'T'
+    };
+
+    static const quint16 FORMAT_VERSION = 2;
+    static const int HEADER_SIZE = 8 + sizeof(quint16);
+    static const int RECORD_HEADER_SIZE = 1 + sizeof(qint64) + sizeof(quint32);
+    static const int INDEX_ENTRY_SIZE = 2 * sizeof(qint64);
+    static const int INDEX_TRAILER_SIZE = sizeof(quint32) + 8;
+    static const qint64 INDEX_INTERVAL_NS = 1000000000LL;
+    static const qint64 INDEX_INTERVAL_BYTES = 1024 * 1024;
+
+    struct IndexEntry
+    {
+        qint64 timestamp;
+        qint64 offset; // Of the record, from the start of the file
+    };
+
+    // Adds an entry for the record at offset if the last one is an interval behind
+    static void addToIndex(QVector<IndexEntry> &index, qint64 timestamp, qint64 offset);
+
+    explicit CaptureLogger(QObject *parent = nullptr);
+    ~CaptureLogger();
+
+    bool open(const QString &fileName);
+    void close();
+    bool isActive() const;
+    QString fileName() const;
+    QString errorString() const;
+
+    // Producer (serial I/O thread)
+    void log(Direction direction, const QByteArray &data);
+
+    quint64 recordsWritten() const;
+    quint64 recordsDropped() const;
+    quint64 recordsLate() const;
+
+signals:
+    void writeFailed(const QString &error); // From the writer thread
+
+protected:
+    void run() override;
+
+private:
+    static const int QUEUE_LEN = 8192;              // Records
+    static const int WRITE_BATCH_BYTES = 256 * 1024;
+    static const int FLUSH_INTERVAL_MS = 100;
+    static const qint64 LATE_NS = 1000000000LL;     // Written more than 1 s after capture
+
+    struct Record
+    {
+        Direction direction;
+        qint64 timestamp;
+        QByteArray data;
+    };
+
+    static qint64 now();
+    static void serialize(const Record &record, QByteArray &buffer);
+
+    void writeBatch(QByteArray &buffer, int &records); // Clears both
+    void writeIndex();
+
+    QFile _file;
+    SpscQueue<Record> _queue;
+
+    bool _indexed;              // An index is written on close(); not for version 1 files
+    QVector<IndexEntry> _index; // Writer thread while it runs
+    qint64 _offset;             // Where the next record goes
+
+    std::atomic<bool> _active;
+    std::atomic<bool> _stopRequested;
+    std::atomic<bool> _failed;  // Set after _writeError
+    QString _writeError;
+    std::atomic<quint64> _written;
+    std::atomic<quint64> _dropped;
+    std::atomic<quint64> _late;
+
+    QMutex _wakeMutex;
+    QWaitCondition _wake;
+};
+
+#endif // CAPTURELOGGER_H
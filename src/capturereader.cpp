@@ -0,0 +1,234 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+#include "capturereader.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+//**********************************************************************************************************************
+CaptureReader::CaptureReader() :
+    _file(),
+    _data(nullptr),
+    _size(0),
+    _dataEnd(0),
+    _pos(0),
+    _version(0),
+    _storedIndex(false),
+    _index(),
+    _error()
+{
+}
+
+//**********************************************************************************************************************
+bool CaptureReader::open(const QString &fileName)
+{
+    close();
+    _error.clear();
+
+    _file.setFileName(fileName);
+    if (!_file.open(QIODevice::ReadOnly))
+    {
+        _error = _file.errorString();
+        return false;
+    }
+
+    _size = _file.size();
+    _data = _size >= CaptureLogger::HEADER_SIZE ? _file.map(0, _size) : nullptr;
+    if (!_data || std::memcmp(_data, "YATERMLG", 8) != 0)
+    {
+        _error = _data ? QString("Not a capture log") : _file.errorString();
+        close();
+        return false;
+    }
+
+    _version = qFromLittleEndian<quint16>(_data + 8);
+    if (_version < 1 || _version > CaptureLogger::FORMAT_VERSION)
+    {
+        _error = QString("Unknown capture log version %1").arg(_version);
+        close();
+        return false;
+    }
+
+    if (!readIndex())
+        scan();
+
+    _pos = CaptureLogger::HEADER_SIZE;
+    return true;
+}
+
+//**********************************************************************************************************************
+void CaptureReader::close()
+{
+    if (_data)
+        _file.unmap(const_cast<uchar *>(_data));
+
+    _file.close();
+    _data = nullptr;
+    _size = 0;
+    _dataEnd = 0;
+    _pos = 0;
+    _version = 0;
+    _storedIndex = false;
+    _index.clear();
+}
+
+//**********************************************************************************************************************
+QString CaptureReader::errorString() const
+{
+    return _error;
+}
+
+//**********************************************************************************************************************
+quint16 CaptureReader::version() const
+{
+    return _version;
+}
+
+//**********************************************************************************************************************
+bool CaptureReader::hasStoredIndex() const
+{
+    return _storedIndex;
+}
+
+//**********************************************************************************************************************
+const QVector<CaptureLogger::IndexEntry> &CaptureReader::index() const
+{
+    return _index;
+}
+
+//**********************************************************************************************************************
+qint64 CaptureReader::dataEnd() const
+{
+    return _dataEnd;
+}
+
+//**********************************************************************************************************************
+qint64 CaptureReader::firstTimestamp() const
+{
+    return _index.isEmpty() ? -1 : _index.first().timestamp;
+}
+
+//**********************************************************************************************************************
+void CaptureReader::seek(qint64 timestamp)
+{
+    // The last entry at or before timestamp, then record by record
+    auto it = std::upper_bound(_index.constBegin(), _index.constEnd(), timestamp,
+                               [](qint64 t, const CaptureLogger::IndexEntry &entry) { return t < entry.timestamp; });
+    _pos = it == _index.constBegin() ? CaptureLogger::HEADER_SIZE : (it - 1)->offset;
+
+    CaptureLogger::Direction direction;
+    qint64 t;
+    int len;
+    while (header(_pos, direction, t, len) && t < timestamp)
+        _pos += CaptureLogger::RECORD_HEADER_SIZE + len;
+}
+
+//**********************************************************************************************************************
+bool CaptureReader::next(Record &record)
+{
+    int len;
+    if (!header(_pos, record.direction, record.timestamp, len))
+        return false;
+
+    const char *payload = reinterpret_cast<const char *>(_data + _pos + CaptureLogger::RECORD_HEADER_SIZE);
+    record.data = QByteArray(payload, len);
+    _pos += CaptureLogger::RECORD_HEADER_SIZE + len;
+
+    return true;
+}
+
+//**********************************************************************************************************************
+bool CaptureReader::readIndex()
+{
+    const qint64 trailer = CaptureLogger::INDEX_TRAILER_SIZE;
+    if (_version < 2 || _size < CaptureLogger::HEADER_SIZE + trailer ||
+        std::memcmp(_data + _size - 8, "YATERMIX", 8) != 0)
+    {
+        return false;
+    }
+
+    qint64 count = qFromLittleEndian<quint32>(_data + _size - trailer);
+    qint64 start = _size - trailer - count * CaptureLogger::INDEX_ENTRY_SIZE;
+    if (start < CaptureLogger::HEADER_SIZE)
+        return false;
+
+    // Entries must point at records, in order
+    _index.resize(static_cast<int>(count));
+    const uchar *in = _data + start;
+    for (int i = 0; i < _index.size(); ++i, in += CaptureLogger::INDEX_ENTRY_SIZE)
+    {
+        CaptureLogger::IndexEntry &entry = _index[i];
+        entry.timestamp = qFromLittleEndian<qint64>(in);
+        entry.offset = qFromLittleEndian<qint64>(in + sizeof(qint64));
+
+        qint64 min = i > 0 ? _index.at(i - 1).offset + CaptureLogger::RECORD_HEADER_SIZE : CaptureLogger::HEADER_SIZE;
+        if (entry.offset < min || entry.offset + CaptureLogger::RECORD_HEADER_SIZE > start)
+        {
+            _index.clear();
+            return false;
+        }
+    }
+
+    _dataEnd = start;
+    _storedIndex = true;
+    return true;
+}
+
+//**********************************************************************************************************************
+void CaptureReader::scan()
+{
+    _index.clear();
+    _dataEnd = _size;
+
+    qint64 pos = CaptureLogger::HEADER_SIZE;
+    CaptureLogger::Direction direction;
+    qint64 timestamp;
+    int len;
+    while (header(pos, direction, timestamp, len))
+    {
+        CaptureLogger::addToIndex(_index, timestamp, pos);
+        pos += CaptureLogger::RECORD_HEADER_SIZE + len;
+    }
+
+    _dataEnd = pos;
+}
+
+//**********************************************************************************************************************
+bool CaptureReader::header(qint64 pos, CaptureLogger::Direction &direction, qint64 &timestamp, int &len) const
+{
+    if (pos + CaptureLogger::RECORD_HEADER_SIZE > _dataEnd)
+        return false;
+
+    const uchar *in = _data + pos;
+    quint32 size = qFromLittleEndian<quint32>(in + 1 + sizeof(qint64));
+    if (size > static_cast<quint64>(_dataEnd - pos - CaptureLogger::RECORD_HEADER_SIZE))
+        return false;
+
+    direction = static_cast<CaptureLogger::Direction>(in[0]);
+    timestamp = qFromLittleEndian<qint64>(in + 1);
+    len = static_cast<int>(size);
+    return true;
+}
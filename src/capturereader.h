@@ -0,0 +1,81 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+#ifndef CAPTUREREADER_H
+#define CAPTUREREADER_H
+
+#include "capturelogger.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+//**********************************************************************************************************************
+// Reads a capture log (see CaptureLogger for the format) record by record from a memory-mapped view.
+//
+// seek() finds its place from the index at the end of the file, so it only reads the records within one index
+// interval of the time asked for. A file without an index is scanned once by open() to build one in memory. A record
+// cut short at the end (logging was killed mid-write) ends the file.
+class CaptureReader
+{
+public:
+    struct Record
+    {
+        CaptureLogger::Direction direction;
+        qint64 timestamp; // Nanoseconds since the Unix epoch
+        QByteArray data;
+    };
+
+    CaptureReader();
+
+    bool open(const QString &fileName);
+    void close();
+    QString errorString() const;
+
+    quint16 version() const;
+    bool hasStoredIndex() const;   // False if open() had to scan
+    const QVector<CaptureLogger::IndexEntry> &index() const;
+    qint64 dataEnd() const;        // Past the last whole record
+    qint64 firstTimestamp() const; // -1 if there are no records
+
+    void seek(qint64 timestamp); // To the first record at or after timestamp
+    bool next(Record &record);   // False at the end
+
+private:
+    bool readIndex();
+    void scan();
+    bool header(qint64 pos, CaptureLogger::Direction &direction, qint64 &timestamp, int &len) const;
+
+    QFile _file;
+    const uchar *_data;
+    qint64 _size;
+    qint64 _dataEnd;
+    qint64 _pos;
+    quint16 _version;
+    bool _storedIndex;
+    QVector<CaptureLogger::IndexEntry> _index;
+    QString _error;
+};
+
+#endif // CAPTUREREADER_H
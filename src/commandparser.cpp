@@ -24,49 +24,133 @@
 
 #include "commandparser.h"
 #include "simpleterminal.h"
+#include "profile.h"
+#include "tracer.h"
 
-#include <QApplication>
+#include <QCoreApplication>
 
-//**********************************************************************************************************************
-const QMap<QString, CommandParser::CmdFunc> CommandParser::cmdMap = {
-    { "/clear", CommandParser::cmdClear },
-    { "/connect", CommandParser::cmdConnect },
-    { "/disconnect", CommandParser::cmdDisconnect },
-    { "/help", CommandParser::cmdHelp },
-    { "/quit", CommandParser::cmdQuit },
-    { "/som", CommandParser::cmdSOM },
-};
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+    // Colour of command names in help (palette index + 1, see AnsiParser): blue violet
+    const quint32 NAME_ATTR = 93;
+}
 
 //**********************************************************************************************************************
-// @todo: Combine cmdHelpMap and cmdMap?
-const QMap<QString, QStringList> CommandParser::cmdHelpMap = {
-    { "/clear", { "", "Clear the screen" } },
-    { "/connect", { "[portName]", "Connect to port [portName] or current port if not specified" } },
-    { "/disconnect", { "", "Disconnect from port" } },
-    { "/help", { "[command]", "Get help if [command] is specified. Otherwise, list all commands." } },
-    { "/quit", { "", "Quit" } },
-    { "/som", { "[start-of-message]", "Set prefix to text entered if [start-of-message] is specified; Otherwise, None" } },
+const CommandParser::Command CommandParser::commands[] = {
+    { "/ansi", CommandParser::cmdAnsi, "[on|off]", "Interpret ANSI escape sequences (colours, carriage return "
+                                                   "overwrites) in received data if [on|off] is on, show them as is if "
+                                                   "off; Otherwise, toggle" },
+    { "/clear", CommandParser::cmdClear, "", "Clear the screen" },
+    { "/connect", CommandParser::cmdConnect, "[portName]", "Connect to port [portName] or current port if not "
+                                                           "specified" },
+    { "/disconnect", CommandParser::cmdDisconnect, "", "Disconnect from port" },
+    { "/encoding", CommandParser::cmdEncoding, "[utf8|latin1|raw]", "Decode sent and received data as "
+                                                                    "[utf8|latin1|raw] if specified; Otherwise, show "
+                                                                    "the setting. Control bytes are shown as ^X and "
+                                                                    "bytes that are not text as \\xHH" },
+    { "/find", CommandParser::cmdFind, "[-b] [text]", "Find the next (previous with -b) received or sent [text], "
+                                                      "ignoring case; Otherwise, repeat the last search. Escape in "
+                                                      "the input clears the match" },
+    { "/flushrate", CommandParser::cmdFlushRate, "[rate]", "Limit display updates to [rate] per second if specified; "
+                                                           "Otherwise, show current limit" },
+    { "/help", CommandParser::cmdHelp, "[command]", "Get help if [command] is specified. Otherwise, list all "
+                                                    "commands." },
+    { "/hex", CommandParser::cmdHex, "[on|off]", "Show sent and received data as a hex dump if [on|off] is on, as text "
+                                                 "if off; Otherwise, toggle" },
+    { "/log", CommandParser::cmdLog, "[file]", "Append all received and transmitted bytes to [file] if specified; "
+                                               "Otherwise, stop logging" },
+    { "/profile", CommandParser::cmdProfile, "[save|load|delete] [name]", "Save the port, line and display settings "
+                                                                          "as profile [name], switch to it or delete "
+                                                                          "it if specified; Otherwise, list profiles" },
+    { "/quit", CommandParser::cmdQuit, "", "Quit" },
+    { "/replay", CommandParser::cmdReplay, "[-x speed|max] [-t seconds] [file]", "Replay capture log [file] as if it "
+                                                                              "were received now, at -x times the "
+                                                                              "recorded speed (max: as fast as "
+                                                                              "possible) from -t seconds in, if "
+                                                                              "specified; Otherwise, stop replaying" },
+    { "/run", CommandParser::cmdRun, "[-e] [script]", "Run [script], echoing what it sends with -e, if specified; "
+                                                      "Otherwise, stop the running script. Script lines are send "
+                                                      "<text>, wait <pattern> [timeout ms], delay <ms>, som [text], "
+                                                      "eom [text] and connect [portName]; # starts a comment" },
+    { "/rxeom", CommandParser::cmdRxEOM, "[end-of-message...]", "End received messages at any of [end-of-message...] "
+                                                                "if specified (escapes such as \\r, \\n and \\xHH "
+                                                                "allowed); Otherwise, at the EOM" },
+    { "/send", CommandParser::cmdSend, "[-r bytes/s] [-d ms] [file]", "Send [file] as is, limited to -r bytes per "
+                                                                      "second and pausing -d milliseconds after each "
+                                                                      "line if given; Otherwise, cancel sending" },
+    { "/som", CommandParser::cmdSOM, "[start-of-message]", "Set prefix to text entered if [start-of-message] is "
+                                                           "specified; Otherwise, None" },
+    { "/time", CommandParser::cmdTime, "[off|abs|delta]", "Prefix each line with the time it arrived (abs) or the time "
+                                                          "since the line before it (delta) if [off|abs|delta] is "
+                                                          "specified; Otherwise, show the setting" },
+    { "/trace", CommandParser::cmdTrace, "start|stop [file]", "Start recording pipeline timing spans or stop and write "
+                                                              "them to [file] as Chrome trace-event JSON; [file] may "
+                                                              "be given to either" },
+    { "/trigger", CommandParser::cmdTrigger, "[name] [pattern] [send|cmd|mark] [argument]", "When received data "
+      "matches [pattern] (literal, or a regular expression written /like this/), send [argument], run [argument] as "
+      "input or mark the match. With [name] only, remove that trigger; Otherwise, list triggers with their match "
+      "counts and response latency" },
 };
 
 //**********************************************************************************************************************
 CommandParser::CommandParser(SimpleTerminal &terminal)
     : _terminal(terminal)
-{}
+{
+    Q_ASSERT(std::is_sorted(std::begin(commands), std::end(commands), [](const Command &a, const Command &b) {
+        return qstrcmp(a.name, b.name) < 0;
+    }));
+}
+
+//**********************************************************************************************************************
+const CommandParser::Command *CommandParser::findCommand(const QStringRef &name)
+{
+    const Command *cmd = std::lower_bound(std::begin(commands), std::end(commands), name,
+                                          [](const Command &c, const QStringRef &n) {
+        return n.compare(QLatin1String(c.name)) > 0;
+    });
+
+    if (cmd == std::end(commands) || name.compare(QLatin1String(cmd->name)) != 0)
+        return nullptr;
+
+    return cmd;
+}
+
+//**********************************************************************************************************************
+void CommandParser::cmdAnsi(SimpleTerminal &st, const QStringList &args)
+{
+    if (args.size() > 0)
+    {
+        if (args[0] == "on")
+            st.setAnsi(true);
+        else if (args[0] == "off")
+            st.setAnsi(false);
+        else
+            st.setError("Expected on or off");
+    }
+    else
+    {
+        st.setAnsi(!st.ansi());
+    }
+}
 
 //**********************************************************************************************************************
 void CommandParser::cmdClear(SimpleTerminal &st, const QStringList &)
 {
-    emit st.clearDisplayText();
+    st.clearDisplay();
 }
 
 //**********************************************************************************************************************
 void CommandParser::cmdConnect(SimpleTerminal &st, const QStringList &args)
 {
-    if (args.size() > 0)
+    // setPort() reopens an open port itself; opening it again here would cycle it twice
+    if (args.size() > 0 && args[0] != st.getPortName())
     {
-        st.disconnect();
         st.setPort(args[0]);
-        st.connect();
+        if (!st.isConnected())
+            st.connect();
     }
     else
     {
@@ -80,11 +164,278 @@ void CommandParser::cmdDisconnect(SimpleTerminal &st, const QStringList &)
     st.disconnect();
 }
 
+//**********************************************************************************************************************
+void CommandParser::cmdEncoding(SimpleTerminal &st, const QStringList &args)
+{
+    if (args.size() > 0)
+    {
+        if (!st.setEncoding(args[0]))
+            st.setError("Expected utf8, latin1 or raw");
+    }
+    else
+    {
+        st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, "Encoding " + st.encoding());
+    }
+}
+
+//**********************************************************************************************************************
+void CommandParser::cmdFind(SimpleTerminal &st, const QStringList &args)
+{
+    bool backward = !args.isEmpty() && args[0] == "-b";
+    QString text = args.mid(backward ? 1 : 0).join(' ');
+
+    if (text.isEmpty() && st.findText().isEmpty())
+    {
+        st.setError("Expected text to find");
+        return;
+    }
+
+    // Answered once the search is done
+    st.find(text, backward, true);
+}
+
+//**********************************************************************************************************************
+void CommandParser::cmdHex(SimpleTerminal &st, const QStringList &args)
+{
+    if (args.size() > 0)
+    {
+        if (args[0] == "on")
+            st.setHexMode(true);
+        else if (args[0] == "off")
+            st.setHexMode(false);
+        else
+            st.setError("Expected on or off");
+    }
+    else
+    {
+        st.setHexMode(!st.hexMode());
+    }
+}
+
+//**********************************************************************************************************************
+void CommandParser::cmdLog(SimpleTerminal &st, const QStringList &args)
+{
+    if (args.size() > 0)
+    {
+        QString fileName = args.join(' ');
+        if (st.startLog(fileName))
+            st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, "Logging to " + fileName);
+    }
+    else
+    {
+        const CaptureLogger &logger = st.logger();
+        if (logger.isActive())
+        {
+            st.stopLog();
+
+            QString rspStr = QString("Stopped logging to %1: %2 records written, %3 dropped, %4 late")
+                             .arg(logger.fileName())
+                             .arg(logger.recordsWritten())
+                             .arg(logger.recordsDropped())
+                             .arg(logger.recordsLate());
+
+            st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, rspStr);
+        }
+        else
+            st.setError("Not logging");
+    }
+}
+
+//**********************************************************************************************************************
+void CommandParser::cmdTrace(SimpleTerminal &st, const QStringList &args)
+{
+    QString action = args.value(0);
+    if (args.size() > 1)
+        st.setTraceFile(args.mid(1).join(' '));
+
+    QString traceFile = st.traceFile();
+
+    Tracer *tracer = Tracer::instance();
+    if (action == "start")
+    {
+        if (tracer->start())
+            st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, "Tracing started");
+        else
+            st.setError("Tracing is not available in this build");
+    }
+    else if (action == "stop")
+    {
+        if (!Tracer::isEnabled())
+        {
+            st.setError("Not tracing");
+            return;
+        }
+
+        if (traceFile.isEmpty())
+        {
+            st.setError("Expected a trace file");
+            return;
+        }
+
+        tracer->stop();
+        if (tracer->writeChromeTrace(traceFile))
+            st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, "Trace written to " + traceFile);
+        else
+            st.setError("Could not write trace to " + traceFile);
+    }
+    else
+    {
+        st.setError("Expected start or stop");
+    }
+}
+
+//**********************************************************************************************************************
+void CommandParser::cmdProfile(SimpleTerminal &st, const QStringList &args)
+{
+    ProfileStore *store = ProfileStore::instance();
+
+    if (args.isEmpty())
+    {
+        QStringList names = store->names();
+        st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP,
+                         names.isEmpty() ? "No profiles" : "Profiles: " + names.join(", "));
+        return;
+    }
+
+    QString name = args.mid(1).join(' ');
+    if (name.isEmpty())
+    {
+        st.setError("Expected a profile name");
+        return;
+    }
+
+    if (args[0] == "save")
+    {
+        if (st.saveProfile(name))
+            st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, "Saved profile " + name);
+    }
+    else if (args[0] == "load")
+    {
+        if (st.loadProfile(name))
+            st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, "Switched to profile " + name);
+    }
+    else if (args[0] == "delete")
+    {
+        if (!store->remove(name))
+            st.setError("No profile " + name);
+    }
+    else
+    {
+        st.setError("Expected save, load or delete");
+    }
+}
+
 //**********************************************************************************************************************
 void CommandParser::cmdQuit(SimpleTerminal &st, const QStringList &)
 {
     st.disconnect();
-    QApplication::quit();
+    QCoreApplication::quit();
+}
+
+//**********************************************************************************************************************
+void CommandParser::cmdReplay(SimpleTerminal &st, const QStringList &args)
+{
+    if (args.isEmpty())
+    {
+        if (st.isReplaying())
+            st.stopReplay();
+        else
+            st.setError("Not replaying");
+
+        return;
+    }
+
+    double speed = 1;
+    qint64 offsetNs = 0;
+    int i = 0;
+    for (; i + 1 < args.size() && (args[i] == "-x" || args[i] == "-t"); i += 2)
+    {
+        bool max = args[i] == "-x" && args[i + 1] == "max";
+        bool ok = max;
+        double value = max ? 0 : args[i + 1].toDouble(&ok);
+        if (!ok || value < 0 || (args[i] == "-x" && !max && value == 0))
+        {
+            st.setError("Invalid value for " + args[i]);
+            return;
+        }
+
+        if (args[i] == "-x")
+            speed = value;
+        else
+            offsetNs = static_cast<qint64>(value * 1e9);
+    }
+
+    QString fileName = args.mid(i).join(' ');
+    if (fileName.isEmpty())
+    {
+        st.setError("Expected a file");
+        return;
+    }
+
+    if (st.startReplay(fileName, speed, offsetNs))
+        st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, "Replaying " + fileName);
+}
+
+//**********************************************************************************************************************
+void CommandParser::cmdRun(SimpleTerminal &st, const QStringList &args)
+{
+    bool echo = !args.isEmpty() && args[0] == "-e";
+    QString fileName = args.mid(echo ? 1 : 0).join(' ');
+
+    if (fileName.isEmpty())
+    {
+        if (st.isRunningScript())
+            st.stopScript();
+        else
+            st.setError("No script running");
+    }
+    else if (st.runScript(fileName, echo))
+    {
+        st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, "Running " + fileName);
+    }
+}
+
+//**********************************************************************************************************************
+void CommandParser::cmdSend(SimpleTerminal &st, const QStringList &args)
+{
+    if (args.isEmpty())
+    {
+        if (st.isSending())
+            st.cancelSend();
+        else
+            st.setError("Not sending");
+
+        return;
+    }
+
+    qint64 bytesPerSec = 0;
+    int lineDelayMs = 0;
+    int i = 0;
+    for (; i + 1 < args.size() && (args[i] == "-r" || args[i] == "-d"); i += 2)
+    {
+        bool ok = false;
+        qint64 value = args[i + 1].toLongLong(&ok);
+        if (!ok || value < 0)
+        {
+            st.setError("Invalid value for " + args[i]);
+            return;
+        }
+
+        if (args[i] == "-r")
+            bytesPerSec = value;
+        else
+            lineDelayMs = static_cast<int>(qMin(value, Q_INT64_C(60000)));
+    }
+
+    QString fileName = args.mid(i).join(' ');
+    if (fileName.isEmpty())
+    {
+        st.setError("Expected a file");
+        return;
+    }
+
+    if (st.sendFile(fileName, bytesPerSec, lineDelayMs))
+        st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, "Sending " + fileName);
 }
 
 //**********************************************************************************************************************
@@ -100,62 +451,248 @@ void CommandParser::cmdSOM(SimpleTerminal &st, const QStringList &args)
     }
 }
 
+//**********************************************************************************************************************
+void CommandParser::cmdFlushRate(SimpleTerminal &st, const QStringList &args)
+{
+    if (args.size() > 0)
+    {
+        bool ok = false;
+        int rate = args[0].toInt(&ok);
+        if (ok && rate > 0)
+            st.setMaxFlushRate(rate);
+        else
+            st.setError("Invalid rate");
+    }
+    else
+    {
+        st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP,
+                         QString("Display flush rate limit: %1/s").arg(st.maxFlushRate()));
+    }
+}
+
+//**********************************************************************************************************************
+void CommandParser::cmdRxEOM(SimpleTerminal &st, const QStringList &args)
+{
+    QStringList delimiters;
+    foreach (const QString &arg, args)
+    {
+        if (!arg.isEmpty())
+            delimiters << unescape(arg);
+    }
+
+    st.setRxEOM(delimiters);
+}
+
+//**********************************************************************************************************************
+void CommandParser::cmdTime(SimpleTerminal &st, const QStringList &args)
+{
+    if (args.size() > 0)
+    {
+        if (!st.setTimestamps(args[0]))
+            st.setError("Expected off, abs or delta");
+    }
+    else
+    {
+        st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, "Timestamps " + st.timestamps());
+    }
+}
+
+//**********************************************************************************************************************
+void CommandParser::cmdTrigger(SimpleTerminal &st, const QStringList &args)
+{
+    if (args.isEmpty())
+    {
+        QList<Trigger> triggers = st.triggers();
+        if (triggers.isEmpty())
+        {
+            st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, "No triggers");
+            return;
+        }
+
+        QString rspStr;
+        QVector<ScrollbackModel::AttrRun> runs;
+        foreach (const Trigger &trigger, triggers)
+        {
+            QString action;
+            switch (trigger.action)
+            {
+                case Trigger::Action::SEND:
+                    action = "send";
+                    break;
+
+                case Trigger::Action::COMMAND:
+                    action = "cmd";
+                    break;
+
+                case Trigger::Action::MARK:
+                    action = "mark";
+                    break;
+            }
+
+            if (!rspStr.isEmpty())
+                rspStr.append("\n");
+
+            SimpleTerminal::TriggerStats stats = st.triggerStats(trigger.name);
+            SimpleTerminal::appendStyled(rspStr, runs, trigger.name, AnsiParser::BOLD);
+            SimpleTerminal::appendStyled(rspStr, runs, QString(" %1 %2 %3: %4 matches")
+                                         .arg(trigger.isRegex ? "/" + trigger.pattern + "/" : trigger.pattern)
+                                         .arg(action).arg(trigger.argument).arg(stats.count), 0);
+
+            if (stats.count > 0)
+            {
+                rspStr.append(QString(", response %1 us mean, %2 us max")
+                              .arg(stats.totalNs / stats.count / 1000).arg(stats.maxNs / 1000));
+            }
+        }
+
+        st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, rspStr, runs);
+        return;
+    }
+
+    if (args.size() == 1)
+    {
+        if (!st.removeTrigger(args[0]))
+            st.setError("No trigger " + args[0]);
+
+        return;
+    }
+
+    if (args.size() < 3)
+    {
+        st.setError("Expected a pattern and an action");
+        return;
+    }
+
+    Trigger trigger;
+    trigger.name = args[0];
+
+    // /pattern/ is a regular expression, which does its own escaping
+    const QString &pattern = args[1];
+    trigger.isRegex = pattern.size() > 2 && pattern.startsWith('/') && pattern.endsWith('/');
+    trigger.pattern = trigger.isRegex ? pattern.mid(1, pattern.size() - 2) : unescape(pattern);
+
+    QString argument = args.mid(3).join(' ');
+    if (args[2] == "send")
+    {
+        trigger.action = Trigger::Action::SEND;
+        trigger.argument = unescape(argument);
+    }
+    else if (args[2] == "cmd")
+    {
+        trigger.action = Trigger::Action::COMMAND;
+        trigger.argument = argument;
+    }
+    else if (args[2] == "mark")
+    {
+        trigger.action = Trigger::Action::MARK;
+    }
+    else
+    {
+        st.setError("Expected send, cmd or mark");
+        return;
+    }
+
+    if ((trigger.action == Trigger::Action::SEND || trigger.action == Trigger::Action::COMMAND) &&
+        trigger.argument.isEmpty())
+    {
+        st.setError("Expected something to " + args[2]);
+        return;
+    }
+
+    st.addTrigger(trigger);
+}
+
 //**********************************************************************************************************************
 void CommandParser::cmdHelp(SimpleTerminal &st, const QStringList &args)
 {
     QString rspStr;
+    QVector<ScrollbackModel::AttrRun> runs;
     if (args.size() > 0)
     {
-        if (cmdHelpMap.contains(args[0]))
+        const Command *cmd = findCommand(QStringRef(&args[0]));
+        if (cmd)
         {
-            QStringList help = cmdHelpMap.value(args[0]);
-            QStringList params(help);
-            params.removeLast();
-            QString helpText = help.last();
+            QString params = QString(cmd->params);
+            QString helpText = QString(cmd->help);
 
             // Command name
-            rspStr.append("<span style=\"color: BlueViolet;\">Usage</span>: " + args[0]);
+            SimpleTerminal::appendStyled(rspStr, runs, "Usage", NAME_ATTR);
+            SimpleTerminal::appendStyled(rspStr, runs, ": " + args[0], 0);
 
             // Parameters
-            rspStr.append("<i>");
-            foreach (const QString &param, params)
+            if (!params.isEmpty())
             {
-                rspStr.append(" " + param);
+                SimpleTerminal::appendStyled(rspStr, runs, " ", 0);
+                SimpleTerminal::appendStyled(rspStr, runs, params, AnsiParser::ITALIC);
             }
-            rspStr.append("</i><br><br>");
+            SimpleTerminal::appendStyled(rspStr, runs, "\n\n", 0);
 
-            // Help text
-            foreach (const QString &param, params)
+            // Help text, with the parameters in it in italics too
+            int pos = 0;
+            int found;
+            while (!params.isEmpty() && (found = helpText.indexOf(params, pos)) >= 0)
             {
-                helpText.replace(param, "<i>" + param + "</i>");
+                SimpleTerminal::appendStyled(rspStr, runs, helpText.mid(pos, found - pos), 0);
+                SimpleTerminal::appendStyled(rspStr, runs, params, AnsiParser::ITALIC);
+                pos = found + params.size();
             }
-            rspStr.append(helpText);
+            SimpleTerminal::appendStyled(rspStr, runs, helpText.mid(pos), 0);
         }
         else
             st.setError("Unknown command");
     }
     else
     {
-        QMap<QString, QStringList>::const_iterator cmd = cmdHelpMap.constBegin();
-        bool isFirst = true; // @todo: Find a better way
-        while (cmd != cmdHelpMap.constEnd())
+        for (const Command &cmd : commands)
         {
-            QStringList help = cmd.value();
-            QString cmdName = cmd.key();
+            if (!rspStr.isEmpty())
+                SimpleTerminal::appendStyled(rspStr, runs, "\n", 0);
 
-            if (isFirst)
-                isFirst = false;
-            else
-                rspStr.append("<br>");
+            SimpleTerminal::appendStyled(rspStr, runs, cmd.name, NAME_ATTR);
+            SimpleTerminal::appendStyled(rspStr, runs, ": " + QString(cmd.help), 0);
+        }
+    }
+
+    if (rspStr.length() > 0)
+        st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, rspStr, runs);
+}
 
-            rspStr.append("<span style=\"color: BlueViolet;\">" + cmdName + "</span>: " + help[1]);
+//**********************************************************************************************************************
+QString CommandParser::unescape(const QString &arg)
+{
+    QString result;
+    for (int i = 0; i < arg.length(); ++i)
+    {
+        if (arg[i] != '\\' || i + 1 >= arg.length())
+        {
+            result.append(arg[i]);
+            continue;
+        }
 
-            ++cmd;
+        QChar esc = arg[++i];
+        if (esc == 'r')
+            result.append('\r');
+        else if (esc == 'n')
+            result.append('\n');
+        else if (esc == 't')
+            result.append('\t');
+        else if (esc == 'x' && i + 2 < arg.length())
+        {
+            bool ok = false;
+            int value = arg.mid(i + 1, 2).toInt(&ok, 16);
+            if (ok)
+            {
+                result.append(QChar(value));
+                i += 2;
+            }
+            else
+                result.append(esc);
         }
+        else
+            result.append(esc);
     }
 
-    if (rspStr.length() > 0)
-        st.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, rspStr);
+    return result;
 }
 
 //**********************************************************************************************************************
@@ -168,19 +705,69 @@ void CommandParser::processCommand(const QString &cmd)
 
     _terminal.modifyDspText(SimpleTerminal::DspType::COMMAND, cmd);
 
-    QStringList cmdList = cmd.split(' '); // Command is first item, parameters are what's left
-    QString cmdName = cmdList[0];
-    cmdList.removeFirst();
-    QStringList &args = cmdList;
-    if (cmdMap.contains(cmdName))
+    // Command is the text up to the first space; it is looked up in place and only its parameters are split
+    int nameEnd = cmd.indexOf(' ');
+    if (nameEnd < 0)
+        nameEnd = cmd.length();
+
+    const Command *command = findCommand(cmd.leftRef(nameEnd));
+    if (!command)
     {
-        CmdFunc cmdFunc = (cmdMap.value(cmdName));
+        _terminal.setError("Invalid command");
+        return;
+    }
 
-        Q_CHECK_PTR(cmdFunc);
-        cmdFunc(_terminal, args);
+    QStringList args;
+    if (!tokenize(cmd.mid(nameEnd), args))
+    {
+        _terminal.setError("Unterminated quote");
+        return;
     }
-    else
+
+    Q_CHECK_PTR(command->func);
+    command->func(_terminal, args);
+}
+
+//**********************************************************************************************************************
+bool CommandParser::tokenize(const QString &line, QStringList &tokens)
+{
+    QString token;
+    bool inToken = false;
+    QChar quote; // Null unless inside quotes
+
+    for (int i = 0; i < line.length(); ++i)
     {
-        _terminal.setError("Invalid command");
+        QChar c = line[i];
+        if (!quote.isNull())
+        {
+            if (c == quote)
+                quote = QChar();
+            else if (quote == '"' && c == '\\' && i + 1 < line.length() && line[i + 1] == '"')
+                token.append(line[++i]);
+            else
+                token.append(c);
+        }
+        else if (c == ' ')
+        {
+            if (inToken)
+            {
+                tokens << token;
+                token.clear();
+                inToken = false;
+            }
+        }
+        else
+        {
+            inToken = true;
+            if (c == '"' || c == '\'')
+                quote = c;
+            else
+                token.append(c);
+        }
     }
+
+    if (inToken)
+        tokens << token;
+
+    return quote.isNull();
 }
@@ -25,9 +25,9 @@
 #ifndef COMMANDPARSER_H
 #define COMMANDPARSER_H
 
-#include <QMap>
 #include <QString>
 #include <QStringList>
+#include <QStringRef>
 
 //**********************************************************************************************************************
 class SimpleTerminal;
@@ -41,19 +41,49 @@ public:
 
     void processCommand(const QString &cmd);
 
-private:
-    SimpleTerminal &_terminal;
+    // Splits line at spaces, appending to tokens. "Double" or 'single' quotes keep spaces in an argument and \" is a
+    // quote inside double quotes; other escapes are left for unescape(). Returns false on an unterminated quote.
+    static bool tokenize(const QString &line, QStringList &tokens);
 
+    // \r, \n, \t and \xHH; \xHH becomes QChar(HH), so take the bytes of the result with toLatin1()
+    static QString unescape(const QString &arg);
+
+private:
     typedef void (*CmdFunc)(SimpleTerminal &, const QStringList &);
-    static const QMap<QString, CmdFunc> cmdMap;
-    static const QMap<QString, QStringList> cmdHelpMap;
+
+    struct Command
+    {
+        const char *name; // Including the '/'
+        CmdFunc func;
+        const char *params;
+        const char *help;
+    };
+
+    static const Command commands[]; // Sorted by name
+    static const Command *findCommand(const QStringRef &name);
+
+    SimpleTerminal &_terminal;
 
     // Commands
+    static void cmdAnsi(SimpleTerminal &st, const QStringList &args);
     static void cmdClear(SimpleTerminal &st, const QStringList &);
     static void cmdConnect(SimpleTerminal &st, const QStringList &args);
     static void cmdDisconnect(SimpleTerminal &st, const QStringList &);
+    static void cmdEncoding(SimpleTerminal &st, const QStringList &args);
+    static void cmdFind(SimpleTerminal &st, const QStringList &args);
+    static void cmdFlushRate(SimpleTerminal &st, const QStringList &args);
+    static void cmdHex(SimpleTerminal &st, const QStringList &args);
+    static void cmdLog(SimpleTerminal &st, const QStringList &args);
+    static void cmdProfile(SimpleTerminal &st, const QStringList &args);
     static void cmdQuit(SimpleTerminal &st, const QStringList &);
+    static void cmdReplay(SimpleTerminal &st, const QStringList &args);
+    static void cmdRun(SimpleTerminal &st, const QStringList &args);
+    static void cmdSend(SimpleTerminal &st, const QStringList &args);
     static void cmdSOM(SimpleTerminal &st, const QStringList &args);
+    static void cmdRxEOM(SimpleTerminal &st, const QStringList &args);
+    static void cmdTime(SimpleTerminal &st, const QStringList &args);
+    static void cmdTrace(SimpleTerminal &st, const QStringList &args);
+    static void cmdTrigger(SimpleTerminal &st, const QStringList &args);
     static void cmdHelp(SimpleTerminal &st, const QStringList &args);
 };
 
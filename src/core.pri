@@ -0,0 +1,53 @@
+# Terminal core shared by the application and the benchmarks: everything except main.cpp, the QML front end and the
+# port watcher.
+
+QT += serialport
+CONFIG += c++17
+
+INCLUDEPATH += $$PWD
+
+# Compile out the TRACE_SPAN markers: qmake CONFIG+=notrace
+notrace: DEFINES += YATERM_NO_TRACE
+
+SOURCES += \
+    $$PWD/simpleterminal.cpp \
+    $$PWD/commandparser.cpp \
+    $$PWD/serialworker.cpp \
+    $$PWD/displaybatcher.cpp \
+    $$PWD/scrollbackmodel.cpp \
+    $$PWD/scrollbackindex.cpp \
+    $$PWD/eomframer.cpp \
+    $$PWD/triggerengine.cpp \
+    $$PWD/capturelogger.cpp \
+    $$PWD/capturereader.cpp \
+    $$PWD/sessionreplayer.cpp \
+    $$PWD/hexdump.cpp \
+    $$PWD/textdecoder.cpp \
+    $$PWD/ansiparser.cpp \
+    $$PWD/terminalline.cpp \
+    $$PWD/clock.cpp \
+    $$PWD/profile.cpp \
+    $$PWD/scriptrunner.cpp \
+    $$PWD/tracer.cpp
+
+HEADERS += \
+    $$PWD/simpleterminal.h \
+    $$PWD/commandparser.h \
+    $$PWD/serialworker.h \
+    $$PWD/spscqueue.h \
+    $$PWD/displaybatcher.h \
+    $$PWD/scrollbackmodel.h \
+    $$PWD/scrollbackindex.h \
+    $$PWD/eomframer.h \
+    $$PWD/triggerengine.h \
+    $$PWD/capturelogger.h \
+    $$PWD/capturereader.h \
+    $$PWD/sessionreplayer.h \
+    $$PWD/hexdump.h \
+    $$PWD/textdecoder.h \
+    $$PWD/ansiparser.h \
+    $$PWD/terminalline.h \
+    $$PWD/clock.h \
+    $$PWD/profile.h \
+    $$PWD/scriptrunner.h \
+    $$PWD/tracer.h
@@ -0,0 +1,177 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "displaybatcher.h"
+#include "tracer.h"
+#include "clock.h"
+
+//**********************************************************************************************************************
+DisplayBatcher::DisplayBatcher(ScrollbackModel &model, QObject *parent) :
+    QObject(parent),
+    _model(model),
+    _appendData(),
+    _appendRuns(),
+    _keep(-1),
+    _frames(),
+    _isMsgOpen(false),
+    _openLen(0),
+    _maxFlushRate(DEFAULT_MAX_FLUSH_RATE),
+    _timer(this),
+    _sinceFlush()
+{
+    QObject::connect(&_timer, SIGNAL(timeout()), this, SLOT(flush()));
+
+    _timer.setSingleShot(true);
+    _timer.setTimerType(Qt::PreciseTimer);
+    _sinceFlush.start();
+}
+
+//**********************************************************************************************************************
+int DisplayBatcher::maxFlushRate() const
+{
+    return _maxFlushRate;
+}
+
+//**********************************************************************************************************************
+void DisplayBatcher::setMaxFlushRate(int rate)
+{
+    _maxFlushRate = qBound(1, rate, 1000);
+}
+
+//**********************************************************************************************************************
+bool DisplayBatcher::isMsgOpen() const
+{
+    return _isMsgOpen;
+}
+
+//**********************************************************************************************************************
+void DisplayBatcher::startMsg(qint64 timestamp)
+{
+    _frames.append({ ScrollbackModel::FrameType::RECEIVED, QByteArray(), timestamp });
+    _isMsgOpen = true;
+    _openLen = 0;
+
+    schedule();
+}
+
+//**********************************************************************************************************************
+void DisplayBatcher::appendMsg(const char *data, int len)
+{
+    if (_frames.isEmpty())
+        _appendData.append(data, len);
+    else
+        _frames.last().data.append(data, len);
+    _openLen += len;
+
+    schedule();
+}
+
+//**********************************************************************************************************************
+void DisplayBatcher::rewriteMsg(int from, const char *data, int len, const ScrollbackModel::AttrRun *runs,
+                                int runCount)
+{
+    QByteArray &pending = _frames.isEmpty() ? _appendData : _frames.last().data;
+    QVector<ScrollbackModel::AttrRun> &pendingRuns = _frames.isEmpty() ? _appendRuns : _frames.last().runs;
+
+    int pendingStart = _openLen - pending.size();
+    if (from < pendingStart)
+    {
+        // Reaches back into what the model already has; it is cut there when flushed
+        _keep = from;
+        pending.clear();
+        pendingRuns.clear();
+    }
+    else
+    {
+        pending.truncate(from - pendingStart);
+        while (!pendingRuns.isEmpty() && static_cast<int>(pendingRuns.last().offset) >= from)
+            pendingRuns.removeLast();
+    }
+
+    pending.append(data, len);
+    for (int i = 0; i < runCount; ++i)
+        pendingRuns.append(runs[i]);
+    _openLen = from + len;
+
+    schedule();
+}
+
+//**********************************************************************************************************************
+void DisplayBatcher::endMsg()
+{
+    _isMsgOpen = false;
+}
+
+//**********************************************************************************************************************
+void DisplayBatcher::newMsg(ScrollbackModel::FrameType type, const QByteArray &data,
+                            const QVector<ScrollbackModel::AttrRun> &runs, qint64 timestamp)
+{
+    _frames.append({ type, data, timestamp < 0 ? Clock::now() : timestamp, runs });
+
+    schedule();
+}
+
+//**********************************************************************************************************************
+void DisplayBatcher::clear()
+{
+    _appendData.clear();
+    _appendRuns.clear();
+    _keep = -1;
+    _frames.clear();
+    _isMsgOpen = false;
+    _openLen = 0;
+
+    _timer.stop();
+}
+
+//**********************************************************************************************************************
+void DisplayBatcher::flush()
+{
+    _timer.stop();
+    _sinceFlush.restart();
+
+    if (_keep < 0 && _appendData.isEmpty() && _frames.isEmpty())
+        return;
+
+    TRACE_SPAN("DisplayBatcher::flush");
+
+    _model.appendBatch({ _keep, _appendData, _appendRuns }, _frames);
+    _appendData.clear();
+    _appendRuns.clear();
+    _keep = -1;
+    _frames.clear();
+
+    emit flushed();
+}
+
+//**********************************************************************************************************************
+void DisplayBatcher::schedule()
+{
+    if (_timer.isActive())
+        return;
+
+    // Flush right away (next event loop pass) if a frame period has already passed since the last flush
+    qint64 remainingMs = 1000 / _maxFlushRate - _sinceFlush.elapsed();
+    _timer.start(remainingMs > 0 ? static_cast<int>(remainingMs) : 0);
+}
@@ -0,0 +1,89 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef DISPLAYBATCHER_H
+#define DISPLAYBATCHER_H
+
+#include "scrollbackmodel.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+
+//**********************************************************************************************************************
+// Coalesces display updates and hands them to the scrollback at most once per display frame.
+//
+// Output is gathered as raw bytes continuing the last (still open) frame plus a list of new frames. Pending output is
+// added to the model in one batch, followed by a single flushed() signal, no more often than maxFlushRate() times per
+// second. The open frame can also be rewritten from any offset on (a terminal line being overwritten); only the
+// changed tail is passed on.
+class DisplayBatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int DEFAULT_MAX_FLUSH_RATE = 60; // Hz
+
+    explicit DisplayBatcher(ScrollbackModel &model, QObject *parent = nullptr);
+
+    int maxFlushRate() const;
+    void setMaxFlushRate(int rate);
+    bool isMsgOpen() const;
+
+    void startMsg(qint64 timestamp); // Clock::now() stamp of the data starting the frame
+    void appendMsg(const char *data, int len);
+    // Replaces the open frame from offset from on with data, which has attribute runs (offsets from the frame start)
+    void rewriteMsg(int from, const char *data, int len, const ScrollbackModel::AttrRun *runs, int runCount);
+    void endMsg();
+    // Clock::now() stamp, now if -1; runs have offsets from the start of data
+    void newMsg(ScrollbackModel::FrameType type, const QByteArray &data,
+                const QVector<ScrollbackModel::AttrRun> &runs = QVector<ScrollbackModel::AttrRun>(),
+                qint64 timestamp = -1);
+    void clear();
+
+signals:
+    void flushed();
+
+public slots:
+    void flush();
+
+private:
+    void schedule();
+
+    ScrollbackModel &_model;
+    QByteArray _appendData; // Continues the last frame already in the model
+    QVector<ScrollbackModel::AttrRun> _appendRuns;
+    int _keep;              // Bytes of the last frame in the model to keep before _appendData, or -1 for all
+    QVector<ScrollbackModel::Frame> _frames;
+    bool _isMsgOpen;
+    int _openLen;           // Bytes of the open frame so far
+
+    int _maxFlushRate;
+    QTimer _timer;
+    QElapsedTimer _sinceFlush;
+};
+
+#endif // DISPLAYBATCHER_H
@@ -0,0 +1,272 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "eomframer.h"
+
+#include <cstring>
+
+//**********************************************************************************************************************
+EomFramer::EomFramer() :
+    EomFramer(QList<QByteArray>())
+{}
+
+//**********************************************************************************************************************
+EomFramer::EomFramer(const QList<QByteArray> &delimiters) :
+    _delimiters(),
+    _state(0),
+    _pendingState(0),
+    _pendingEnd(-1),
+    _chunkStart(0)
+{
+    setDelimiters(delimiters);
+}
+
+//**********************************************************************************************************************
+void EomFramer::setDelimiters(const QList<QByteArray> &delimiters)
+{
+    _delimiters.clear();
+    foreach (const QByteArray &delim, delimiters)
+    {
+        if (!delim.isEmpty() && !_delimiters.contains(delim))
+            _delimiters << delim;
+    }
+
+    build();
+    reset();
+}
+
+//**********************************************************************************************************************
+QList<QByteArray> EomFramer::delimiters() const
+{
+    return _delimiters;
+}
+
+//**********************************************************************************************************************
+void EomFramer::reset()
+{
+    _state = 0;
+    _pendingState = 0;
+    _pendingEnd = -1;
+    _chunkStart = 0;
+}
+
+//**********************************************************************************************************************
+int EomFramer::scan(const QByteArray &chunk, QVector<int> &ends)
+{
+    return scan(chunk.constData(), chunk.size(), ends);
+}
+
+//**********************************************************************************************************************
+int EomFramer::scan(const char *data, int len, QVector<int> &ends)
+{
+    ends.clear();
+
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+    const int *rootNext = _next.constData();
+    int i = 0;
+    while (i < len && !_startBytes.isEmpty())
+    {
+        if (_state == 0 && _pendingEnd < 0)
+        {
+            // Fast path: skip bytes that cannot start a delimiter
+            if (_startBytes.size() == 1)
+            {
+                const void *hit = std::memchr(bytes + i, _startBytes[0], static_cast<size_t>(len - i));
+                if (hit == nullptr)
+                    break;
+
+                i = static_cast<int>(static_cast<const uchar *>(hit) - bytes);
+            }
+            else
+            {
+                while (i < len && rootNext[bytes[i]] == 0)
+                    ++i;
+
+                if (i == len)
+                    break;
+            }
+        }
+
+        step(bytes[i], _chunkStart + i, ends);
+        ++i;
+    }
+
+    _chunkStart += len;
+
+    return ends.size();
+}
+
+//**********************************************************************************************************************
+bool EomFramer::hasPendingMatch() const
+{
+    return _pendingEnd >= 0;
+}
+
+//**********************************************************************************************************************
+void EomFramer::build()
+{
+    _next = QVector<int>(256, -1);
+    _depth = { 0 };
+    _isMatch = { false };
+    _isDelimiter = { false };
+    _canExtend = { false };
+    _prefix = { QByteArray() };
+
+    // Trie of all delimiters
+    foreach (const QByteArray &delim, _delimiters)
+    {
+        int state = 0;
+        foreach (char c, delim)
+        {
+            int idx = state * 256 + static_cast<uchar>(c);
+            if (_next[idx] < 0)
+            {
+                int newState = _depth.size();
+                _next.resize(_next.size() + 256);
+                std::fill(_next.begin() + newState * 256, _next.end(), -1);
+                _next[idx] = newState;
+
+                _depth << _depth[state] + 1;
+                _isMatch << false;
+                _isDelimiter << false;
+                _canExtend << false;
+                _prefix << _prefix[state] + c;
+                _canExtend[state] = true;
+            }
+
+            state = _next[idx];
+        }
+
+        _isMatch[state] = true;
+        _isDelimiter[state] = true;
+    }
+
+    // Fold failure links into the transition table (breadth first, so shorter prefixes are complete first)
+    QVector<int> fail(_depth.size(), 0);
+    QVector<int> queue;
+    for (int b = 0; b < 256; ++b)
+    {
+        int child = _next[b];
+        if (child < 0)
+        {
+            _next[b] = 0;
+        }
+        else
+        {
+            fail[child] = 0;
+            queue << child;
+        }
+    }
+
+    for (int head = 0; head < queue.size(); ++head)
+    {
+        int state = queue[head];
+        if (_isMatch[fail[state]])
+            _isMatch[state] = true; // A shorter delimiter ends here too
+
+        for (int b = 0; b < 256; ++b)
+        {
+            int idx = state * 256 + b;
+            int child = _next[idx];
+            int viaFail = _next[fail[state] * 256 + b];
+            if (child < 0)
+            {
+                _next[idx] = viaFail;
+            }
+            else
+            {
+                fail[child] = viaFail;
+                queue << child;
+            }
+        }
+    }
+
+    _startBytes.clear();
+    for (int b = 0; b < 256; ++b)
+    {
+        if (_next[b] != 0)
+            _startBytes.append(static_cast<char>(b));
+    }
+}
+
+//**********************************************************************************************************************
+void EomFramer::step(uchar byte, qint64 pos, QVector<int> &ends)
+{
+    int next = _next.at(_state * 256 + byte);
+
+    if (_pendingEnd >= 0 && _depth.at(next) != _depth.at(_state) + 1)
+    {
+        // Longer delimiter did not materialise
+        commitPending(ends);
+        step(byte, pos, ends);
+        return;
+    }
+
+    _state = next;
+    if (_pendingEnd >= 0 && !_isDelimiter.at(_state))
+    {
+        // Only a delimiter inside the longer candidate; keep the earlier end, commitPending() rescans this one
+        return;
+    }
+
+    if (_isMatch.at(_state))
+    {
+        if (_canExtend.at(_state))
+        {
+            _pendingState = _state;
+            _pendingEnd = pos + 1;
+        }
+        else
+        {
+            addEnd(pos + 1, ends);
+            _state = 0;
+            _pendingEnd = -1;
+        }
+    }
+}
+
+//**********************************************************************************************************************
+void EomFramer::commitPending(QVector<int> &ends)
+{
+    // End the frame at the shorter match, then rescan whatever was consumed after it while looking for the longer one
+    const QByteArray tail = _prefix.at(_state).mid(_depth.at(_pendingState));
+    qint64 pos = _pendingEnd;
+
+    addEnd(_pendingEnd, ends);
+    _state = 0;
+    _pendingEnd = -1;
+
+    foreach (char c, tail)
+    {
+        step(static_cast<uchar>(c), pos++, ends);
+    }
+}
+
+//**********************************************************************************************************************
+void EomFramer::addEnd(qint64 pos, QVector<int> &ends) const
+{
+    // A match completed by bytes of an earlier chunk can only be reported at the start of this one
+    qint64 offset = pos - _chunkStart;
+    ends.append(offset > 0 ? static_cast<int>(offset) : 0);
+}
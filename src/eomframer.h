@@ -0,0 +1,85 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef EOMFRAMER_H
+#define EOMFRAMER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+
+//**********************************************************************************************************************
+// Incremental end-of-message framer working on raw bytes.
+//
+// Any number of delimiters can be active at once (e.g. CR, LF and CR+LF). The stream is fed chunk by chunk and match
+// state is carried across chunk boundaries, so a delimiter split between two reads is still found. Every byte is
+// examined once through a precomputed transition table; frame boundaries are reported as offsets into the chunk that
+// was passed in, which is never copied.
+//
+// When one delimiter is a prefix of another (CR vs. CR+LF) the longer one wins; the frame end is held back until the
+// next byte shows which one it is (see hasPendingMatch()). A shorter delimiter that ends inside the longer candidate
+// (CR within CR+LF+CR+LF) does not replace the held end; it is found again if the candidate falls through.
+class EomFramer
+{
+public:
+    EomFramer();
+    explicit EomFramer(const QList<QByteArray> &delimiters);
+
+    void setDelimiters(const QList<QByteArray> &delimiters);
+    QList<QByteArray> delimiters() const;
+    void reset();
+
+    // Scan the next chunk of the stream. Offsets one past the end of every delimiter found are written to ends
+    // (which is cleared first), in increasing order. A delimiter that started in an earlier chunk yields offset 0 or
+    // later. Returns the number of frame ends found.
+    int scan(const char *data, int len, QVector<int> &ends);
+    int scan(const QByteArray &chunk, QVector<int> &ends);
+
+    bool hasPendingMatch() const;
+
+private:
+    void build();
+    void step(uchar byte, qint64 pos, QVector<int> &ends);
+    void commitPending(QVector<int> &ends);
+    void addEnd(qint64 pos, QVector<int> &ends) const;
+
+    QList<QByteArray> _delimiters;
+
+    // Automaton (Aho-Corasick with the failure function folded into a full transition table)
+    QVector<int> _next;          // [state * 256 + byte] -> state
+    QVector<int> _depth;         // Length of the prefix spelled by each state
+    QVector<bool> _isMatch;      // Some delimiter ends in this state
+    QVector<bool> _isDelimiter;  // The whole prefix of this state is a delimiter, not just a suffix of it
+    QVector<bool> _canExtend;    // A longer delimiter continues from this state
+    QVector<QByteArray> _prefix; // Bytes spelled by each state
+    QByteArray _startBytes;      // Bytes leaving the root state
+
+    // Stream state
+    int _state;
+    int _pendingState;   // State of a match that may still grow into a longer delimiter
+    qint64 _pendingEnd;  // Stream position of that match's end; -1 if none
+    qint64 _chunkStart;  // Stream position of the chunk being scanned
+};
+
+#endif // EOMFRAMER_H
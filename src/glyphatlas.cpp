@@ -0,0 +1,190 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+#include "glyphatlas.h"
+
+#include <QFontMetricsF>
+#include <QPainter>
+#include <QtMath>
+
+#include <cstring>
+
+//**********************************************************************************************************************
+GlyphAtlas::GlyphAtlas() :
+    _fonts(),
+    _dpr(1),
+    _cellSize(),
+    _cellWidth(1),
+    _cellHeight(1),
+    _ascent(0),
+    _underlineY(0),
+    _lineWidth(1),
+    _image(),
+    _count(0),
+    _version(0),
+    _asciiSlots(),
+    _slots()
+{
+    setFont(QFont("Courier New", 10), 1);
+}
+
+//**********************************************************************************************************************
+void GlyphAtlas::setFont(const QFont &font, qreal devicePixelRatio)
+{
+    // Grayscale antialiasing only; the glyphs are tinted
+    for (int style = 0; style < STYLE_COUNT; ++style)
+    {
+        _fonts[style] = font;
+        _fonts[style].setStyleStrategy(QFont::StyleStrategy(QFont::PreferAntialias | QFont::NoSubpixelAntialias));
+        if (style & BOLD)
+            _fonts[style].setBold(true);
+        if (style & ITALIC)
+            _fonts[style].setItalic(true);
+    }
+
+    // Whole image pixels per cell, so neighbouring slots never bleed into each other
+    QFontMetricsF metrics(_fonts[PLAIN]);
+    _dpr = devicePixelRatio > 0 ? devicePixelRatio : 1;
+    _cellWidth = qMax(1, qCeil(metrics.horizontalAdvance(QLatin1Char('M')) * _dpr));
+    _cellHeight = qMax(1, qCeil(metrics.lineSpacing() * _dpr));
+    _cellSize = QSizeF(_cellWidth / _dpr, _cellHeight / _dpr);
+    _ascent = metrics.ascent();
+    _underlineY = qMin(_ascent + metrics.underlinePos(), _cellSize.height() - 1);
+    _lineWidth = qMax(1.0, metrics.lineWidth());
+
+    _image = QImage(COLUMNS * _cellWidth, INITIAL_ROWS * _cellHeight, QImage::Format_ARGB32_Premultiplied);
+    _image.fill(Qt::transparent);
+    std::memset(_asciiSlots, -1, sizeof(_asciiSlots));
+    _slots.clear();
+
+    // Slot 0: solid
+    QPainter painter(&_image);
+    painter.fillRect(0, 0, _cellWidth, _cellHeight, Qt::white);
+    _count = 1;
+
+    ++_version;
+}
+
+//**********************************************************************************************************************
+const QFont &GlyphAtlas::font() const
+{
+    return _fonts[PLAIN];
+}
+
+//**********************************************************************************************************************
+qreal GlyphAtlas::devicePixelRatio() const
+{
+    return _dpr;
+}
+
+//**********************************************************************************************************************
+QSizeF GlyphAtlas::cellSize() const
+{
+    return _cellSize;
+}
+
+//**********************************************************************************************************************
+qreal GlyphAtlas::underlineY() const
+{
+    return _underlineY;
+}
+
+//**********************************************************************************************************************
+qreal GlyphAtlas::lineWidth() const
+{
+    return _lineWidth;
+}
+
+//**********************************************************************************************************************
+int GlyphAtlas::slot(uint ucs4, int style)
+{
+    if (ucs4 < 128)
+    {
+        int &s = _asciiSlots[style][ucs4];
+        if (s < 0)
+            s = addSlot(ucs4, style);
+
+        return s;
+    }
+
+    quint32 key = ucs4 << 2 | static_cast<quint32>(style);
+    auto it = _slots.constFind(key);
+    if (it != _slots.constEnd())
+        return it.value();
+
+    int s = addSlot(ucs4, style);
+    _slots.insert(key, s);
+    return s;
+}
+
+//**********************************************************************************************************************
+QPointF GlyphAtlas::slotCenter(int slot) const
+{
+    return slotRect(slot).center();
+}
+
+//**********************************************************************************************************************
+QRectF GlyphAtlas::slotRect(int slot) const
+{
+    return QRectF((slot % COLUMNS) * _cellWidth, (slot / COLUMNS) * _cellHeight, _cellWidth, _cellHeight);
+}
+
+//**********************************************************************************************************************
+const QImage &GlyphAtlas::image() const
+{
+    return _image;
+}
+
+//**********************************************************************************************************************
+int GlyphAtlas::version() const
+{
+    return _version;
+}
+
+//**********************************************************************************************************************
+int GlyphAtlas::addSlot(uint ucs4, int style)
+{
+    int row = _count / COLUMNS;
+    if ((row + 1) * _cellHeight > _image.height())
+    {
+        int height = qMin(_image.height() * 2, MAX_HEIGHT - MAX_HEIGHT % _cellHeight);
+        if ((row + 1) * _cellHeight > height)
+            return ucs4 == QChar::ReplacementCharacter ? 0 : slot(QChar::ReplacementCharacter, style);
+
+        // Pixels past the old image come out transparent
+        _image = _image.copy(0, 0, _image.width(), height);
+    }
+
+    int s = _count++;
+    QRectF rect = slotRect(s);
+
+    QPainter painter(&_image);
+    painter.setClipRect(rect);
+    painter.scale(_dpr, _dpr);
+    painter.setFont(_fonts[style]);
+    painter.setPen(Qt::white);
+    painter.drawText(QPointF(rect.x() / _dpr, rect.y() / _dpr + _ascent), QString::fromUcs4(&ucs4, 1));
+
+    ++_version;
+    return s;
+}
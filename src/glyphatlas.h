@@ -0,0 +1,91 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QRectF>
+#include <QSizeF>
+
+//**********************************************************************************************************************
+// Glyphs of one font rasterized once into an image, for TerminalItem to draw text from as textured quads.
+//
+// Every glyph gets a slot of the cell size in a grid of COLUMNS slots per row. The image grows downwards a whole grid
+// row at a time, so a slot never moves and geometry built from it stays valid. Glyphs are white with antialiased alpha
+// and are tinted by the vertex colour when drawn; slot 0 is solid white, for backgrounds, selection and underlines.
+// Characters are drawn one cell wide; wider ones are clipped. Once the image is at its size limit, new characters
+// show as U+FFFD.
+class GlyphAtlas
+{
+public:
+    static const int COLUMNS = 32;
+
+    enum Style
+    {
+        PLAIN = 0,
+        BOLD = 1,
+        ITALIC = 2,
+        STYLE_COUNT = 4
+    };
+
+    GlyphAtlas();
+
+    void setFont(const QFont &font, qreal devicePixelRatio); // Drops all slots
+    const QFont &font() const;
+    qreal devicePixelRatio() const;
+    QSizeF cellSize() const;   // In logical pixels
+    qreal underlineY() const;  // From the top of the cell
+    qreal lineWidth() const;
+
+    int slot(uint ucs4, int style); // Rasterizes the glyph on first use
+    QPointF slotCenter(int slot) const; // In image pixels
+    QRectF slotRect(int slot) const;
+    const QImage &image() const;
+    int version() const;            // Changes whenever image() does
+
+private:
+    static const int INITIAL_ROWS = 8;
+    static const int MAX_HEIGHT = 4096; // Image pixels
+
+    int addSlot(uint ucs4, int style);
+
+    QFont _fonts[STYLE_COUNT];
+    qreal _dpr;
+    QSizeF _cellSize;
+    int _cellWidth;  // Image pixels
+    int _cellHeight;
+    qreal _ascent;
+    qreal _underlineY;
+    qreal _lineWidth;
+
+    QImage _image;
+    int _count;
+    int _version;
+    int _asciiSlots[STYLE_COUNT][128]; // Fast path for the common case; -1 until first use
+    QHash<quint32, int> _slots;        // ucs4 << 2 | style for the rest
+};
+
+#endif // GLYPHATLAS_H
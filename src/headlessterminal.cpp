@@ -0,0 +1,243 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "headlessterminal.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include <unistd.h>
+
+//**********************************************************************************************************************
+void HeadlessTerminal::addOptions(QCommandLineParser &parser)
+{
+    parser.addOptions({
+        { "headless", "Run without a GUI: send stdin lines, stream received data to stdout." },
+        { "profile", "Start from a saved profile (see /profile); --port and --baud override it.", "name" },
+        { "port", "Serial port to connect to; otherwise the last port used headless.", "name" },
+        { "baud", "Baud rate.", "rate" },
+        { "framed", "Write one received frame per line instead of the raw bytes." },
+    });
+}
+
+//**********************************************************************************************************************
+HeadlessTerminal::HeadlessTerminal(const QCommandLineParser &parser, QObject *parent) :
+    QObject(parent),
+    _terminal("headless"),
+    _stdinNotifier(STDIN_FILENO, QSocketNotifier::Read),
+    _input(),
+    _stdout(),
+    _stderr(),
+    _framed(parser.isSet("framed")),
+    _framer(),
+    _frameEnds(),
+    _openFrame(),
+    _framedOut(),
+    _wasConnected(false)
+{
+    _stdout.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered);
+    _stderr.open(stderr, QIODevice::WriteOnly | QIODevice::Unbuffered);
+
+    // Nothing is shown, so keep received data out of the scrollback
+    _terminal.setShowReceived(false);
+
+    if (parser.isSet("profile"))
+        _terminal.loadProfile(parser.value("profile"));
+
+    if (parser.isSet("baud"))
+        _terminal.setBaudRate(parser.value("baud").toInt());
+
+    if (parser.isSet("port"))
+        _terminal.setPort(parser.value("port"));
+
+    updateFramer();
+
+    QObject::connect(&_stdinNotifier, SIGNAL(activated(int)), this, SLOT(readInput()));
+    QObject::connect(&_terminal, SIGNAL(received(QByteArray)), this, SLOT(received(QByteArray)));
+    QObject::connect(_terminal.scrollback(), SIGNAL(rowsInserted(QModelIndex,int,int)),
+                     this, SLOT(rowsInserted(QModelIndex,int,int)));
+    QObject::connect(&_terminal, SIGNAL(connStateChanged()), this, SLOT(connStateChanged()));
+    QObject::connect(&_terminal, SIGNAL(connectFailed()), this, SLOT(connectFailed()));
+    QObject::connect(&_terminal, SIGNAL(eomChanged()), this, SLOT(updateFramer()));
+    QObject::connect(&_terminal, SIGNAL(rxEomChanged()), this, SLOT(updateFramer()));
+}
+
+//**********************************************************************************************************************
+HeadlessTerminal::~HeadlessTerminal()
+{
+    if (!_openFrame.isEmpty())
+    {
+        writeFrame(_openFrame);
+        _stdout.write(_framedOut);
+    }
+}
+
+//**********************************************************************************************************************
+void HeadlessTerminal::start()
+{
+    if (_terminal.getPortName().isEmpty())
+        _stderr.write("No port given; use --port or /connect <port>\n");
+    else
+        _terminal.connect();
+}
+
+//**********************************************************************************************************************
+void HeadlessTerminal::readInput()
+{
+    char buffer[4096];
+    ssize_t n = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+    if (n <= 0)
+    {
+        // End of input; keep streaming received data until /quit or a signal
+        _stdinNotifier.setEnabled(false);
+        if (!_input.isEmpty())
+            _terminal.parseInput(QString::fromLocal8Bit(_input));
+
+        _input.clear();
+        return;
+    }
+
+    _input.append(buffer, static_cast<int>(n));
+
+    int start = 0;
+    int end;
+    while ((end = _input.indexOf('\n', start)) >= 0)
+    {
+        int len = end - start;
+        if (len > 0 && _input.at(end - 1) == '\r')
+            --len;
+
+        _terminal.parseInput(QString::fromLocal8Bit(_input.constData() + start, len));
+        start = end + 1;
+    }
+
+    _input.remove(0, start);
+}
+
+//**********************************************************************************************************************
+void HeadlessTerminal::received(const QByteArray &data)
+{
+    if (_framed)
+        writeFramed(data);
+    else
+        _stdout.write(data);
+}
+
+//**********************************************************************************************************************
+void HeadlessTerminal::rowsInserted(const QModelIndex &, int first, int last)
+{
+    // Received data never gets here; only what the GUI would show around it
+    const ScrollbackModel &model = *_terminal.scrollback();
+    for (int row = first; row <= last; ++row)
+    {
+        switch (model.frameType(row))
+        {
+            case ScrollbackModel::FrameType::COMMAND_RSP:
+                _stderr.write(QString::fromUtf8(model.frameData(row)).toLocal8Bit() + "\n");
+                break;
+
+            case ScrollbackModel::FrameType::ERROR:
+                _stderr.write("ERROR: " + QString::fromUtf8(model.frameData(row)).toLocal8Bit() + "\n");
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+//**********************************************************************************************************************
+void HeadlessTerminal::connStateChanged()
+{
+    if (_terminal.isConnected())
+        _wasConnected = true;
+}
+
+//**********************************************************************************************************************
+void HeadlessTerminal::connectFailed()
+{
+    // A port that cannot be opened at startup is fatal for scripted use
+    if (!_wasConnected)
+    {
+        _stderr.write("ERROR: Could not open " + _terminal.getPortName().toLocal8Bit() + "\n");
+        QCoreApplication::exit(1);
+    }
+}
+
+//**********************************************************************************************************************
+void HeadlessTerminal::updateFramer()
+{
+    QList<QByteArray> delimiters;
+    QStringList rxEom = _terminal.getRxEOM();
+    if (rxEom.isEmpty())
+        rxEom << _terminal.getEOM();
+
+    foreach (const QString &eom, rxEom)
+    {
+        delimiters << eom.toLatin1();
+    }
+
+    _framer.setDelimiters(delimiters);
+}
+
+//**********************************************************************************************************************
+void HeadlessTerminal::writeFramed(const QByteArray &data)
+{
+    _framer.scan(data, _frameEnds);
+
+    int start = 0;
+    foreach (int end, _frameEnds)
+    {
+        _openFrame.append(data.constData() + start, end - start);
+        writeFrame(_openFrame);
+        _openFrame.clear();
+
+        start = end;
+    }
+
+    _openFrame.append(data.constData() + start, data.size() - start);
+    if (_openFrame.size() >= MAX_FRAME_BYTES)
+    {
+        writeFrame(_openFrame);
+        _openFrame.clear();
+    }
+
+    _stdout.write(_framedOut);
+    _framedOut.clear();
+}
+
+//**********************************************************************************************************************
+void HeadlessTerminal::writeFrame(const QByteArray &frame)
+{
+    // Replace whichever EOM ended the frame (longest first) with a newline
+    int eomLen = 0;
+    foreach (const QByteArray &eom, _framer.delimiters())
+    {
+        if (eom.size() > eomLen && frame.endsWith(eom))
+            eomLen = eom.size();
+    }
+
+    _framedOut.append(frame.constData(), frame.size() - eomLen);
+    _framedOut.append('\n');
+}
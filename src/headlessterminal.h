@@ -0,0 +1,86 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef HEADLESSTERMINAL_H
+#define HEADLESSTERMINAL_H
+
+#include <QObject>
+#include <QFile>
+#include <QSocketNotifier>
+#include <QByteArray>
+#include <QVector>
+
+#include "simpleterminal.h"
+#include "eomframer.h"
+
+class QCommandLineParser;
+
+//**********************************************************************************************************************
+// yaTerm without a GUI (--headless): lines from stdin go through SimpleTerminal::parseInput() (so commands work as in
+// the input window) and received data is streamed to stdout, either raw or one frame per line with the EOM replaced
+// by a newline. Command responses and errors go to stderr as plain text.
+//
+// Received data bypasses the scrollback and its formatting entirely. Settings are kept apart from the GUI sessions.
+class HeadlessTerminal : public QObject
+{
+    Q_OBJECT
+
+public:
+    static void addOptions(QCommandLineParser &parser);
+
+    explicit HeadlessTerminal(const QCommandLineParser &parser, QObject *parent = nullptr);
+    ~HeadlessTerminal();
+
+    void start();
+
+private slots:
+    void readInput();
+    void received(const QByteArray &data);
+    void rowsInserted(const QModelIndex &parent, int first, int last);
+    void connStateChanged();
+    void connectFailed();
+    void updateFramer();
+
+private:
+    static const int MAX_FRAME_BYTES = 4096; // Unterminated frames are cut here, as in the display
+
+    void writeFramed(const QByteArray &data);
+    void writeFrame(const QByteArray &frame);
+
+    SimpleTerminal _terminal;
+    QSocketNotifier _stdinNotifier;
+    QByteArray _input;
+    QFile _stdout;
+    QFile _stderr;
+
+    bool _framed;
+    EomFramer _framer;
+    QVector<int> _frameEnds;
+    QByteArray _openFrame;
+    QByteArray _framedOut; // One write per received chunk
+
+    bool _wasConnected;
+};
+
+#endif // HEADLESSTERMINAL_H
@@ -0,0 +1,129 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "hexdump.h"
+
+#include <QByteArray>
+
+#include <cstring>
+
+namespace
+{
+    //******************************************************************************************************************
+    // Per-byte output, built once
+    struct Tables
+    {
+        char hex[256][2];
+        char gutter[256];
+
+        Tables()
+        {
+            static const char digits[] = "0123456789abcdef";
+
+            for (int b = 0; b < 256; ++b)
+            {
+                hex[b][0] = digits[b >> 4];
+                hex[b][1] = digits[b & 0xf];
+                gutter[b] = b >= 0x20 && b < 0x7f ? static_cast<char>(b) : '.';
+            }
+        }
+    };
+
+    //******************************************************************************************************************
+    const Tables &tables()
+    {
+        static const Tables t;
+        return t;
+    }
+
+    //******************************************************************************************************************
+    QString dump(const char *data, int len)
+    {
+        const int BYTES_PER_LINE = HexDump::BYTES_PER_LINE;
+
+        if (len <= 0)
+            return QString();
+
+        // "\n" + offset + hex columns + gutter
+        const int LINE_LEN = 1 + 8 + 2 + BYTES_PER_LINE * 3 + 1 + 2 + BYTES_PER_LINE;
+
+        const Tables &t = tables();
+        const uchar *bytes = reinterpret_cast<const uchar *>(data);
+        int lines = (len + BYTES_PER_LINE - 1) / BYTES_PER_LINE;
+
+        QByteArray out;
+        out.resize(lines * LINE_LEN);
+        char *p = out.data();
+
+        for (int offset = 0; offset < len; offset += BYTES_PER_LINE)
+        {
+            int n = qMin(BYTES_PER_LINE, len - offset);
+
+            if (offset > 0)
+                *p++ = '\n';
+
+            // Offset
+            for (int shift = 28; shift >= 0; shift -= 4)
+                *p++ = t.hex[(offset >> shift) & 0xf][1];
+
+            *p++ = ' ';
+            *p++ = ' ';
+
+            // Hex bytes; short last line is padded so the gutter lines up
+            for (int i = 0; i < BYTES_PER_LINE; ++i)
+            {
+                if (i < n)
+                {
+                    std::memcpy(p, t.hex[bytes[offset + i]], 2);
+                }
+                else
+                {
+                    p[0] = ' ';
+                    p[1] = ' ';
+                }
+                p[2] = ' ';
+                p += 3;
+
+                if (i == BYTES_PER_LINE / 2 - 1)
+                    *p++ = ' ';
+            }
+
+            // ASCII gutter
+            *p++ = '|';
+            for (int i = 0; i < n; ++i)
+                *p++ = t.gutter[bytes[offset + i]];
+            *p++ = '|';
+        }
+
+        out.resize(static_cast<int>(p - out.data()));
+
+        return QString::fromLatin1(out);
+    }
+}
+
+//**********************************************************************************************************************
+QString HexDump::toText(const char *data, int len)
+{
+    return dump(data, len);
+}
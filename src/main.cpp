@@ -22,34 +22,82 @@
  * SOFTWARE.
 ******************************************************************************/
 
-#include "simpleterminal.h"
+#include "sessionmanager.h"
 #include "portswatcher.h"
+#include "tracer.h"
+#include "headlessterminal.h"
+#include "startupreport.h"
+#include "profile.h"
+#include "terminalitem.h"
 
 #include <QApplication>
+#include <QCoreApplication>
+#include <QCommandLineParser>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QQmlEngine>
+#include <QQuickWindow>
 #include <QIcon>
 #include <QDebug>
 #include <QList>
 #include <QSerialPort>
 #include <QSerialPortInfo>
 
+//**********************************************************************************************************************
+static int runHeadless(int argc, char *argv[])
+{
+    // No QApplication and no QML
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Yet another serial terminal");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    HeadlessTerminal::addOptions(parser);
+    parser.process(app);
+
+    HeadlessTerminal terminal(parser);
+    terminal.start();
+
+    return app.exec();
+}
+
 //**********************************************************************************************************************
 int main(int argc, char *argv[])
 {
-    QApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("No Org");
+    QCoreApplication::setOrganizationDomain("noorg.org");
+    QCoreApplication::setApplicationName("yaTerm");
+    QCoreApplication::setApplicationVersion("0.3.0");
+
+    StartupReport startupReport;
 
-    app.setOrganizationName("No Org");
-    app.setOrganizationDomain("noorg.org");
-    app.setApplicationName("yaTerm");
-    app.setApplicationVersion("0.3.0");
+    for (int i = 1; i < argc; ++i)
+    {
+        if (qstrcmp(argv[i], "--headless") == 0)
+            return runHeadless(argc, argv);
+    }
+
+    QApplication app(argc, argv);
     app.setWindowIcon(QIcon(":/images/icon.svg"));
 
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Yet another serial terminal");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOptions({
+        { "connect", "Connect every session that has a port once the window is up." },
+        { "startup-report", "Print the time to QML loaded, first frame and first port open." },
+    });
+    HeadlessTerminal::addOptions(parser);
+    parser.process(app);
+
+    startupReport.setEnabled(parser.isSet("startup-report"));
+
     QQmlApplicationEngine engine;
 
-    QStringList portsListModel;
-    PortsWatcher portsWatcher(engine, portsListModel, &app);
-    portsWatcher.generatePortsList();
+    // Ports are listed once the first frame is up
+    PortsWatcher portsWatcher(&app);
 
     // @todo: Will standard baud rates change with selected serial port?
     QList<QVariant> standardBaudRates = { QSerialPort::Baud1200,
@@ -67,25 +115,59 @@ int main(int argc, char *argv[])
 //        standardBaudRates.append(rate);
 //    }
 
-    QSerialPort serialPort;
-    SimpleTerminal *simpleTerminal = new SimpleTerminal(&serialPort, &app);
+    SessionManager *sessionManager = new SessionManager(&app);
 
-    engine.rootContext()->setContextProperty("serialPort", &serialPort);
-    engine.rootContext()->setContextProperty("simpleTerminal", simpleTerminal);
+    engine.rootContext()->setContextProperty("sessionManager", sessionManager);
+    engine.rootContext()->setContextProperty("portsListModel", portsWatcher.model());
     engine.rootContext()->setContextProperty("baudListModel", QVariant::fromValue(standardBaudRates));
+    engine.rootContext()->setContextProperty("tracer", Tracer::instance());
+    engine.rootContext()->setContextProperty("profileStore", ProfileStore::instance());
+
+    qmlRegisterType<TerminalItem>("yaTerm", 1, 0, "TerminalItem");
 
     engine.load(QUrl("qrc:/src/main.qml"));
+    startupReport.mark("QML loaded");
 
     QObject *item = engine.rootObjects().value(0);
     Q_CHECK_PTR(item);
 
-    QObject::connect(item, SIGNAL(consoleInputEntered(QString)), simpleTerminal, SLOT(parseInput(QString)));
-    QObject::connect(item, SIGNAL(connect()), simpleTerminal, SLOT(connect()));
-    QObject::connect(item, SIGNAL(disconnect()), simpleTerminal, SLOT(disconnect()));
-    QObject::connect(item, SIGNAL(newPort(QString)), simpleTerminal, SLOT(setPort(QString)));
 //    QObject::connect(item, SIGNAL(settingsChanged()), simpleTerminal, SLOT(settingsChanged()));
 
-    portsWatcher.start();
+    // Render and swap happen on the scene graph thread; trace them there
+    QQuickWindow *window = qobject_cast<QQuickWindow *>(item);
+    if (window)
+    {
+        QObject::connect(window, SIGNAL(beforeRendering()), Tracer::instance(), SLOT(renderBegin()),
+                         Qt::DirectConnection);
+        QObject::connect(window, SIGNAL(frameSwapped()), Tracer::instance(), SLOT(renderEnd()),
+                         Qt::DirectConnection);
+
+        startupReport.watch(window);
+    }
+
+    for (int i = 0; i < sessionManager->rowCount(); ++i)
+    {
+        startupReport.watch(sessionManager->session(i));
+    }
+
+    // Everything not needed for the first frame
+    bool connectSessions = parser.isSet("connect");
+    QObject::connect(&startupReport, &StartupReport::firstFrameShown, [&]() {
+        portsWatcher.start();
+
+        if (connectSessions)
+        {
+            for (int i = 0; i < sessionManager->rowCount(); ++i)
+            {
+                SimpleTerminal *terminal = sessionManager->session(i);
+                if (!terminal->getPortName().isEmpty())
+                    terminal->connect();
+            }
+        }
+    });
+
+    if (!window)
+        portsWatcher.start();
 
     return app.exec();
 }
@@ -27,6 +27,7 @@ import QtQuick.Controls 1.6
 import QtQuick.Layouts 1.11
 import QtQuick.Dialogs 1.3
 import Qt.labs.settings 1.0
+import QtQml 2.2
 
 ApplicationWindow {
     id: root
@@ -36,15 +37,19 @@ ApplicationWindow {
 
     title: Qt.application.name
 
-    signal consoleInputEntered(string msg)
-    signal connect();
-    signal disconnect();
-    signal newPort(string port);
+    // Session of the current tab; everything outside the tabs acts on it
+    property QtObject simpleTerminal: sessionManager.current
+
+    property bool autoscroll: true
+    property int wrapMode: TextEdit.WrapAtWordBoundaryOrAnywhere
+    property font consoleFont: Qt.font({ family: "Courier New", pointSize: 10, weight: Font.Normal })
+
     signal settingsChanged();
 
-    function inputEntered() {
-        consoleInputEntered(consoleInput.text)
-        consoleInput.text = ""
+    // Dialogs are loaded on first use
+    function dialog(loader) {
+        loader.active = true
+        return loader.item
     }
 
     Settings {
@@ -60,14 +65,48 @@ ApplicationWindow {
         Menu {
             title: qsTr("&File")
 
+            MenuItem {
+                text: qsTr("&New Session")
+                shortcut: "Ctrl+T"
+                onTriggered: sessionTabs.currentIndex = sessionManager.addSession()
+            }
+
+            MenuItem {
+                text: qsTr("Close Sessi&on")
+                shortcut: "Ctrl+W"
+                enabled: sessionManager.count > 1
+                onTriggered: sessionManager.removeSession(sessionTabs.currentIndex)
+            }
+
+            MenuSeparator {}
+
             MenuItem {
                 text: { simpleTerminal.connState ? qsTr("&Disconnect") : qsTr("&Connect") }
-                onTriggered: { simpleTerminal.connState ? root.disconnect() : root.connect()}
+                onTriggered: { simpleTerminal.connState ? simpleTerminal.disconnect() : simpleTerminal.connect() }
+            }
+
+            Menu {
+                id: profilesMenu
+                title: qsTr("&Profiles")
+                enabled: profileStore.names.length > 0
+
+                // Save with /profile save <name>
+                Instantiator {
+                    model: profileStore.names
+
+                    MenuItem {
+                        text: modelData
+                        onTriggered: simpleTerminal.loadProfile(modelData)
+                    }
+
+                    onObjectAdded: profilesMenu.insertItem(index, object)
+                    onObjectRemoved: profilesMenu.removeItem(object)
+                }
             }
 
             MenuItem {
                 text: qsTr("&Settings...")
-                onTriggered: settingsDialog.open()
+                onTriggered: dialog(settingsDialog).open()
                 enabled: !simpleTerminal.connState
             }
 
@@ -82,23 +121,28 @@ ApplicationWindow {
 
             MenuItem {
                 text: qsTr("&Autoscroll")
-                onTriggered: { consoleOutput.autoscroll = !consoleOutput.autoscroll }
-                checked: consoleOutput.autoscroll
+                onTriggered: { root.autoscroll = !root.autoscroll }
+                checked: root.autoscroll
                 checkable: true
             }
 
             MenuItem {
                 text: qsTr("&Clear")
-                onTriggered: {
-                    consoleOutput.remove(0, consoleOutput.length)
-                }
+                onTriggered: simpleTerminal.clearDisplay()
+            }
+
+            MenuItem {
+                text: qsTr("F&ind...")
+                shortcut: "Ctrl+F"
+                onTriggered: sessionTabs.getTab(sessionTabs.currentIndex).item.showFind()
             }
 
             MenuItem {
                 text: qsTr("&Font...")
                 onTriggered: {
-                    fontDialog.font = consoleOutput.font
-                    fontDialog.open()
+                    var d = dialog(fontDialog)
+                    d.font = root.consoleFont
+                    d.open()
                 }
             }
 
@@ -113,13 +157,87 @@ ApplicationWindow {
 //                checkable: true
 //            }
 
+            MenuItem {
+                text: qsTr("&Hex Dump")
+                onTriggered: { simpleTerminal.hexMode = !simpleTerminal.hexMode }
+                checked: simpleTerminal.hexMode
+                checkable: true
+            }
+
+            MenuItem {
+                text: qsTr("&ANSI Colours")
+                onTriggered: { simpleTerminal.ansi = !simpleTerminal.ansi }
+                checked: simpleTerminal.ansi
+                checkable: true
+            }
+
+            Menu {
+                title: qsTr("&Timestamps")
+
+                ExclusiveGroup { id: timestampGroup }
+
+                MenuItem {
+                    text: qsTr("&Off")
+                    checkable: true
+                    exclusiveGroup: timestampGroup
+                    checked: simpleTerminal.timestamps === "off"
+                    onTriggered: simpleTerminal.timestamps = "off"
+                }
+
+                MenuItem {
+                    text: qsTr("&Time of Day")
+                    checkable: true
+                    exclusiveGroup: timestampGroup
+                    checked: simpleTerminal.timestamps === "abs"
+                    onTriggered: simpleTerminal.timestamps = "abs"
+                }
+
+                MenuItem {
+                    text: qsTr("&Since Previous Line")
+                    checkable: true
+                    exclusiveGroup: timestampGroup
+                    checked: simpleTerminal.timestamps === "delta"
+                    onTriggered: simpleTerminal.timestamps = "delta"
+                }
+            }
+
+            Menu {
+                title: qsTr("&Encoding")
+
+                ExclusiveGroup { id: encodingGroup }
+
+                MenuItem {
+                    text: qsTr("&UTF-8")
+                    checkable: true
+                    exclusiveGroup: encodingGroup
+                    checked: simpleTerminal.encoding === "utf8"
+                    onTriggered: simpleTerminal.encoding = "utf8"
+                }
+
+                MenuItem {
+                    text: qsTr("&Latin-1")
+                    checkable: true
+                    exclusiveGroup: encodingGroup
+                    checked: simpleTerminal.encoding === "latin1"
+                    onTriggered: simpleTerminal.encoding = "latin1"
+                }
+
+                MenuItem {
+                    text: qsTr("&Raw (ASCII)")
+                    checkable: true
+                    exclusiveGroup: encodingGroup
+                    checked: simpleTerminal.encoding === "raw"
+                    onTriggered: simpleTerminal.encoding = "raw"
+                }
+            }
+
             MenuItem {
                 text : qsTr("&Wrap")
                 onTriggered: {
-                    consoleOutput.wrapMode = consoleOutput.wrapMode == TextEdit.NoWrap ?
+                    root.wrapMode = root.wrapMode == TextEdit.NoWrap ?
                                 TextEdit.WrapAtWordBoundaryOrAnywhere : TextEdit.NoWrap
                 }
-                checked: consoleOutput.wrapMode == TextEdit.WrapAtWordBoundaryOrAnywhere
+                checked: root.wrapMode == TextEdit.WrapAtWordBoundaryOrAnywhere
                 checkable: true
             }
 
@@ -130,7 +248,7 @@ ApplicationWindow {
 
             MenuItem {
                 text: qsTr("&About...")
-                onTriggered: aboutDialog.open()
+                onTriggered: dialog(aboutDialog).open()
             }
 
             MenuItem {
@@ -151,6 +269,17 @@ ApplicationWindow {
                 font.wordSpacing: 5.0
             }
 
+            Label {
+                id: scrollbackUsage
+
+                // Memory held by the scrollback, and how much smaller its packed part is
+                property QtObject scrollback: simpleTerminal.scrollback
+                text: qsTr("Scrollback %1 MB (%2:1)").arg((scrollback.residentBytes / (1024 * 1024)).toFixed(1))
+                                                       .arg(scrollback.compressionRatio.toFixed(1))
+                color: "gray"
+                horizontalAlignment: Text.AlignRight
+            }
+
             Label {
                 id: error
                 color: "red"
@@ -160,476 +289,444 @@ ApplicationWindow {
         }
     }
 
-    TextField {
-        id: consoleInput
-
-        anchors.left: parent.left
-        anchors.right: parent.right
-        anchors.bottom: parent.bottom
-
-        placeholderText: "Enter command or text to send followed by Enter"
-
-        Keys.onEnterPressed: root.inputEntered()
-        Keys.onReturnPressed: root.inputEntered()
-        Keys.onUpPressed: { text = simpleTerminal.getPrevHistory() }
-        Keys.onDownPressed: { text = simpleTerminal.getNextHistory() }
-        Keys.onEscapePressed: {
-            text = ""
-            simpleTerminal.resetHistoryIdx()
-        }
-
-        KeyNavigation.tab: consoleOutput
-        focus: true
-        font: consoleOutput.font
-    }
-
-    TextArea {
-        id: consoleOutput
-
-        property bool autoscroll: true
-
-        menu: null
-
-        anchors.left: parent.left
-        anchors.right: parent.right
-        anchors.bottom: consoleInput.top
-        anchors.top: parent.top
-
-        KeyNavigation.tab: consoleInput
-
-        Connections {
-            target: simpleTerminal
-
-            onStartMsg: {
-                consoleOutput.coerce_length()
-
-                consoleOutput.append("<span>")
-                simpleTerminal.is_msg_open = true
-
-                consoleOutput.auto_scroll()
-            }
-
-            onEndMsg: {
-                consoleOutput.coerce_length()
-
-                consoleOutput.insert(consoleOutput.length, "</span>")
-                simpleTerminal.is_msg_open = false
-
-                consoleOutput.auto_scroll()
-            }
-
-            onAppendMsg: {
-                consoleOutput.coerce_length()
-
-                consoleOutput.insert(consoleOutput.length, text)
-
-                consoleOutput.auto_scroll()
-            }
-
-            onNewMsg: {
-                consoleOutput.coerce_length()
+    TabView {
+        id: sessionTabs
 
-                consoleOutput.append(text)
+        anchors.fill: parent
+        tabsVisible: count > 1
+        frameVisible: false
 
-                consoleOutput.auto_scroll()
-            }
-
-            onClearDisplayText: {
-                consoleOutput.remove(0, consoleOutput.length)
-            }
-        }
+        onCurrentIndexChanged: sessionManager.currentIndex = currentIndex
 
-        readOnly: true
-        textFormat: TextEdit.RichText
-        wrapMode: TextEdit.WrapAtWordBoundaryOrAnywhere
+        Repeater {
+            model: sessionManager
 
-        font.family: "Courier New"
-        font.pointSize: 10
-        font.weight: Font.Normal
+            // Views of background sessions are created when first shown
+            Tab {
+                id: sessionTab
+                title: model.title
 
-        function coerce_length() {
-            if (consoleOutput.length > simpleTerminal.maxDspTxtChars) {
-                consoleOutput.remove(0, consoleOutput.length - simpleTerminal.maxDspTxtChars)
-            }
-        }
+                property QtObject terminal: model.terminal
 
-        function auto_scroll() {
-            if (consoleOutput.autoscroll) {
-                consoleOutput.cursorPosition = consoleOutput.length
+                TerminalView {
+                    terminal: sessionTab.terminal
+                    autoscroll: root.autoscroll
+                    wrapMode: root.wrapMode
+                    font: root.consoleFont
+                }
             }
         }
+    }
 
-        Settings {
-            category: "ConsoleOutput"
-            property alias fontFamily: consoleOutput.font.family
-            property alias fontPointSize: consoleOutput.font.pointSize
-            property alias fontWeight: consoleOutput.font.weight
-        }
-
+    Settings {
+        category: "ConsoleOutput"
+        property alias fontFamily: root.consoleFont.family
+        property alias fontPointSize: root.consoleFont.pointSize
+        property alias fontWeight: root.consoleFont.weight
     }
 
-    MessageDialog {
+    // Dialogs are created the first time they are opened
+    Loader {
         id: aboutDialog
-        icon: StandardIcon.Information
-        modality: Qt.ApplicationModal
-        text: { "<p><strong>y</strong>et <strong>a</strong>nother Serial "+ "<strong>Term</strong>inal " +
-                Qt.application.version + "</p>" +
-                "<p><em>by Wesley Graba</em></p>" +
-                "<p><a href=\"https://github.com/wgraba/yaTerm/blob/master/LICENSE.md\">License</a></p>" +
-                "<p><a href=\"https://github.com/wgraba/yaTerm\">GitHub project</a></p>" +
-                "<p>The program is provided AS IS with NO WARRANTY OF ANY KIND.</p>" }
-        title: qsTr("About ") + Qt.application.name
+        active: false
+
+        sourceComponent: Component {
+            MessageDialog {
+                icon: StandardIcon.Information
+                modality: Qt.ApplicationModal
+                text: { "<p><strong>y</strong>et <strong>a</strong>nother Serial "+ "<strong>Term</strong>inal " +
+                        Qt.application.version + "</p>" +
+                        "<p><em>by Wesley Graba</em></p>" +
+                        "<p><a href=\"https://github.com/wgraba/yaTerm/blob/master/LICENSE.md\">License</a></p>" +
+                        "<p><a href=\"https://github.com/wgraba/yaTerm\">GitHub project</a></p>" +
+                        "<p>The program is provided AS IS with NO WARRANTY OF ANY KIND.</p>" }
+                title: qsTr("About ") + Qt.application.name
+            }
+        }
     }
 
-    Dialog {
+    // Settings from the dialog are applied to the current session
+    Loader {
         id: settingsDialog
-        modality: Qt.WindowModal
-        standardButtons: StandardButton.Ok | StandardButton.Cancel
-        title: qsTr("Settings")
-        width: settingsLayout.width + 50
-
-        onVisibleChanged: {
-            if (visible) {
-                // Ports
-                portCombo.currentIndex = portCombo.find(simpleTerminal.getPortName())
-
-                // Baud Rate
-                baudRateCombo.currentIndex = baudRateCombo.find((serialPort.baudRate).toString())
-
-                // Data Bits
-                dataBitsCombo.currentIndex = dataBitsCombo.find((serialPort.dataBits).toString())
-
-                // Parity
-                switch (serialPort.parity)
-                {
-                    default:
-                    case 0:
-                        parityCombo.currentIndex = 0
-                        break
-
-                    case 2:
-                        parityCombo.currentIndex = 1
-                        break
-
-                    case 3:
-                        parityCombo.currentIndex = 2
-                        break
-
-                }
-
-                // Stop bits
-                switch (serialPort.stopBits)
-                {
-                    default:
-                    case 1:
-                        stopCombo.currentIndex = 0
-                        break
-
-                    case 3:
-                        stopCombo.currentIndex = 1
-                        break
-
-                    case 2:
-                        stopCombo.currentIndex = 2
-                        break
+        active: false
+
+        sourceComponent: Component {
+            Dialog {
+                modality: Qt.WindowModal
+                standardButtons: StandardButton.Ok | StandardButton.Cancel
+                title: qsTr("Settings")
+                width: settingsLayout.width + 50
+
+                onVisibleChanged: {
+                    if (visible) {
+                        // Ports
+                        portCombo.currentIndex = portCombo.find(simpleTerminal.getPortName())
+
+                        // Baud Rate
+                        baudRateCombo.currentIndex = baudRateCombo.find((simpleTerminal.baudRate).toString())
+
+                        // Data Bits
+                        dataBitsCombo.currentIndex = dataBitsCombo.find((simpleTerminal.dataBits).toString())
+
+                        // Parity
+                        switch (simpleTerminal.parity)
+                        {
+                            default:
+                            case 0:
+                                parityCombo.currentIndex = 0
+                                break
+
+                            case 2:
+                                parityCombo.currentIndex = 1
+                                break
+
+                            case 3:
+                                parityCombo.currentIndex = 2
+                                break
+
+                        }
+
+                        // Stop bits
+                        switch (simpleTerminal.stopBits)
+                        {
+                            default:
+                            case 1:
+                                stopCombo.currentIndex = 0
+                                break
+
+                            case 3:
+                                stopCombo.currentIndex = 1
+                                break
+
+                            case 2:
+                                stopCombo.currentIndex = 2
+                                break
+                        }
+
+                        // Flow control
+                        switch (simpleTerminal.flowControl)
+                        {
+                            default:
+                            case 0:
+                                flowCombo.currentIndex = 0
+                                break
+
+                            case 1:
+                                flowCombo.currentIndex = 1
+                                break
+
+                            case 2:
+                                flowCombo.currentIndex = 2
+                                break
+                        }
+
+                        // SOM
+                        switch (simpleTerminal.som)
+                        {
+                            case "":
+                                somCombo.currentIndex = 0
+                                break
+
+                            case "@":
+                                somCombo.currentIndex = 1
+                                break
+
+                            case "#":
+                                somCombo.currentIndex = 2
+                                break
+
+                            default:
+                                somCombo.currentIndex = 3
+                                somCustom.text = simpleTerminal.som
+                                break
+                        }
+
+                        // EOM
+                        switch (simpleTerminal.eom)
+                        {
+                            case "\r":
+                                eomCombo.currentIndex = 0
+                                break
+
+                            case "\n":
+                                eomCombo.currentIndex = 1
+                                break
+
+                            case "\r\n":
+                                eomCombo.currentIndex = 2
+                                break
+
+                            case "":
+                                eomCombo.currentIndex = 3
+                                break
+
+                            default:
+                                eomCombo.currentIndex = 4
+                                eomCustom.text = simpleTerminal.eom
+                                break
+                        }
+
+                    }
                 }
 
-                // Flow control
-                switch (serialPort.flowControl)
-                {
-                    default:
-                    case 0:
-                        flowCombo.currentIndex = 0
-                        break
-
-                    case 1:
-                        flowCombo.currentIndex = 1
-                        break
-
-                    case 2:
-                        flowCombo.currentIndex = 2
-                        break
+                onAccepted: {
+                    console.log("Applying new settings: " + portCombo.currentText + " " + baudRateCombo.currentText + " " +
+                                dataBitsCombo.currentText + " " + parityCombo.currentText + " " + stopCombo.currentText + " " +
+                                flowCombo.currentText + " " + somCombo.currentText + " " + eomCombo.currentText)
+
+                    // Baud rate
+                    simpleTerminal.baudRate = baudRateCombo.currentText
+
+                    // Data bits
+                    simpleTerminal.dataBits = "Data" + dataBitsCombo.currentText
+
+                    // Parity
+                    switch (parityCombo.currentIndex)
+                    {
+                        case 0:
+                            simpleTerminal.parity = "NoParity"
+                            break
+
+                        case 1:
+                            simpleTerminal.parity = "EvenParity"
+                            break
+
+                        case 2:
+                            simpleTerminal.parity = "OddParity"
+                            break
+
+                         default:
+                             simpleTerminal.parity = "UnknownParity"
+                             break
+                    }
+
+                    // Stop bits
+                    switch (stopCombo.currentIndex)
+                    {
+                        case 0:
+                            simpleTerminal.stopBits = "OneStop"
+                            break
+
+                        case 1:
+                            simpleTerminal.stopBits = "OneAndHalfStop"
+                            break
+
+                        case 2:
+                            simpleTerminal.stopBits = "TwoStop"
+                            break
+
+                        default:
+                            simpleTerminal.stopBits = "UnknownStopBits"
+                            break
+                    }
+
+                    // Flow control
+                    switch (flowCombo.currentIndex)
+                    {
+                        case 0:
+                            simpleTerminal.flowControl = "NoFlowControl"
+                            break
+
+                        case 1:
+                            simpleTerminal.flowControl = "HardwareControl"
+                            break
+
+                        case 2:
+                            simpleTerminal.flowControl = "SoftwareControl"
+                            break
+
+                        default:
+                            simpleTerminal.flowControl = "UnknownFlowControl"
+                            break
+                    }
+                    // SOM
+                    switch (somCombo.currentIndex)
+                    {
+                        default:
+                        case 0:
+                            simpleTerminal.som = "";
+                            break
+
+                        case 1:
+                            simpleTerminal.som = "@";
+                            break
+
+                        case 2:
+                            simpleTerminal.som = "#"
+                            break
+
+                        case 3:
+                            simpleTerminal.som = somCustom.text
+                            break
+                    }
+
+                    // EOM
+                    switch (eomCombo.currentIndex)
+                    {
+                        default:
+                        case 0:
+                            simpleTerminal.eom = "\r";
+                            break
+
+                        case 1:
+                            simpleTerminal.eom = "\n";
+                            break
+
+                        case 2:
+                            simpleTerminal.eom = "\r\n";
+                            break
+
+                        case 3:
+                            simpleTerminal.eom = "";
+                            break
+
+                        case 4:
+                            simpleTerminal.eom = eomCustom.text
+                            break
+                    }
+
+
+                    // Port
+                    simpleTerminal.setPort(portCombo.currentText)
+
+                    settingsChanged()
                 }
 
-                // SOM
-                switch (simpleTerminal.som)
-                {
-                    case "":
-                        somCombo.currentIndex = 0
-                        break
-
-                    case "@":
-                        somCombo.currentIndex = 1
-                        break
-
-                    case "#":
-                        somCombo.currentIndex = 2
-                        break
-
-                    default:
-                        somCombo.currentIndex = 3
-                        somCustom.text = simpleTerminal.som
-                        break
+                Settings {
+                    category: "CommSettings"
+                    property alias port: portCombo.currentText
+                    property alias baudrate: baudRateCombo.currentText
+                    property alias data_bits: dataBitsCombo.currentText
+                    property alias parity: parityCombo.currentText
+                    property alias stop_bits: stopCombo.currentText
+                    property alias flowcontrol: flowCombo.currentText
+                    property alias som: somCombo.currentText
+                    property alias som_custom: somCustom.text
+                    property alias eom: eomCombo.currentText
+                    property alias eom_custom: eomCustom.text
                 }
 
-                // EOM
-                switch (simpleTerminal.eom)
-                {
-                    case "\r":
-                        eomCombo.currentIndex = 0
-                        break
-
-                    case "\n":
-                        eomCombo.currentIndex = 1
-                        break
-
-                    case "\r\n":
-                        eomCombo.currentIndex = 2
-                        break
-
-                    case "":
-                        eomCombo.currentIndex = 3
-                        break
-
-                    default:
-                        eomCombo.currentIndex = 4
-                        eomCustom.text = simpleTerminal.eom
-                        break
+                GridLayout {
+                    id: settingsLayout
+                    columns: 3
+
+                    Label { text: "<strong>Port</strong>" }
+                    ComboBox {
+                        id: portCombo
+                        model: portsListModel
+                        textRole: "display"
+                        Layout.columnSpan: 2
+                    }
+
+                    Label { text: "" }
+                    Label {
+                        id: portDetails
+                        Layout.columnSpan: 2
+                        color: "gray"
+                        text: {
+                            var port = portsListModel.get(portCombo.currentIndex)
+                            if (port.portName === undefined)
+                                return ""
+
+                            var ids = port.vendorId !== undefined ?
+                                        " (" + ("000" + port.vendorId.toString(16)).slice(-4) + ":" +
+                                        ("000" + port.productId.toString(16)).slice(-4) +
+                                        (port.serialNumber ? " " + port.serialNumber : "") + ")" : ""
+                            return (port.description || port.systemLocation) + ids
+                        }
+                    }
+
+                    Label { text: "<strong>Baud Rate</strong>" }
+                    ComboBox {
+                        id: baudRateCombo
+                        model: baudListModel
+                        currentIndex: { baudListModel.count - 1}
+                        Layout.columnSpan: 2
+                    }
+
+                    Label { text: "<strong>Data Bits</strong>" }
+                    ComboBox {
+                        id: dataBitsCombo
+                        model: [5, 6, 7, 8]
+                        currentIndex: 3
+                        Layout.columnSpan: 2
+                    }
+
+                    Label { text: "<strong>Parity</strong>" }
+                    ComboBox {
+                        id: parityCombo
+                        model: ["None", "Even", "Odd"]
+                        currentIndex: 0
+                        Layout.columnSpan: 2
+                    }
+
+                    Label { text: "<strong>Stop Bits</strong>" }
+                    ComboBox {
+                        id: stopCombo
+                        model: [1, 1.5, 2]
+                        currentIndex: 0
+                        Layout.columnSpan: 2
+                    }
+
+                    Label { text: "<strong>Flow Control</strong>" }
+                    ComboBox {
+                        id: flowCombo
+                        model: ["None", "Hardware", "Software"]
+                        currentIndex: 0
+                        Layout.columnSpan: 2
+                    }
+
+                    Label { text: "<strong>Start-of-Message Prefix</strong>" }
+                    ComboBox {
+                        id: somCombo
+                        model: ["None", "@", "#", "Custom..."]
+                        currentIndex: 0
+                    }
+                    TextField {
+                        id: somCustom
+                        placeholderText: qsTr("Custom SOM...")
+                        enabled: somCombo.currentIndex == 3
+                        maximumLength: 4
+                    }
+
+                    Label { text: "<strong>End-of-Message Terminator</strong>" }
+                    ComboBox {
+                        id: eomCombo
+                        model: ["CR", "LF", "CR+LF", "None", "Custom..."]
+                        currentIndex: 0
+                    }
+                    TextField {
+                        id: eomCustom
+                        placeholderText: qsTr("Custom EOM...")
+                        enabled: eomCombo.currentIndex == 4
+                        maximumLength: 4
+                    }
                 }
-
-            }
-        }
-
-        onAccepted: {
-            console.log("Applying new settings: " + portCombo.currentText + " " + baudRateCombo.currentText + " " +
-                        dataBitsCombo.currentText + " " + parityCombo.currentText + " " + stopCombo.currentText + " " +
-                        flowCombo.currentText + " " + somCombo.currentText + " " + eomCombo.currentText)
-
-            // Baud rate
-            serialPort.baudRate = baudRateCombo.currentText
-
-            // Data bits
-            serialPort.dataBits = "Data" + dataBitsCombo.currentText
-
-            // Parity
-            switch (parityCombo.currentIndex)
-            {
-                case 0:
-                    serialPort.parity = "NoParity"
-                    break
-
-                case 1:
-                    serialPort.parity = "EvenParity"
-                    break
-
-                case 2:
-                    serialPort.parity = "OddParity"
-                    break
-
-                 default:
-                     serialPort.parity = "UnknownParity"
-                     break
-            }
-
-            // Stop bits
-            switch (stopCombo.currentIndex)
-            {
-                case 0:
-                    serialPort.stopBits = "OneStop"
-                    break
-
-                case 1:
-                    serialPort.stopBits = "OneAndHalfStop"
-                    break
-
-                case 2:
-                    serialPort.stopBits = "TwoStop"
-                    break
-
-                default:
-                    serialPort.stopBits = "UnknownStopBits"
-                    break
-            }
-
-            // Flow control
-            switch (flowCombo.currentIndex)
-            {
-                case 0:
-                    serialPort.flowControl = "NoFlowControl"
-                    break
-
-                case 1:
-                    serialPort.flowControl = "HardwareControl"
-                    break
-
-                case 2:
-                    serialPort.flowControl = "SoftwareControl"
-                    break
-
-                default:
-                    serialPort.flowControl = "UnknownFlowControl"
-                    break
-            }
-            // SOM
-            switch (somCombo.currentIndex)
-            {
-                default:
-                case 0:
-                    simpleTerminal.som = "";
-                    break
-
-                case 1:
-                    simpleTerminal.som = "@";
-                    break
-
-                case 2:
-                    simpleTerminal.som = "#"
-                    break
-
-                case 3:
-                    simpleTerminal.som = somCustom.text
-                    break
-            }
-
-            // EOM
-            switch (eomCombo.currentIndex)
-            {
-                default:
-                case 0:
-                    simpleTerminal.eom = "\r";
-                    break
-
-                case 1:
-                    simpleTerminal.eom = "\n";
-                    break
-
-                case 2:
-                    simpleTerminal.eom = "\r\n";
-                    break
-
-                case 3:
-                    simpleTerminal.eom = "";
-                    break
-
-                case 4:
-                    simpleTerminal.eom = eomCustom.text
-                    break
-            }
-
-
-            // Port
-            newPort(portCombo.currentText)
-
-            settingsChanged()
-        }
-
-        Settings {
-            category: "CommSettings"
-            property alias port: portCombo.currentText
-            property alias baudrate: baudRateCombo.currentText
-            property alias data_bits: dataBitsCombo.currentText
-            property alias parity: parityCombo.currentText
-            property alias stop_bits: stopCombo.currentText
-            property alias flowcontrol: flowCombo.currentText
-            property alias som: somCombo.currentText
-            property alias som_custom: somCustom.text
-            property alias eom: eomCombo.currentText
-            property alias eom_custom: eomCustom.text
-        }
-
-        GridLayout {
-            id: settingsLayout
-            columns: 3
-
-            Label { text: "<strong>Port</strong>" }
-            ComboBox {
-                id: portCombo
-                model: portsListModel
-                Layout.columnSpan: 2
-            }
-
-            Label { text: "<strong>Baud Rate</strong>" }
-            ComboBox {
-                id: baudRateCombo
-                model: baudListModel
-                currentIndex: { baudListModel.count - 1}
-                Layout.columnSpan: 2
-            }
-
-            Label { text: "<strong>Data Bits</strong>" }
-            ComboBox {
-                id: dataBitsCombo
-                model: [5, 6, 7, 8]
-                currentIndex: 3
-                Layout.columnSpan: 2
-            }
-
-            Label { text: "<strong>Parity</strong>" }
-            ComboBox {
-                id: parityCombo
-                model: ["None", "Even", "Odd"]
-                currentIndex: 0
-                Layout.columnSpan: 2
-            }
-
-            Label { text: "<strong>Stop Bits</strong>" }
-            ComboBox {
-                id: stopCombo
-                model: [1, 1.5, 2]
-                currentIndex: 0
-                Layout.columnSpan: 2
-            }
-
-            Label { text: "<strong>Flow Control</strong>" }
-            ComboBox {
-                id: flowCombo
-                model: ["None", "Hardware", "Software"]
-                currentIndex: 0
-                Layout.columnSpan: 2
-            }
-
-            Label { text: "<strong>Start-of-Message Prefix</strong>" }
-            ComboBox {
-                id: somCombo
-                model: ["None", "@", "#", "Custom..."]
-                currentIndex: 0
-            }
-            TextField {
-                id: somCustom
-                placeholderText: qsTr("Custom SOM...")
-                enabled: somCombo.currentIndex == 3
-                maximumLength: 4
-            }
-
-            Label { text: "<strong>End-of-Message Terminator</strong>" }
-            ComboBox {
-                id: eomCombo
-                model: ["CR", "LF", "CR+LF", "None", "Custom..."]
-                currentIndex: 0
-            }
-            TextField {
-                id: eomCustom
-                placeholderText: qsTr("Custom EOM...")
-                enabled: eomCombo.currentIndex == 4
-                maximumLength: 4
             }
         }
     }
 
-    FontDialog {
+    // Font of all sessions
+    Loader {
         id: fontDialog
-        modality: Qt.ApplicationModal
-        title: qsTr("Font")
-
-        monospacedFonts: true
-        nonScalableFonts: false
-        proportionalFonts: false
-        scalableFonts: false
-
-        onAccepted: {
-            // The font weight should do nothing
-            consoleOutput.font.family = font.family
-            consoleOutput.font.pointSize = font.pointSize
+        active: false
+
+        sourceComponent: Component {
+            FontDialog {
+                modality: Qt.ApplicationModal
+                title: qsTr("Font")
+
+                monospacedFonts: true
+                nonScalableFonts: false
+                proportionalFonts: false
+                scalableFonts: false
+
+                onAccepted: {
+                    // The font weight should do nothing
+                    root.consoleFont.family = font.family
+                    root.consoleFont.pointSize = font.pointSize
+                }
+            }
         }
     }
 }
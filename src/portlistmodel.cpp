@@ -0,0 +1,191 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "portlistmodel.h"
+
+//**********************************************************************************************************************
+PortListModel::PortListModel(QObject *parent) :
+    QAbstractListModel(parent),
+    _ports()
+{}
+
+//**********************************************************************************************************************
+void PortListModel::update(const QList<QSerialPortInfo> &ports)
+{
+    int oldCount = _ports.size();
+
+    // Gone, or a different device now behind the same name
+    for (int row = _ports.size() - 1; row >= 0; --row)
+    {
+        bool found = false;
+        foreach (const QSerialPortInfo &info, ports)
+        {
+            if (sameDevice(info, _ports.at(row)))
+            {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            beginRemoveRows(QModelIndex(), row, row);
+            _ports.removeAt(row);
+            endRemoveRows();
+        }
+    }
+
+    // New ones go at the end
+    foreach (const QSerialPortInfo &info, ports)
+    {
+        bool found = false;
+        foreach (const QSerialPortInfo &known, _ports)
+        {
+            if (sameDevice(info, known))
+            {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            beginInsertRows(QModelIndex(), _ports.size(), _ports.size());
+            _ports << info;
+            endInsertRows();
+        }
+    }
+
+    if (_ports.size() != oldCount)
+        emit countChanged();
+}
+
+//**********************************************************************************************************************
+QVariantMap PortListModel::get(int row) const
+{
+    QVariantMap map;
+    if (row < 0 || row >= _ports.size())
+        return map;
+
+    QHash<int, QByteArray> roles = roleNames();
+    for (QHash<int, QByteArray>::const_iterator i = roles.constBegin(); i != roles.constEnd(); ++i)
+    {
+        map.insert(QString::fromLatin1(i.value()), data(index(row), i.key()));
+    }
+
+    return map;
+}
+
+//**********************************************************************************************************************
+int PortListModel::indexOf(const QString &portName) const
+{
+    for (int row = 0; row < _ports.size(); ++row)
+    {
+        if (_ports.at(row).portName() == portName)
+            return row;
+    }
+
+    return -1;
+}
+
+//**********************************************************************************************************************
+int PortListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return _ports.size();
+}
+
+//**********************************************************************************************************************
+QVariant PortListModel::data(const QModelIndex &index, int role) const
+{
+    if (index.row() < 0 || index.row() >= _ports.size())
+        return QVariant();
+
+    const QSerialPortInfo &info = _ports.at(index.row());
+    switch (role)
+    {
+        case Qt::DisplayRole:
+        case PortNameRole:
+            return info.portName();
+
+        case SystemLocationRole:
+            return info.systemLocation();
+
+        case DescriptionRole:
+            return info.description();
+
+        case ManufacturerRole:
+            return info.manufacturer();
+
+        case SerialNumberRole:
+            return info.serialNumber();
+
+        case VendorIdRole:
+            return info.hasVendorIdentifier() ? QVariant(info.vendorIdentifier()) : QVariant();
+
+        case ProductIdRole:
+            return info.hasProductIdentifier() ? QVariant(info.productIdentifier()) : QVariant();
+
+        case StableIdRole:
+            return stableId(info);
+
+        default:
+            return QVariant();
+    }
+}
+
+//**********************************************************************************************************************
+QHash<int, QByteArray> PortListModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[Qt::DisplayRole] = "display";
+    roles[PortNameRole] = "portName";
+    roles[SystemLocationRole] = "systemLocation";
+    roles[DescriptionRole] = "description";
+    roles[ManufacturerRole] = "manufacturer";
+    roles[SerialNumberRole] = "serialNumber";
+    roles[VendorIdRole] = "vendorId";
+    roles[ProductIdRole] = "productId";
+    roles[StableIdRole] = "stableId";
+    return roles;
+}
+
+//**********************************************************************************************************************
+QString PortListModel::stableId(const QSerialPortInfo &info)
+{
+    if (!info.hasVendorIdentifier() || !info.hasProductIdentifier())
+        return info.systemLocation();
+
+    return QString("%1:%2:%3").arg(info.vendorIdentifier(), 4, 16, QChar('0'))
+                              .arg(info.productIdentifier(), 4, 16, QChar('0'))
+                              .arg(info.serialNumber());
+}
+
+//**********************************************************************************************************************
+bool PortListModel::sameDevice(const QSerialPortInfo &a, const QSerialPortInfo &b)
+{
+    return a.systemLocation() == b.systemLocation() && stableId(a) == stableId(b);
+}
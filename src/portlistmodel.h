@@ -0,0 +1,75 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef PORTLISTMODEL_H
+#define PORTLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QSerialPortInfo>
+#include <QVariantMap>
+
+//**********************************************************************************************************************
+// Available serial ports with their USB metadata. update() only inserts and removes the rows of ports that appeared or
+// disappeared, so views keep their state across rescans.
+class PortListModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    enum Roles
+    {
+        PortNameRole = Qt::UserRole + 1,
+        SystemLocationRole,
+        DescriptionRole,
+        ManufacturerRole,
+        SerialNumberRole,
+        VendorIdRole,
+        ProductIdRole,
+        StableIdRole // VID:PID:serial when known; otherwise the system location
+    };
+
+    explicit PortListModel(QObject *parent = nullptr);
+
+    void update(const QList<QSerialPortInfo> &ports);
+
+    Q_INVOKABLE QVariantMap get(int row) const;
+    Q_INVOKABLE int indexOf(const QString &portName) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void countChanged();
+
+private:
+    static QString stableId(const QSerialPortInfo &info);
+    static bool sameDevice(const QSerialPortInfo &a, const QSerialPortInfo &b);
+
+    QList<QSerialPortInfo> _ports;
+};
+
+#endif // PORTLISTMODEL_H
@@ -23,50 +23,48 @@
 ******************************************************************************/
 
 #include "portswatcher.h"
-#include <QStringList>
 
-#include <QQmlApplicationEngine>
-//#include <QQuickView>
-#include <QQmlContext>
 #include <QSerialPortInfo>
+#include <QtDebug>
 
 //**********************************************************************************************************************
-PortsWatcher::PortsWatcher(QQmlApplicationEngine &engine, QStringList &portsList, QObject *parent)
+PortsWatcher::PortsWatcher(QObject *parent)
     : QObject(parent),
-      _engine(engine),
-      _portsList(portsList),
-      _timer(this)
+      _model(this),
+      _devWatcher(this),
+      _timer(this),
+      _settleTimer(this)
 {
     QObject::connect(&_timer, SIGNAL(timeout()), this, SLOT(generatePortsList()));
+    QObject::connect(&_settleTimer, SIGNAL(timeout()), this, SLOT(generatePortsList()));
+    QObject::connect(&_devWatcher, SIGNAL(directoryChanged(QString)), &_settleTimer, SLOT(start()));
 
     _timer.setSingleShot(false);
+    _settleTimer.setSingleShot(true);
+    _settleTimer.setInterval(DEV_SETTLE_MS);
 }
 
 //**********************************************************************************************************************
-void PortsWatcher::start()
+PortListModel *PortsWatcher::model()
 {
-    _timer.start(GET_PORTS_LIST_PERIOD_MS);
+    return &_model;
 }
 
 //**********************************************************************************************************************
-void PortsWatcher::generatePortsList()
+void PortsWatcher::start()
 {
-    QStringList ports;
-    QList<QSerialPortInfo> availablePorts(QSerialPortInfo::availablePorts());
-    if (availablePorts.length() > 0)
-    {
-        foreach (const QSerialPortInfo &info, availablePorts)
-        {
-            ports << info.portName();
-        }
-    }
-    else
-    {
-        ports << "";
-    }
+    generatePortsList();
 
-    _portsList = ports;
+    if (!_devWatcher.addPath("/dev"))
+    {
+        qDebug() << "Cannot watch /dev; polling for serial ports";
 
-    _engine.rootContext()->setContextProperty("portsListModel", _portsList);
+        _timer.start(GET_PORTS_LIST_PERIOD_MS);
+    }
 }
 
+//**********************************************************************************************************************
+void PortsWatcher::generatePortsList()
+{
+    _model.update(QSerialPortInfo::availablePorts());
+}
@@ -27,17 +27,20 @@
 
 #include <QObject>
 #include <QTimer>
+#include <QFileSystemWatcher>
 
-class QQmlApplicationEngine;
-class QStringList;
+#include "portlistmodel.h"
 
 //**********************************************************************************************************************
+// Keeps a PortListModel up to date. Where /dev can be watched (inotify on Linux) ports are rescanned only when device
+// nodes come or go; elsewhere it falls back to polling.
 class PortsWatcher : public QObject
 {
     Q_OBJECT
 public:
-    explicit PortsWatcher(QQmlApplicationEngine &engine, QStringList &portsList, QObject *parent = 0);
+    explicit PortsWatcher(QObject *parent = 0);
 
+    PortListModel *model();
     void start();
 
 signals:
@@ -46,11 +49,13 @@ public slots:
     void generatePortsList();
 
 private:
-    static const int GET_PORTS_LIST_PERIOD_MS = 4000;
+    static const int GET_PORTS_LIST_PERIOD_MS = 4000; // Fallback polling period
+    static const int DEV_SETTLE_MS = 250;             // udev adds symlinks and permissions after the node appears
 
-    QQmlApplicationEngine &_engine;
-    QStringList &_portsList;
+    PortListModel _model;
+    QFileSystemWatcher _devWatcher;
     QTimer _timer;
+    QTimer _settleTimer;
 };
 
 #endif // PORTSWATCHER_H
@@ -0,0 +1,180 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "profile.h"
+
+//**********************************************************************************************************************
+void Profile::save(QSettings &settings) const
+{
+    settings.setValue("port/name", port.name);
+    settings.setValue("port/baudrate", port.baudRate);
+    settings.setValue("port/databits", static_cast<int>(port.dataBits));
+    settings.setValue("port/parity", static_cast<int>(port.parity));
+    settings.setValue("port/stopbits", static_cast<int>(port.stopBits));
+    settings.setValue("port/flowcontrol", static_cast<int>(port.flowControl));
+    settings.setValue("port/som", som);
+    settings.setValue("port/eom", eom);
+    settings.setValue("port/rxeom", rxEom);
+
+    settings.setValue("display/maxflushrate", maxFlushRate);
+    settings.setValue("display/maxscrollbackbytes", maxScrollbackBytes);
+    settings.setValue("display/hex", hexMode);
+    settings.setValue("display/timestamps", static_cast<int>(timestampMode));
+    settings.setValue("display/encoding", static_cast<int>(encoding));
+    settings.setValue("display/ansi", ansi);
+}
+
+//**********************************************************************************************************************
+Profile Profile::load(QSettings &settings)
+{
+    Profile p;
+    bool ok = false;
+
+    p.port.name = settings.value("port/name").toString();
+    p.port.baudRate = settings.value("port/baudrate", p.port.baudRate).toInt();
+
+    int dataBits = settings.value("port/databits", p.port.dataBits).toInt();
+    if (dataBits >= QSerialPort::Data5 && dataBits <= QSerialPort::Data8)
+        p.port.dataBits = static_cast<QSerialPort::DataBits>(dataBits);
+
+    QString parity = settings.value("port/parity").toString();
+    int value = parity.toInt(&ok);
+    if (ok)
+        p.port.parity = static_cast<QSerialPort::Parity>(value);
+    else if (parity == "Even")
+        p.port.parity = QSerialPort::EvenParity;
+    else if (parity == "Odd")
+        p.port.parity = QSerialPort::OddParity;
+
+    QString stopBits = settings.value("port/stopbits").toString();
+    value = stopBits.toInt(&ok);
+    if (ok && value >= QSerialPort::OneStop && value <= QSerialPort::OneAndHalfStop)
+        p.port.stopBits = static_cast<QSerialPort::StopBits>(value); // Also how 1.0 and 2.0 were written
+    else if (stopBits == "1.5")
+        p.port.stopBits = QSerialPort::OneAndHalfStop;
+
+    QString flowControl = settings.value("port/flowcontrol").toString();
+    value = flowControl.toInt(&ok);
+    if (ok)
+        p.port.flowControl = static_cast<QSerialPort::FlowControl>(value);
+    else if (flowControl == "Hardware")
+        p.port.flowControl = QSerialPort::HardwareControl;
+    else if (flowControl == "Software")
+        p.port.flowControl = QSerialPort::SoftwareControl;
+
+    p.som = settings.value("port/som", p.som).toString();
+    p.eom = settings.value("port/eom", p.eom).toString();
+    p.rxEom = settings.value("port/rxeom").toStringList();
+
+    p.maxFlushRate = settings.value("display/maxflushrate", p.maxFlushRate).toInt();
+    p.maxScrollbackBytes = settings.value("display/maxscrollbackbytes", p.maxScrollbackBytes).toLongLong();
+    p.hexMode = settings.value("display/hex", p.hexMode).toBool();
+
+    value = settings.value("display/timestamps", 0).toInt();
+    if (value >= 0 && value <= static_cast<int>(ScrollbackModel::TimestampMode::DELTA))
+        p.timestampMode = static_cast<ScrollbackModel::TimestampMode>(value);
+
+    value = settings.value("display/encoding", 0).toInt();
+    if (value >= 0 && value <= static_cast<int>(TextDecoder::Encoding::RAW))
+        p.encoding = static_cast<TextDecoder::Encoding>(value);
+
+    p.ansi = settings.value("display/ansi", p.ansi).toBool();
+
+    return p;
+}
+
+//**********************************************************************************************************************
+ProfileStore::ProfileStore() :
+    QObject(),
+    _profiles()
+{
+    QSettings settings;
+    settings.beginGroup("profiles");
+
+    foreach (const QString &name, settings.childGroups())
+    {
+        settings.beginGroup(name);
+        _profiles.insert(name, Profile::load(settings));
+        settings.endGroup();
+    }
+}
+
+//**********************************************************************************************************************
+ProfileStore *ProfileStore::instance()
+{
+    static ProfileStore store;
+    return &store;
+}
+
+//**********************************************************************************************************************
+QStringList ProfileStore::names() const
+{
+    return _profiles.keys();
+}
+
+//**********************************************************************************************************************
+bool ProfileStore::contains(const QString &name) const
+{
+    return _profiles.contains(name);
+}
+
+//**********************************************************************************************************************
+Profile ProfileStore::profile(const QString &name) const
+{
+    return _profiles.value(name);
+}
+
+//**********************************************************************************************************************
+bool ProfileStore::setProfile(const QString &name, const Profile &profile)
+{
+    if (name.isEmpty() || name.contains('/') || name.contains('\\'))
+        return false;
+
+    bool isNew = !_profiles.contains(name);
+    _profiles.insert(name, profile);
+
+    QSettings settings;
+    settings.beginGroup("profiles/" + name);
+    settings.remove("");
+    profile.save(settings);
+
+    if (isNew)
+        emit namesChanged();
+
+    return true;
+}
+
+//**********************************************************************************************************************
+bool ProfileStore::remove(const QString &name)
+{
+    if (!_profiles.remove(name))
+        return false;
+
+    QSettings settings;
+    settings.remove("profiles/" + name);
+
+    emit namesChanged();
+
+    return true;
+}
@@ -0,0 +1,89 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "serialworker.h"
+#include "scrollbackmodel.h"
+#include "displaybatcher.h"
+
+#include <QObject>
+#include <QMap>
+#include <QSettings>
+#include <QString>
+#include <QStringList>
+
+//**********************************************************************************************************************
+// Everything needed to talk to one device: port, line settings, message framing and display options.
+//
+// Stored with enums as plain integers, so loading is a handful of reads and no string matching; values written by
+// older versions (parity, stop bits and flow control as text) are still understood.
+struct Profile
+{
+    PortSettings port;
+    QString som;
+    QString eom = "\r";
+    QStringList rxEom;
+    int maxFlushRate = DisplayBatcher::DEFAULT_MAX_FLUSH_RATE;
+    qint64 maxScrollbackBytes = ScrollbackModel::DEFAULT_MAX_BYTES;
+    bool hexMode = false;
+    ScrollbackModel::TimestampMode timestampMode = ScrollbackModel::TimestampMode::NONE;
+    TextDecoder::Encoding encoding = TextDecoder::Encoding::UTF8;
+    bool ansi = true;
+
+    // In the current group of settings
+    void save(QSettings &settings) const;
+    static Profile load(QSettings &settings);
+};
+
+//**********************************************************************************************************************
+// Named profiles shared by all sessions, kept under "profiles" in the settings.
+//
+// All profiles are decoded once, the first time the store is used; switching to a profile afterwards never touches
+// the settings store.
+class ProfileStore : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QStringList names READ names NOTIFY namesChanged)
+
+public:
+    static ProfileStore *instance();
+
+    QStringList names() const;
+    bool contains(const QString &name) const;
+    Profile profile(const QString &name) const;
+    bool setProfile(const QString &name, const Profile &profile); // False if name is not usable as a settings key
+    bool remove(const QString &name);
+
+signals:
+    void namesChanged();
+
+private:
+    ProfileStore();
+
+    QMap<QString, Profile> _profiles;
+};
+
+#endif // PROFILE_H
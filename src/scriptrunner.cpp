@@ -0,0 +1,400 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "scriptrunner.h"
+#include "simpleterminal.h"
+#include "commandparser.h"
+#include "clock.h"
+
+#include <QFile>
+#include <QFileInfo>
+
+//**********************************************************************************************************************
+ScriptRunner::ScriptRunner(SimpleTerminal &terminal, QObject *parent) :
+    QObject(parent),
+    _terminal(terminal),
+    _name(),
+    _ops(),
+    _pc(0),
+    _state(State::IDLE),
+    _echo(false),
+    _som(),
+    _eom(),
+    _wait(0),
+    _dueNs(0),
+    _startNs(0),
+    _timer(this),
+    _sends(0),
+    _sentBytes(0),
+    _waits(0)
+{
+    _timer.setSingleShot(true);
+    _timer.setTimerType(Qt::PreciseTimer);
+
+    QObject::connect(&_timer, SIGNAL(timeout()), this, SLOT(timeout()));
+    QObject::connect(&_terminal, SIGNAL(waitMatched(int,qint64)), this, SLOT(waitMatched(int,qint64)));
+    QObject::connect(&_terminal, SIGNAL(connStateChanged()), this, SLOT(connStateChanged()));
+    QObject::connect(&_terminal, SIGNAL(connectFailed()), this, SLOT(connectFailed()));
+    QObject::connect(&_terminal, SIGNAL(somChanged()), this, SLOT(framingChanged()));
+    QObject::connect(&_terminal, SIGNAL(eomChanged()), this, SLOT(framingChanged()));
+}
+
+//**********************************************************************************************************************
+bool ScriptRunner::compile(const QString &script, QVector<Op> &ops, QString &error)
+{
+    ops.clear();
+
+    const QStringList lines = script.split('\n');
+    for (int i = 0; i < lines.size(); ++i)
+    {
+        QString line = lines.at(i).trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        QStringList args;
+        if (!CommandParser::tokenize(line, args))
+        {
+            error = QString("Line %1: Unterminated quote").arg(i + 1);
+            return false;
+        }
+
+        QString name = args.takeFirst();
+        Op op;
+        op.line = i + 1;
+        op.ms = 0;
+
+        if (name == "send")
+        {
+            op.type = Op::Type::SEND;
+            op.data = CommandParser::unescape(args.join(' ')).toLatin1();
+        }
+        else if (name == "wait")
+        {
+            if (args.isEmpty() || args.size() > 2 || args[0].isEmpty())
+            {
+                error = QString("Line %1: Expected wait <pattern> [timeout ms]").arg(i + 1);
+                return false;
+            }
+
+            op.type = Op::Type::WAIT;
+            op.text = args[0];
+            op.ms = DEFAULT_WAIT_MS;
+
+            // Patterns are written like trigger patterns
+            if (op.text.size() > 2 && op.text.startsWith('/') && op.text.endsWith('/'))
+            {
+                op.regex.setPattern(op.text.mid(1, op.text.size() - 2));
+                if (!op.regex.isValid())
+                {
+                    error = QString("Line %1: Invalid regular expression: %2").arg(i + 1).arg(op.regex.errorString());
+                    return false;
+                }
+                op.regex.optimize();
+            }
+            else
+            {
+                op.literal.setPattern(CommandParser::unescape(op.text).toLatin1());
+            }
+
+            bool ok = true;
+            if (args.size() > 1)
+                op.ms = args[1].toInt(&ok);
+
+            if (!ok || op.ms <= 0)
+            {
+                error = QString("Line %1: Invalid timeout").arg(i + 1);
+                return false;
+            }
+        }
+        else if (name == "delay")
+        {
+            bool ok = args.size() == 1;
+            if (ok)
+                op.ms = args[0].toInt(&ok);
+
+            if (!ok || op.ms < 0)
+            {
+                error = QString("Line %1: Expected delay <ms>").arg(i + 1);
+                return false;
+            }
+
+            op.type = Op::Type::DELAY;
+        }
+        else if (name == "som" || name == "eom")
+        {
+            op.type = name == "som" ? Op::Type::SOM : Op::Type::EOM;
+            op.text = CommandParser::unescape(args.join(' '));
+        }
+        else if (name == "connect")
+        {
+            if (args.size() > 1)
+            {
+                error = QString("Line %1: Expected connect [portName]").arg(i + 1);
+                return false;
+            }
+
+            op.type = Op::Type::CONNECT;
+            op.text = args.value(0);
+        }
+        else
+        {
+            error = QString("Line %1: Unknown operation %2").arg(i + 1).arg(name);
+            return false;
+        }
+
+        ops.append(op);
+    }
+
+    return true;
+}
+
+//**********************************************************************************************************************
+bool ScriptRunner::start(const QString &fileName, bool echo)
+{
+    if (isRunning())
+    {
+        _terminal.setError("Already running " + _name);
+        return false;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        _terminal.setError("Could not open script: " + file.errorString());
+        return false;
+    }
+
+    QString error;
+    if (!compile(QString::fromUtf8(file.readAll()), _ops, error))
+    {
+        _terminal.setError(QFileInfo(fileName).fileName() + ": " + error);
+        return false;
+    }
+
+    _name = QFileInfo(fileName).fileName();
+    _pc = 0;
+    _echo = echo;
+    _sends = 0;
+    _sentBytes = 0;
+    _waits = 0;
+    _startNs = Clock::now();
+    _dueNs = _startNs;
+    framingChanged();
+
+    // Waits only see data received from here on
+    _terminal.watchWaits(true);
+
+    // Run from the event loop so the command's own output comes first
+    _state = State::RUNNING;
+    QMetaObject::invokeMethod(this, "step", Qt::QueuedConnection);
+
+    return true;
+}
+
+//**********************************************************************************************************************
+void ScriptRunner::stop()
+{
+    if (isRunning())
+        finish("Stopped");
+}
+
+//**********************************************************************************************************************
+bool ScriptRunner::isRunning() const
+{
+    return _state != State::IDLE;
+}
+
+//**********************************************************************************************************************
+void ScriptRunner::step()
+{
+    if (_state != State::RUNNING)
+        return;
+
+    while (_pc < _ops.size())
+    {
+        const Op &op = _ops.at(_pc);
+        switch (op.type)
+        {
+            case Op::Type::SEND:
+            {
+                QByteArray data = _som + op.data + _eom;
+                if (!_terminal.transmit(data))
+                {
+                    finish(_terminal.isConnected() ? "Transmit queue full" : "Port is not open");
+                    return;
+                }
+
+                if (_echo)
+                    _terminal.echo(data);
+
+                ++_sends;
+                _sentBytes += data.size();
+                break;
+            }
+
+            case Op::Type::WAIT:
+            {
+                _terminal.startWait(++_wait, op.literal.pattern(), op.regex.pattern());
+                _state = State::WAITING;
+                _timer.start(op.ms);
+                return;
+            }
+
+            case Op::Type::DELAY:
+            {
+                _dueNs += op.ms * Q_INT64_C(1000000);
+                qint64 remainingNs = _dueNs - Clock::now();
+                if (remainingNs > 0)
+                {
+                    ++_pc;
+                    _state = State::DELAYING;
+                    _timer.start(static_cast<int>((remainingNs + 999999) / 1000000));
+                    return;
+                }
+
+                break;
+            }
+
+            case Op::Type::SOM:
+                _terminal.setSOM(op.text);
+                break;
+
+            case Op::Type::EOM:
+                _terminal.setEOM(op.text);
+                break;
+
+            case Op::Type::CONNECT:
+            {
+                if (_terminal.isConnected() && (op.text.isEmpty() || op.text == _terminal.getPortName()))
+                    break;
+
+                // Setting the port reopens it if already connected
+                if (!op.text.isEmpty())
+                    _terminal.setPort(op.text);
+                if (!_terminal.isConnected())
+                    _terminal.connect();
+
+                _state = State::CONNECTING;
+                _timer.start(CONNECT_TIMEOUT_MS);
+                return;
+            }
+        }
+
+        ++_pc;
+    }
+
+    finish();
+}
+
+//**********************************************************************************************************************
+void ScriptRunner::waitMatched(int wait, qint64 timestamp)
+{
+    if (_state != State::WAITING || wait != _wait)
+        return;
+
+    _timer.stop();
+    _dueNs = timestamp;
+    ++_waits;
+    ++_pc;
+    _state = State::RUNNING;
+    step();
+}
+
+//**********************************************************************************************************************
+void ScriptRunner::timeout()
+{
+    switch (_state)
+    {
+        case State::DELAYING:
+            _state = State::RUNNING;
+            step();
+            break;
+
+        case State::WAITING:
+            finish(QString("Timed out waiting for %1").arg(_ops.at(_pc).text));
+            break;
+
+        case State::CONNECTING:
+            finish("Timed out connecting");
+            break;
+
+        default:
+            break;
+    }
+}
+
+//**********************************************************************************************************************
+void ScriptRunner::connStateChanged()
+{
+    // Reopening another port closes the current one first; only the open counts
+    if (_state != State::CONNECTING || !_terminal.isConnected())
+        return;
+
+    _timer.stop();
+    ++_pc;
+    _dueNs = Clock::now();
+    _state = State::RUNNING;
+    step();
+}
+
+//**********************************************************************************************************************
+void ScriptRunner::connectFailed()
+{
+    if (_state == State::CONNECTING)
+        finish("Could not connect");
+}
+
+//**********************************************************************************************************************
+void ScriptRunner::framingChanged()
+{
+    // Framed like typed input, with the same bytes as SimpleTerminal::write()
+    _som = _terminal.getSOM().toLatin1();
+    _eom = _terminal.getEOM().toLatin1();
+}
+
+//**********************************************************************************************************************
+void ScriptRunner::finish(const QString &error)
+{
+    _timer.stop();
+    _state = State::IDLE;
+    _terminal.watchWaits(false);
+
+    double secs = (Clock::now() - _startNs) / 1e9;
+    QString summary = QString("%1 sends (%2 bytes), %3 waits in %4 s").arg(_sends).arg(_sentBytes).arg(_waits)
+                      .arg(secs, 0, 'f', 3);
+
+    if (error.isEmpty())
+    {
+        _terminal.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, "Ran " + _name + ": " + summary);
+    }
+    else
+    {
+        int line = _pc < _ops.size() ? _ops.at(_pc).line : 0;
+        _terminal.setError(QString("%1:%2: %3 after %4").arg(_name).arg(line).arg(error).arg(summary));
+    }
+
+    _ops.clear();
+
+    emit finished(error.isEmpty());
+}
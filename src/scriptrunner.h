@@ -0,0 +1,135 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef SCRIPTRUNNER_H
+#define SCRIPTRUNNER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QByteArrayMatcher>
+#include <QRegularExpression>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+//**********************************************************************************************************************
+class SimpleTerminal;
+
+//**********************************************************************************************************************
+// Runs a script of sends, waits and delays against a terminal.
+//
+// A script is compiled once into a list of operations, one per line:
+//
+//     send <text>                 Send <text> framed with the SOM and EOM
+//     wait <pattern> [timeout ms] Wait until received data matches <pattern> (literal or /regex/)
+//     delay <ms>                  Pause
+//     som [text], eom [text]      Set the SOM or EOM
+//     connect [portName]          Connect and wait until the port is open
+//
+// Arguments are split like command parameters (quotes keep spaces) and text allows escapes such as \r and \xHH. Lines
+// starting with # are comments. Operations then run back to back until one has to wait, with sends going straight to
+// the transmit queue and waits matched in the I/O thread as data is read (see SerialWorker::startWait()), so nothing
+// goes through the display in between and only a match comes back to this thread. Each delay is counted from when the
+// previous one was due, or from when the data a wait matched was read, so timer latency does not add up over a script.
+class ScriptRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int DEFAULT_WAIT_MS = 5000;
+    static const int CONNECT_TIMEOUT_MS = 5000;
+
+    struct Op
+    {
+        enum class Type
+        {
+            SEND,
+            WAIT,
+            DELAY,
+            SOM,
+            EOM,
+            CONNECT
+        };
+
+        Type type;
+        int line;
+        QByteArray data;           // SEND
+        QString text;              // SOM, EOM, CONNECT; the pattern as written for WAIT
+        QByteArrayMatcher literal; // WAIT
+        QRegularExpression regex;  // WAIT, if the pattern is a regular expression
+        int ms;                    // WAIT timeout, DELAY
+    };
+
+    explicit ScriptRunner(SimpleTerminal &terminal, QObject *parent = nullptr);
+
+    // On failure, error says which line is wrong and why
+    static bool compile(const QString &script, QVector<Op> &ops, QString &error);
+
+    bool start(const QString &fileName, bool echo); // Reports errors to the terminal
+    void stop();
+    bool isRunning() const;
+
+signals:
+    void finished(bool ok);
+
+private slots:
+    void step();
+    void waitMatched(int wait, qint64 timestamp);
+    void timeout();
+    void connStateChanged();
+    void connectFailed();
+    void framingChanged();
+
+private:
+    enum class State
+    {
+        IDLE,
+        RUNNING,
+        DELAYING,
+        WAITING,
+        CONNECTING
+    };
+
+    void finish(const QString &error = QString());
+
+    SimpleTerminal &_terminal;
+    QString _name;
+    QVector<Op> _ops;
+    int _pc; // Next operation
+    State _state;
+    bool _echo;
+
+    QByteArray _som;
+    QByteArray _eom;
+    int _wait;        // Of the WAIT running, to tell its match from one of a wait given up on
+    qint64 _dueNs;    // Clock::now() time the last delay ended or was due
+    qint64 _startNs;
+    QTimer _timer;
+
+    int _sends;
+    qint64 _sentBytes;
+    int _waits;
+};
+
+#endif // SCRIPTRUNNER_H
@@ -0,0 +1,265 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "scrollbackindex.h"
+#include "tracer.h"
+
+#include <QMutexLocker>
+
+#include <algorithm>
+
+//**********************************************************************************************************************
+ScrollbackIndex::ScrollbackIndex(QObject *parent) :
+    QObject(parent),
+    _mutex(),
+    _pending(),
+    _scheduled(false),
+    _generation(0),
+    _indexedFrames(0),
+    _firstBlock(0),
+    _filters(),
+    _openGeneration(0),
+    _open()
+{}
+
+//**********************************************************************************************************************
+void ScrollbackIndex::add(quint64 firstFrame, const QVector<QByteArray> &frames)
+{
+    if (frames.isEmpty())
+        return;
+
+    QMutexLocker lock(&_mutex);
+
+    _pending.append({ firstFrame, frames });
+
+    // Batches arriving while the index thread is busy are handled in one go
+    if (!_scheduled)
+    {
+        _scheduled = true;
+        QMetaObject::invokeMethod(this, "process", Qt::QueuedConnection);
+    }
+}
+
+//**********************************************************************************************************************
+void ScrollbackIndex::reset()
+{
+    QMutexLocker lock(&_mutex);
+
+    _pending.clear();
+    ++_generation;
+    _indexedFrames = 0;
+    _firstBlock = 0;
+    _filters.clear();
+}
+
+//**********************************************************************************************************************
+void ScrollbackIndex::dropBefore(quint64 block)
+{
+    QMutexLocker lock(&_mutex);
+
+    _firstBlock = qMax(_firstBlock, block);
+    while (!_filters.isEmpty() && _filters.firstKey() < _firstBlock)
+        _filters.erase(_filters.begin());
+}
+
+//**********************************************************************************************************************
+bool ScrollbackIndex::mayContain(quint64 block, const QVector<quint32> &keys) const
+{
+    if (keys.isEmpty())
+        return true;
+
+    QMutexLocker lock(&_mutex);
+
+    // Complete once a frame past it has been indexed
+    if ((block + 1) * BLOCK_FRAMES >= _indexedFrames)
+        return true;
+
+    QMap<quint64, Filter>::const_iterator it = _filters.constFind(block);
+    if (it == _filters.constEnd())
+        return false; // Nothing searchable in it, or dropped
+
+    const quint64 *bits = it->constData();
+    quint32 mask = static_cast<quint32>(it->size()) * 64 - 1;
+    foreach (quint32 key, keys)
+    {
+        quint32 h1, h2;
+        hash(key, h1, h2);
+        for (int i = 0; i < HASHES; ++i)
+        {
+            quint32 bit = (h1 + static_cast<quint32>(i) * h2) & mask;
+            if (!(bits[bit / 64] & (Q_UINT64_C(1) << (bit % 64))))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+//**********************************************************************************************************************
+QVector<quint32> ScrollbackIndex::keys(const char *data, int len)
+{
+    QVector<quint32> result;
+    collect(result, data, len);
+    makeDistinct(result);
+    return result;
+}
+
+//**********************************************************************************************************************
+char ScrollbackIndex::fold(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+//**********************************************************************************************************************
+void ScrollbackIndex::process()
+{
+    TRACE_SPAN("ScrollbackIndex::process");
+
+    QVector<Batch> batches;
+    quint64 generation;
+    quint64 firstBlock;
+    quint64 indexedFrames;
+    {
+        QMutexLocker lock(&_mutex);
+        batches.swap(_pending);
+        generation = _generation;
+        firstBlock = _firstBlock;
+        indexedFrames = _indexedFrames;
+        _scheduled = false;
+    }
+
+    if (generation != _openGeneration)
+    {
+        _open.clear();
+        _openGeneration = generation;
+    }
+
+    // Trigrams are collected without holding the lock; repeats are dropped now and then to bound the memory
+    foreach (const Batch &batch, batches)
+    {
+        for (int i = 0; i < batch.frames.size(); ++i)
+        {
+            const QByteArray &data = batch.frames.at(i);
+            if (data.size() < 3)
+                continue;
+
+            OpenBlock &block = _open[(batch.firstFrame + i) / BLOCK_FRAMES];
+            collect(block.trigrams, data.constData(), data.size());
+            if (block.trigrams.size() > 2 * qMax(block.distinct, MIN_FILTER_BITS))
+            {
+                makeDistinct(block.trigrams);
+                block.distinct = block.trigrams.size();
+            }
+        }
+
+        indexedFrames = qMax(indexedFrames, batch.firstFrame + batch.frames.size());
+    }
+
+    // A block is complete once a frame past it has arrived; until then its last frame may still grow
+    QMap<quint64, Filter> filters;
+    quint64 completeBlocks = indexedFrames > 0 ? (indexedFrames - 1) / BLOCK_FRAMES : 0;
+    while (!_open.isEmpty() && _open.firstKey() < completeBlocks)
+    {
+        QMap<quint64, OpenBlock>::iterator it = _open.begin();
+        if (it.key() >= firstBlock)
+            filters.insert(it.key(), build(it->trigrams));
+
+        _open.erase(it);
+    }
+
+    QMutexLocker lock(&_mutex);
+
+    if (generation != _generation)
+        return;
+
+    QMap<quint64, Filter>::const_iterator it = filters.constBegin();
+    for (; it != filters.constEnd(); ++it)
+    {
+        if (it.key() >= _firstBlock)
+            _filters.insert(it.key(), it.value());
+    }
+
+    _indexedFrames = qMax(_indexedFrames, indexedFrames);
+}
+
+//**********************************************************************************************************************
+void ScrollbackIndex::hash(quint32 trigram, quint32 &h1, quint32 &h2)
+{
+    // One 64-bit mix split in two; h2 is odd, so the HASHES bits differ in any filter of at least four bits
+    quint64 h = trigram * Q_UINT64_C(0x9E3779B97F4A7C15);
+    h ^= h >> 32;
+    h *= Q_UINT64_C(0xBF58476D1CE4E5B9);
+    h ^= h >> 29;
+
+    h1 = static_cast<quint32>(h);
+    h2 = static_cast<quint32>(h >> 32) | 1;
+}
+
+//**********************************************************************************************************************
+void ScrollbackIndex::collect(QVector<quint32> &trigrams, const char *data, int len)
+{
+    if (len < 3)
+        return;
+
+    quint32 trigram = (static_cast<quint8>(fold(data[0])) << 8) | static_cast<quint8>(fold(data[1]));
+    for (int i = 2; i < len; ++i)
+    {
+        trigram = ((trigram << 8) | static_cast<quint8>(fold(data[i]))) & 0xFFFFFF;
+        trigrams.append(trigram);
+    }
+}
+
+//**********************************************************************************************************************
+void ScrollbackIndex::makeDistinct(QVector<quint32> &trigrams)
+{
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+//**********************************************************************************************************************
+ScrollbackIndex::Filter ScrollbackIndex::build(QVector<quint32> &trigrams)
+{
+    makeDistinct(trigrams);
+
+    // A power of two bits, so a bit is picked with a mask
+    int size = MIN_FILTER_BITS;
+    while (size < MAX_FILTER_BITS && size < trigrams.size() * BITS_PER_KEY)
+        size *= 2;
+
+    Filter filter(size / 64, 0);
+    quint64 *bits = filter.data();
+    quint32 mask = static_cast<quint32>(size) - 1;
+    foreach (quint32 trigram, trigrams)
+    {
+        quint32 h1, h2;
+        hash(trigram, h1, h2);
+        for (int i = 0; i < HASHES; ++i)
+        {
+            quint32 bit = (h1 + static_cast<quint32>(i) * h2) & mask;
+            bits[bit / 64] |= Q_UINT64_C(1) << (bit % 64);
+        }
+    }
+
+    return filter;
+}
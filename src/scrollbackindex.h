@@ -0,0 +1,107 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef SCROLLBACKINDEX_H
+#define SCROLLBACKINDEX_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QVector>
+#include <QMap>
+#include <QMutex>
+
+//**********************************************************************************************************************
+// Search index over the scrollback, maintained on its own thread.
+//
+// Frames are numbered from the start of the session and grouped in blocks of BLOCK_FRAMES. Each block keeps a Bloom
+// filter of the (ASCII case-folded) trigrams of its frames, so a search only has to scan blocks that may hold every
+// trigram of the text searched for. The trigrams of a block are collected until a frame past it arrives; its filter is
+// then built with BITS_PER_KEY bits per distinct trigram and HASHES bits set for each, so a block of a few long frames
+// gets as selective a filter as one of many short ones. Until then the block is always a candidate.
+//
+// add(), reset(), dropBefore() and mayContain() may be called from any thread; indexing itself happens in the index
+// thread, which is also where searches using the index are meant to run.
+class ScrollbackIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int BLOCK_FRAMES = 1024;
+
+    explicit ScrollbackIndex(QObject *parent = nullptr);
+
+    // frames[i] is frame firstFrame + i; frames[0] may continue a frame added before, in which case it must start with
+    // the last two bytes already added so trigrams across the join are seen
+    void add(quint64 firstFrame, const QVector<QByteArray> &frames);
+    void reset(); // Forget all frames; numbering restarts at 0
+    void dropBefore(quint64 block);
+
+    // False only if no frame of block can contain all keys; blocks not complete yet always may
+    bool mayContain(quint64 block, const QVector<quint32> &keys) const;
+
+    static QVector<quint32> keys(const char *data, int len); // Distinct trigrams, folded
+    static char fold(char c);
+
+private slots:
+    void process();
+
+private:
+    static const int HASHES = 3;
+    static const int BITS_PER_KEY = 16;         // About 0.5% false positives with HASHES
+    static const int MIN_FILTER_BITS = 1024;
+    static const int MAX_FILTER_BITS = 1 << 24; // As many as there are trigrams
+
+    typedef QVector<quint64> Filter; // A power of two bits
+
+    struct Batch
+    {
+        quint64 firstFrame;
+        QVector<QByteArray> frames;
+    };
+
+    struct OpenBlock
+    {
+        QVector<quint32> trigrams;
+        int distinct = 0; // Of the trigrams when they were last made distinct
+    };
+
+    static void hash(quint32 trigram, quint32 &h1, quint32 &h2); // Bit i of HASHES is at h1 + i * h2
+    static void collect(QVector<quint32> &trigrams, const char *data, int len);
+    static void makeDistinct(QVector<quint32> &trigrams);
+    static Filter build(QVector<quint32> &trigrams);
+
+    mutable QMutex _mutex;
+    QVector<Batch> _pending;
+    bool _scheduled;
+    quint64 _generation;   // Bumped by reset(); batches taken before are discarded
+    quint64 _indexedFrames; // Frames below have all been indexed
+    quint64 _firstBlock;
+    QMap<quint64, Filter> _filters;
+
+    // Index thread only
+    quint64 _openGeneration;
+    QMap<quint64, OpenBlock> _open;
+};
+
+#endif // SCROLLBACKINDEX_H
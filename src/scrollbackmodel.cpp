@@ -0,0 +1,925 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "scrollbackmodel.h"
+#include "scrollbackindex.h"
+#include "hexdump.h"
+#include "ansiparser.h"
+#include "clock.h"
+#include "tracer.h"
+
+#include <QDateTime>
+
+#include <climits>
+#include <cstring>
+
+namespace
+{
+    // Palette colours (index + 1) of the frames coloured by the model; see AnsiParser
+    const quint32 BLUE = 22;
+    const quint32 GREEN = 29;
+    const quint32 RED = 197;
+
+    //******************************************************************************************************************
+    // attr over base: the colours of attr where it has them, base's otherwise; flags of both
+    quint32 overlay(quint32 base, quint32 attr)
+    {
+        quint32 fg = attr & AnsiParser::FG_MASK ? attr & AnsiParser::FG_MASK : base & AnsiParser::FG_MASK;
+        quint32 bg = attr & AnsiParser::BG_MASK ? attr & AnsiParser::BG_MASK : base & AnsiParser::BG_MASK;
+        quint32 colors = AnsiParser::FG_MASK | AnsiParser::BG_MASK;
+
+        return ((base | attr) & ~colors) | fg | bg;
+    }
+
+    //******************************************************************************************************************
+    template <typename T>
+    void appendRaw(QByteArray &out, const QVector<T> &values)
+    {
+        out.append(reinterpret_cast<const char *>(values.constData()), values.size() * static_cast<int>(sizeof(T)));
+    }
+
+    //******************************************************************************************************************
+    // Returns in past the values read
+    template <typename T>
+    const char *takeRaw(const char *in, QVector<T> &values, int count)
+    {
+        values.resize(count);
+        std::memcpy(values.data(), in, count * sizeof(T));
+        return in + count * sizeof(T);
+    }
+
+    //******************************************************************************************************************
+    // Calls segment(begin, end, attr, marked) for each stretch of data with one attribute that is either all in or all
+    // out of the marked range
+    template <typename Segment>
+    void forEachSegment(int size, const ScrollbackModel::AttrRun *runs, int runCount, int markOffset, int markLength,
+                        Segment segment)
+    {
+        bool marked = markOffset >= 0 && markOffset + markLength <= size;
+        int markEnd = marked ? markOffset + markLength : -1;
+        if (!marked)
+            markOffset = -1;
+
+        quint32 attr = 0;
+        int run = 0;
+        int pos = 0;
+        while (pos < size)
+        {
+            while (run < runCount && static_cast<int>(runs[run].offset) <= pos)
+                attr = runs[run++].attr;
+
+            int end = size;
+            if (run < runCount)
+                end = qMin(end, static_cast<int>(runs[run].offset));
+            if (markOffset > pos)
+                end = qMin(end, markOffset);
+            if (markEnd > pos)
+                end = qMin(end, markEnd);
+
+            segment(pos, end, attr, pos >= markOffset && pos < markEnd);
+            pos = end;
+        }
+    }
+}
+
+//**********************************************************************************************************************
+ScrollbackModel::ScrollbackModel(QObject *parent) :
+    QAbstractListModel(parent),
+    _chunks(),
+    _firstChunk(0),
+    _count(0),
+    _bytes(0),
+    _resident(0),
+    _packedSize(0),
+    _packedRawSize(0),
+    _hot(),
+    _maxBytes(DEFAULT_MAX_BYTES),
+    _hexMode(false),
+    _timestampMode(TimestampMode::NONE),
+    _encoding(TextDecoder::Encoding::UTF8),
+    _markFrame(-1),
+    _markOffset(0),
+    _markLength(0),
+    _indexThread(),
+    _index(new ScrollbackIndex),
+    _search(0)
+{
+    // Chunk i and index block _firstChunk + i cover the same frames
+    static_assert(CHUNK_LEN == ScrollbackIndex::BLOCK_FRAMES, "Chunks and index blocks differ in size");
+
+    _indexThread.setObjectName("ScrollbackIndex");
+    _index->moveToThread(&_indexThread);
+    QObject::connect(&_indexThread, SIGNAL(finished()), _index, SLOT(deleteLater()));
+
+    _indexThread.start(QThread::LowPriority);
+}
+
+//**********************************************************************************************************************
+ScrollbackModel::~ScrollbackModel()
+{
+    _indexThread.quit();
+    _indexThread.wait();
+}
+
+//**********************************************************************************************************************
+qint64 ScrollbackModel::bytes() const
+{
+    return _bytes;
+}
+
+//**********************************************************************************************************************
+qint64 ScrollbackModel::residentBytes() const
+{
+    return _resident;
+}
+
+//**********************************************************************************************************************
+double ScrollbackModel::compressionRatio() const
+{
+    return _packedSize > 0 ? static_cast<double>(_packedRawSize) / _packedSize : 1.0;
+}
+
+//**********************************************************************************************************************
+qint64 ScrollbackModel::maxBytes() const
+{
+    return _maxBytes;
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::setMaxBytes(qint64 maxBytes)
+{
+    _maxBytes = maxBytes;
+
+    if (trim())
+        emit bytesChanged();
+}
+
+//**********************************************************************************************************************
+bool ScrollbackModel::hexMode() const
+{
+    return _hexMode;
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::setHexMode(bool hexMode)
+{
+    if (hexMode == _hexMode)
+        return;
+
+    _hexMode = hexMode;
+
+    // Views re-fetch only the rows they show
+    if (_count > 0)
+        emit dataChanged(index(0), index(_count - 1));
+
+    emit hexModeChanged();
+}
+
+//**********************************************************************************************************************
+ScrollbackModel::TimestampMode ScrollbackModel::timestampMode() const
+{
+    return _timestampMode;
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::setTimestampMode(TimestampMode mode)
+{
+    if (mode == _timestampMode)
+        return;
+
+    _timestampMode = mode;
+
+    if (_count > 0)
+        emit dataChanged(index(0), index(_count - 1));
+
+    emit timestampModeChanged();
+}
+
+//**********************************************************************************************************************
+TextDecoder::Encoding ScrollbackModel::encoding() const
+{
+    return _encoding;
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::setEncoding(TextDecoder::Encoding encoding)
+{
+    if (encoding == _encoding)
+        return;
+
+    _encoding = encoding;
+
+    if (_count > 0)
+        emit dataChanged(index(0), index(_count - 1));
+
+    emit encodingChanged();
+}
+
+//**********************************************************************************************************************
+int ScrollbackModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return _count;
+}
+
+//**********************************************************************************************************************
+QVariant ScrollbackModel::data(const QModelIndex &index, int role) const
+{
+    if (index.row() < 0 || index.row() >= _count)
+        return QVariant();
+
+    if (role == Qt::DisplayRole)
+    {
+        QString text;
+        QVector<AttrRun> runs;
+        rowText(index.row(), text, runs);
+        return text;
+    }
+
+    return QVariant();
+}
+
+//**********************************************************************************************************************
+QHash<int, QByteArray> ScrollbackModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[Qt::DisplayRole] = "display";
+    return roles;
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::rowText(int row, QString &text, QVector<AttrRun> &runs) const
+{
+    text.clear();
+    runs.clear();
+    if (row < 0 || row >= _count)
+        return;
+
+    TRACE_SPAN("ScrollbackModel::rowText");
+
+    int chunk, idx;
+    locate(row, chunk, idx);
+
+    const Chunk &c = chunkAt(chunk);
+    int begin = idx > 0 ? static_cast<int>(c.ends.at(idx - 1)) : 0;
+    int runBegin = idx > 0 ? static_cast<int>(c.runEnds.at(idx - 1)) : 0;
+    QByteArray raw = QByteArray::fromRawData(c.bytes.constData() + begin, static_cast<int>(c.ends.at(idx)) - begin);
+    FrameType type = c.types.at(idx);
+
+    // Text from here on is in attr
+    auto setAttr = [&](quint32 attr) {
+        quint32 offset = static_cast<quint32>(text.size());
+        if (!runs.isEmpty() && runs.last().offset == offset)
+            runs.last().attr = attr;
+        else if ((runs.isEmpty() ? 0 : runs.last().attr) != attr)
+            runs.append({ offset, attr });
+    };
+
+    if (_timestampMode != TimestampMode::NONE)
+    {
+        setAttr(AnsiParser::FAINT);
+        text += timestampText(row);
+        setAttr(0);
+        text += ' ';
+    }
+
+    quint32 base = type == FrameType::SENT ? static_cast<quint32>(AnsiParser::BOLD) : 0;
+    if (_hexMode && isSearchable(type))
+    {
+        setAttr(base);
+        text += HexDump::toText(raw.constData(), raw.size());
+        return;
+    }
+
+    switch (type)
+    {
+        case FrameType::RECEIVED:
+        case FrameType::SENT:
+        {
+            bool marked = _markFrame >= 0 && frameNumber(row) == static_cast<quint64>(_markFrame);
+            TextDecoder decoder(_encoding);
+            forEachSegment(raw.size(), c.runs.constData() + runBegin, static_cast<int>(c.runEnds.at(idx)) - runBegin,
+                           marked ? _markOffset : -1, _markLength, [&](int from, int to, quint32 attr, bool inMark) {
+                setAttr(attr | base | (inMark ? MARKED : 0));
+                decoder.decode(raw.constData() + from, to - from, text);
+            });
+            decoder.flush(text);
+            break;
+        }
+
+        case FrameType::COMMAND:
+            setAttr(BLUE | AnsiParser::BOLD);
+            text += "$ " + QString::fromUtf8(raw);
+            break;
+
+        case FrameType::COMMAND_RSP:
+        case FrameType::ERROR:
+        {
+            quint32 color = type == FrameType::ERROR ? RED : GREEN;
+            if (type == FrameType::ERROR)
+            {
+                setAttr(color);
+                text += "ERROR: ";
+            }
+
+            // UTF-8 with runs only where the producer put them, between characters
+            forEachSegment(raw.size(), c.runs.constData() + runBegin, static_cast<int>(c.runEnds.at(idx)) - runBegin,
+                           -1, 0, [&](int from, int to, quint32 attr, bool) {
+                setAttr(overlay(color, attr));
+                text += QString::fromUtf8(raw.constData() + from, to - from);
+            });
+            break;
+        }
+    }
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::appendBatch(const Continuation &last, const QVector<Frame> &frames)
+{
+    // Searchable data goes to the index; other frames are added empty to keep the numbering
+    quint64 firstIndexed = frameNumber(_count);
+    QVector<QByteArray> indexed;
+    indexed.reserve(frames.size() + 1);
+
+    if (last.keep >= 0 || !last.data.isEmpty())
+    {
+        if (_count > 0)
+        {
+            // Continue the last (open) frame; it is always the last one of the last chunk
+            continueLast(last);
+
+            --firstIndexed;
+            const Chunk &c = _chunks.last();
+            if (isSearchable(c.types.last()))
+            {
+                // With the two bytes before the new data for the trigrams across the join. Keys of cut data stay in
+                // the index, which only makes the chunk a candidate it need not be.
+                int tail = qMin(frameSize(_count - 1) - last.data.size(), 2);
+                indexed.append(c.bytes.right(last.data.size() + tail));
+            }
+            else
+            {
+                indexed.append(QByteArray());
+            }
+
+            QModelIndex idx = index(_count - 1);
+            emit dataChanged(idx, idx);
+        }
+        else if (!last.data.isEmpty())
+        {
+            beginInsertRows(QModelIndex(), 0, 0);
+            appendFrame({ FrameType::RECEIVED, last.data, Clock::now(), last.runs });
+            endInsertRows();
+
+            indexed.append(last.data);
+        }
+    }
+
+    if (!frames.isEmpty())
+    {
+        beginInsertRows(QModelIndex(), _count, _count + frames.size() - 1);
+        foreach (const Frame &frame, frames)
+        {
+            appendFrame(frame);
+            indexed.append(isSearchable(frame.type) ? frame.data : QByteArray());
+        }
+        endInsertRows();
+    }
+
+    _index->add(firstIndexed, indexed);
+
+    trim();
+
+    emit bytesChanged();
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::clear()
+{
+    beginResetModel();
+    _chunks.clear();
+    _firstChunk = 0;
+    _count = 0;
+    _bytes = 0;
+    _resident = 0;
+    _packedSize = 0;
+    _packedRawSize = 0;
+    _hot.clear();
+    _markFrame = -1;
+    _index->reset();
+    cancelFind();
+    endResetModel();
+
+    emit bytesChanged();
+}
+
+//**********************************************************************************************************************
+QByteArray ScrollbackModel::frameData(int row) const
+{
+    if (row < 0 || row >= _count)
+        return QByteArray();
+
+    int chunk, idx;
+    locate(row, chunk, idx);
+
+    const Chunk &c = chunkAt(chunk);
+    int begin = idx > 0 ? static_cast<int>(c.ends.at(idx - 1)) : 0;
+    return c.bytes.mid(begin, static_cast<int>(c.ends.at(idx)) - begin);
+}
+
+//**********************************************************************************************************************
+ScrollbackModel::FrameType ScrollbackModel::frameType(int row) const
+{
+    Q_ASSERT(row >= 0 && row < _count);
+
+    int chunk, idx;
+    locate(row, chunk, idx);
+
+    return chunkAt(chunk).types.at(idx);
+}
+
+//**********************************************************************************************************************
+qint64 ScrollbackModel::frameTimestamp(int row) const
+{
+    Q_ASSERT(row >= 0 && row < _count);
+
+    int chunk, idx;
+    locate(row, chunk, idx);
+
+    return chunkAt(chunk).timestamps.at(idx);
+}
+
+//**********************************************************************************************************************
+QVector<ScrollbackModel::AttrRun> ScrollbackModel::frameRuns(int row) const
+{
+    if (row < 0 || row >= _count)
+        return QVector<AttrRun>();
+
+    int chunk, idx;
+    locate(row, chunk, idx);
+
+    const Chunk &c = chunkAt(chunk);
+    int begin = idx > 0 ? static_cast<int>(c.runEnds.at(idx - 1)) : 0;
+    return c.runs.mid(begin, static_cast<int>(c.runEnds.at(idx)) - begin);
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::find(const QByteArray &text, bool backward, int row, int offset)
+{
+    int id = ++_search;
+
+    Search s;
+    s.firstChunk = _firstChunk;
+    s.count = text.isEmpty() ? 0 : _count;
+    s.text = text;
+    s.backward = backward;
+    s.row = row;
+    s.offset = offset;
+    if (s.count > 0)
+        s.chunks = _chunks;
+
+    for (int i = 0; i < s.text.size(); ++i)
+        s.text[i] = ScrollbackIndex::fold(s.text.at(i));
+
+    QMetaObject::invokeMethod(_index, [this, s, id]() {
+        int offset = 0;
+        qint64 frame = search(s, id, offset);
+        QMetaObject::invokeMethod(this, "findDone", Qt::QueuedConnection,
+                                  Q_ARG(int, id), Q_ARG(qint64, frame), Q_ARG(int, offset));
+    }, Qt::QueuedConnection);
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::cancelFind()
+{
+    ++_search;
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::findDone(int search, qint64 frame, int offset)
+{
+    if (search != _search)
+        return;
+
+    // Rows before it may have been dropped since the search started, or the match itself
+    qint64 first = static_cast<qint64>(frameNumber(0));
+    if (frame < first)
+        emit found(-1, 0);
+    else
+        emit found(static_cast<int>(frame - first), offset);
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::setMark(int row, int offset, int length)
+{
+    int oldRow = markRow();
+
+    _markFrame = static_cast<qint64>(frameNumber(row));
+    _markOffset = offset;
+    _markLength = length;
+
+    if (oldRow >= 0 && oldRow != row)
+        emit dataChanged(index(oldRow), index(oldRow));
+
+    emit dataChanged(index(row), index(row));
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::clearMark()
+{
+    int oldRow = markRow();
+
+    _markFrame = -1;
+
+    if (oldRow >= 0)
+        emit dataChanged(index(oldRow), index(oldRow));
+}
+
+//**********************************************************************************************************************
+int ScrollbackModel::markRow() const
+{
+    if (_markFrame < 0 || static_cast<quint64>(_markFrame) < frameNumber(0))
+        return -1;
+
+    return static_cast<int>(static_cast<quint64>(_markFrame) - frameNumber(0));
+}
+
+//**********************************************************************************************************************
+int ScrollbackModel::markOffset() const
+{
+    return _markOffset;
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::locate(int row, int &chunk, int &idx) const
+{
+    chunk = row / CHUNK_LEN;
+    idx = row % CHUNK_LEN;
+}
+
+//**********************************************************************************************************************
+int ScrollbackModel::frameSize(int row) const
+{
+    int chunk, idx;
+    locate(row, chunk, idx);
+
+    const Chunk &c = chunkAt(chunk);
+    quint32 begin = idx > 0 ? c.ends.at(idx - 1) : 0;
+    return static_cast<int>(c.ends.at(idx) - begin);
+}
+
+//**********************************************************************************************************************
+quint64 ScrollbackModel::frameNumber(int row) const
+{
+    return _firstChunk * CHUNK_LEN + static_cast<quint64>(row);
+}
+
+//**********************************************************************************************************************
+qint64 ScrollbackModel::search(const Search &s, int id, int &offset) const
+{
+    TRACE_SPAN("ScrollbackModel::search");
+
+    if (s.count == 0)
+        return -1;
+
+    QVector<quint32> keys = ScrollbackIndex::keys(s.text.constData(), s.text.size());
+
+    // Rows are visited from the start row on, wrapping around; the start row comes up once more at the end for the
+    // part before offset. Chunks the index rules out are skipped as a whole; a packed one is unpacked into a copy that
+    // is let go when the search moves on.
+    int r = s.row < 0 ? (s.backward ? s.count - 1 : 0) : s.row;
+    int from = s.row < 0 ? (s.backward ? INT_MAX : 0) : s.offset;
+    int left = s.count + 1;
+    int current = -1;
+    bool skip = false;
+    Chunk c;
+    while (left > 0)
+    {
+        int chunk, idx;
+        locate(r, chunk, idx);
+
+        if (chunk != current)
+        {
+            // Given up once overtaken by another search
+            if (_search != id)
+                return -1;
+
+            // The newest frame may have grown since it was indexed
+            current = chunk;
+            skip = chunk < s.chunks.size() - 1 &&
+                   !_index->mayContain(s.firstChunk + static_cast<quint64>(chunk), keys);
+            c = skip ? Chunk() : s.chunks.at(chunk);
+            if (!skip && c.ends.isEmpty())
+                unpack(c);
+        }
+
+        if (skip)
+        {
+            int first = chunk * CHUNK_LEN;
+            int end = qMin((chunk + 1) * CHUNK_LEN, s.count);
+
+            left -= s.backward ? r - first + 1 : end - r;
+            r = s.backward ? first - 1 : end;
+        }
+        else
+        {
+            int match = findInFrame(c, idx, s.text, from, s.backward);
+            if (match >= 0)
+            {
+                offset = match;
+                return static_cast<qint64>(s.firstChunk * CHUNK_LEN + static_cast<quint64>(r));
+            }
+
+            --left;
+            r += s.backward ? -1 : 1;
+        }
+
+        from = s.backward ? INT_MAX : 0;
+        if (r < 0)
+            r = s.count - 1;
+        else if (r >= s.count)
+            r = 0;
+    }
+
+    return -1;
+}
+
+//**********************************************************************************************************************
+int ScrollbackModel::findInFrame(const Chunk &c, int idx, const QByteArray &text, int from, bool backward)
+{
+    if (!isSearchable(c.types.at(idx)))
+        return -1;
+
+    int begin = idx > 0 ? static_cast<int>(c.ends.at(idx - 1)) : 0;
+    const char *data = c.bytes.constData() + begin;
+    const char *needle = text.constData();
+    int n = text.size();
+    int last = static_cast<int>(c.ends.at(idx)) - begin - n; // Last possible match
+
+    // text is already folded
+    int i = backward ? qMin(from, last) : qMax(from, 0);
+    int step = backward ? -1 : 1;
+    for (; i >= 0 && i <= last; i += step)
+    {
+        if (ScrollbackIndex::fold(data[i]) != needle[0])
+            continue;
+
+        int j = 1;
+        while (j < n && ScrollbackIndex::fold(data[i + j]) == needle[j])
+            ++j;
+
+        if (j == n)
+            return i;
+    }
+
+    return -1;
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::appendFrame(const Frame &frame)
+{
+    if (_chunks.isEmpty() || _chunks.last().ends.size() == CHUNK_LEN)
+    {
+        if (!_chunks.isEmpty())
+            pack(_chunks.size() - 1);
+
+        _chunks.append(Chunk());
+        _chunks.last().ends.reserve(CHUNK_LEN);
+        _chunks.last().types.reserve(CHUNK_LEN);
+        _chunks.last().timestamps.reserve(CHUNK_LEN);
+        _chunks.last().runEnds.reserve(CHUNK_LEN);
+    }
+
+    Chunk &last = _chunks.last();
+    last.bytes.append(frame.data);
+    last.ends.append(static_cast<quint32>(last.bytes.size()));
+    last.types.append(frame.type);
+    last.timestamps.append(frame.timestamp);
+    last.runs += frame.runs;
+    last.runEnds.append(static_cast<quint32>(last.runs.size()));
+
+    qint64 size = frame.data.size() + frame.runs.size() * RUN_SIZE + FRAME_OVERHEAD;
+    last.size += size;
+    _bytes += size;
+    _resident += size;
+    ++_count;
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::continueLast(const Continuation &last)
+{
+    Chunk &c = _chunks.last();
+    int n = c.ends.size();
+    int begin = n > 1 ? static_cast<int>(c.ends.at(n - 2)) : 0;
+    int runBegin = n > 1 ? static_cast<int>(c.runEnds.at(n - 2)) : 0;
+
+    qint64 size = last.data.size() + last.runs.size() * RUN_SIZE;
+    if (last.keep >= 0 && begin + last.keep < c.bytes.size())
+    {
+        int runs = c.runs.size();
+        while (c.runs.size() > runBegin && c.runs.last().offset >= static_cast<quint32>(last.keep))
+            c.runs.removeLast();
+
+        size -= c.bytes.size() - begin - last.keep + (runs - c.runs.size()) * RUN_SIZE;
+        c.bytes.truncate(begin + last.keep);
+    }
+
+    c.bytes.append(last.data);
+    c.runs += last.runs;
+    c.ends.last() = static_cast<quint32>(c.bytes.size());
+    c.runEnds.last() = static_cast<quint32>(c.runs.size());
+
+    c.size += size;
+    _bytes += size;
+    _resident += size;
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::pack(int chunk)
+{
+    TRACE_SPAN("ScrollbackModel::pack");
+
+    // Frame and run counts, then the fields back to back; the byte count is the last end
+    Chunk &c = _chunks[chunk];
+    qint32 counts[2] = { c.ends.size(), c.runs.size() };
+    QByteArray raw;
+    raw.reserve(static_cast<int>(sizeof(counts) + c.size));
+    raw.append(reinterpret_cast<const char *>(counts), sizeof(counts));
+    appendRaw(raw, c.ends);
+    appendRaw(raw, c.types);
+    appendRaw(raw, c.timestamps);
+    appendRaw(raw, c.runEnds);
+    appendRaw(raw, c.runs);
+    raw.append(c.bytes);
+
+    // The fastest level; text still packs several times smaller
+    c.packed = qCompress(raw, 1);
+    _packedSize += c.packed.size();
+    _packedRawSize += c.size;
+    _resident += c.packed.size();
+
+    // Just written, so likely still in view
+    hold(chunk);
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::unpack(Chunk &chunk)
+{
+    TRACE_SPAN("ScrollbackModel::unpack");
+
+    QByteArray raw = qUncompress(chunk.packed);
+
+    const char *in = raw.constData();
+    qint32 counts[2];
+    std::memcpy(counts, in, sizeof(counts));
+    in += sizeof(counts);
+
+    in = takeRaw(in, chunk.ends, counts[0]);
+    in = takeRaw(in, chunk.types, counts[0]);
+    in = takeRaw(in, chunk.timestamps, counts[0]);
+    in = takeRaw(in, chunk.runEnds, counts[0]);
+    in = takeRaw(in, chunk.runs, counts[1]);
+    chunk.bytes = QByteArray(in, static_cast<int>(raw.constData() + raw.size() - in));
+}
+
+//**********************************************************************************************************************
+const ScrollbackModel::Chunk &ScrollbackModel::chunkAt(int chunk) const
+{
+    Chunk &c = _chunks[chunk];
+    if (c.packed.isEmpty())
+        return c;
+
+    if (c.ends.isEmpty())
+    {
+        unpack(c);
+        _resident += c.size;
+
+        // For the resident bytes shown; not from within a view's data() call
+        QMetaObject::invokeMethod(const_cast<ScrollbackModel *>(this), "bytesChanged", Qt::QueuedConnection);
+    }
+
+    hold(chunk);
+    return c;
+}
+
+//**********************************************************************************************************************
+void ScrollbackModel::hold(int chunk) const
+{
+    quint64 number = _firstChunk + static_cast<quint64>(chunk);
+    if (!_hot.isEmpty() && _hot.first() == number)
+        return;
+
+    _hot.removeOne(number);
+    _hot.prepend(number);
+
+    // The least recently read chunk is only kept packed
+    while (_hot.size() > HOT_CHUNKS)
+    {
+        Chunk &c = _chunks[static_cast<int>(_hot.takeLast() - _firstChunk)];
+        c.bytes = QByteArray();
+        c.ends = QVector<quint32>();
+        c.types = QVector<FrameType>();
+        c.timestamps = QVector<qint64>();
+        c.runs = QVector<AttrRun>();
+        c.runEnds = QVector<quint32>();
+        _resident -= c.size;
+    }
+}
+
+//**********************************************************************************************************************
+bool ScrollbackModel::trim()
+{
+    // Memory is freed a whole chunk at a time; the newest chunk always stays, its last frame may still be open
+    int drop = 0;
+    qint64 freed = 0;
+    while (drop < _chunks.size() - 1 && _resident - freed > _maxBytes)
+    {
+        const Chunk &c = _chunks.at(drop);
+        freed += c.packed.size() + (c.ends.isEmpty() ? 0 : c.size);
+        ++drop;
+    }
+
+    if (drop == 0)
+        return false;
+
+    // Only full chunks are dropped
+    int rows = drop * CHUNK_LEN;
+    beginRemoveRows(QModelIndex(), 0, rows - 1);
+
+    for (int i = 0; i < drop; ++i)
+    {
+        const Chunk &c = _chunks.first();
+        _bytes -= c.size;
+        _packedSize -= c.packed.size();
+        _packedRawSize -= c.size;
+        _chunks.removeFirst();
+    }
+
+    _firstChunk += static_cast<quint64>(drop);
+    _count -= rows;
+    _resident -= freed;
+
+    for (int i = _hot.size() - 1; i >= 0; --i)
+    {
+        if (_hot.at(i) < _firstChunk)
+            _hot.removeAt(i);
+    }
+
+    _index->dropBefore(_firstChunk);
+
+    endRemoveRows();
+
+    return true;
+}
+
+//**********************************************************************************************************************
+QString ScrollbackModel::timestampText(int row) const
+{
+    qint64 stamp = frameTimestamp(row);
+
+    // The first row has nothing to be relative to; its time of day anchors the deltas after it
+    QString text;
+    if (_timestampMode == TimestampMode::ABSOLUTE || row == 0)
+    {
+        qint64 epochNs = Clock::toEpoch(stamp);
+        text = QDateTime::fromMSecsSinceEpoch(epochNs / 1000000).toString("HH:mm:ss.zzz") +
+               QString("%1").arg((epochNs / 1000) % 1000, 3, 10, QChar('0'));
+    }
+    else
+    {
+        // Sent and command frames are stamped on the UI side and may land a hair before received data
+        qint64 delta = stamp - frameTimestamp(row - 1);
+        text = (delta < 0 ? "-" : "+") + QString::number(qAbs(delta) / 1e9, 'f', 6);
+    }
+
+    return "[" + text + "]";
+}
+
+//**********************************************************************************************************************
+bool ScrollbackModel::isSearchable(FrameType type)
+{
+    return type == FrameType::RECEIVED || type == FrameType::SENT;
+}
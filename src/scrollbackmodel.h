@@ -0,0 +1,232 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef SCROLLBACKMODEL_H
+#define SCROLLBACKMODEL_H
+
+#include <QAbstractListModel>
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+#include <QThread>
+
+#include <atomic>
+
+#include "textdecoder.h"
+
+class ScrollbackIndex;
+
+//**********************************************************************************************************************
+// Scrollback store exposed to QML as a list model, one row per frame (message).
+//
+// Frames are kept as raw bytes in fixed-size chunks: each chunk holds one contiguous byte buffer plus the end offset,
+// type, Clock timestamp and display attribute runs (see AnsiParser) of every frame in it. Appending never moves
+// existing frames. Decoding (see TextDecoder) into text with attributes, or a hex dump, happens in rowText(), so only
+// rows that a view actually shows pay for it.
+//
+// A chunk is packed with qCompress() once it is full. Only the newest chunk and the HOT_CHUNKS most recently read ones
+// are also held unpacked; any other is unpacked again when a view scrolls or a search gets into it. Memory held
+// (residentBytes()) is bounded by maxBytes(); past that, the oldest chunks are dropped.
+//
+// Received and sent frames can be searched with find(). The search runs on the thread of a ScrollbackIndex, kept up
+// to date there, which lets it skip whole chunks that cannot contain the text; it scans a snapshot of the chunks, which
+// shares their data until the model changes it. One match can be marked to be highlighted.
+class ScrollbackModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(qint64 bytes READ bytes NOTIFY bytesChanged)
+    Q_PROPERTY(qint64 residentBytes READ residentBytes NOTIFY bytesChanged)
+    Q_PROPERTY(double compressionRatio READ compressionRatio NOTIFY bytesChanged)
+    Q_PROPERTY(bool hexMode READ hexMode WRITE setHexMode NOTIFY hexModeChanged)
+    Q_PROPERTY(TimestampMode timestampMode READ timestampMode WRITE setTimestampMode NOTIFY timestampModeChanged)
+
+public:
+    enum class FrameType : quint8
+    {
+        RECEIVED,
+        SENT,
+        COMMAND,
+        COMMAND_RSP, // UTF-8 text; its runs are on top of the model's colour
+        ERROR        // UTF-8 text; its runs are on top of the model's colour
+    };
+
+    enum class TimestampMode
+    {
+        NONE,
+        ABSOLUTE, // Wall-clock time of day
+        DELTA     // Seconds since the previous frame
+    };
+    Q_ENUM(TimestampMode)
+
+    // Display attribute (AnsiParser) from offset on, up to the next run; text before the first run has the default
+    struct AttrRun
+    {
+        quint32 offset; // From the start of the frame
+        quint32 attr;
+    };
+
+    struct Frame
+    {
+        FrameType type;
+        QByteArray data;
+        qint64 timestamp; // Clock::now() when the first byte arrived or the frame was made
+        QVector<AttrRun> runs;
+    };
+
+    // Changes to the last (open) frame: cut to keep bytes if keep is not negative, then extended
+    struct Continuation
+    {
+        int keep = -1;
+        QByteArray data;
+        QVector<AttrRun> runs;
+    };
+
+    static const qint64 DEFAULT_MAX_BYTES = 64 * 1024 * 1024;
+
+    explicit ScrollbackModel(QObject *parent = nullptr);
+    ~ScrollbackModel();
+
+    qint64 bytes() const;          // Of all frames, unpacked
+    qint64 residentBytes() const;  // Held in memory, packed or not
+    double compressionRatio() const; // Of the packed chunks
+    qint64 maxBytes() const;
+    void setMaxBytes(qint64 maxBytes);
+    bool hexMode() const;
+    void setHexMode(bool hexMode);
+    TimestampMode timestampMode() const;
+    void setTimestampMode(TimestampMode mode);
+    TextDecoder::Encoding encoding() const; // Of received and sent frames
+    void setEncoding(TextDecoder::Encoding encoding);
+
+    // last changes the last frame; frames are added after it
+    void appendBatch(const Continuation &last, const QVector<Frame> &frames);
+    void clear();
+
+    // Plain text of a row, also data() for DisplayRole, for views that draw text themselves; runs are attributes over
+    // it with offsets in QChars, MARKED added over the marked match
+    void rowText(int row, QString &text, QVector<AttrRun> &runs) const;
+    static const quint32 MARKED = 1u << 31;
+
+    // Raw frame contents, as received or sent
+    QByteArray frameData(int row) const;
+    FrameType frameType(int row) const;
+    qint64 frameTimestamp(int row) const;
+    QVector<AttrRun> frameRuns(int row) const;
+
+    // Searches received and sent frames for text, ignoring ASCII case. Starts at row/offset (inclusive), or at the
+    // first (last if backward) row if row is -1, and wraps around once. found() reports the match; a search overtaken
+    // by another find(), cancelFind() or clear() reports nothing.
+    void find(const QByteArray &text, bool backward, int row, int offset);
+    void cancelFind();
+
+    // Marked match; follows its frame as older rows are dropped
+    void setMark(int row, int offset, int length);
+    void clearMark();
+    int markRow() const; // -1 if no mark or if its frame was dropped
+    int markOffset() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void bytesChanged();
+    void hexModeChanged();
+    void timestampModeChanged();
+    void encodingChanged();
+    void found(int row, int offset); // row is -1 if there is no match
+
+private slots:
+    void findDone(int search, qint64 frame, int offset);
+
+private:
+    static const int CHUNK_LEN = 1024;                // Frames per chunk
+    static const int HOT_CHUNKS = 8;                  // Packed chunks also held unpacked, most recently read
+    static const int FRAME_OVERHEAD = 2 * sizeof(quint32) + sizeof(FrameType) + sizeof(qint64);
+    static const int RUN_SIZE = sizeof(AttrRun);
+
+    struct Chunk
+    {
+        QByteArray bytes;        // All frames of the chunk back to back
+        QVector<quint32> ends;   // End offset of each frame in bytes
+        QVector<FrameType> types;
+        QVector<qint64> timestamps;
+        QVector<AttrRun> runs;   // Of all frames back to back; most frames have none
+        QVector<quint32> runEnds; // End index of each frame's runs
+
+        qint64 size = 0;  // Of the fields above, as counted in bytes()
+        QByteArray packed; // All of them once the chunk is full; they are left empty while it is not read
+    };
+
+    struct Search
+    {
+        QList<Chunk> chunks; // Snapshot of the model's
+        quint64 firstChunk;
+        int count;
+        QByteArray text;     // Folded
+        bool backward;
+        int row;
+        int offset;
+    };
+
+    void locate(int row, int &chunk, int &idx) const;
+    const Chunk &chunkAt(int chunk) const; // Unpacked
+    int frameSize(int row) const;
+    void appendFrame(const Frame &frame);
+    void continueLast(const Continuation &last);
+    void pack(int chunk);
+    static void unpack(Chunk &chunk);
+    void hold(int chunk) const;
+    bool trim(); // True if chunks were dropped
+    quint64 frameNumber(int row) const;
+    qint64 search(const Search &s, int id, int &offset) const; // Frame number of the match or -1
+    static int findInFrame(const Chunk &c, int idx, const QByteArray &text, int from, bool backward);
+    QString timestampText(int row) const;
+    static bool isSearchable(FrameType type);
+
+    mutable QList<Chunk> _chunks; // Only the last chunk is ever appended to; the others are unpacked when read
+    quint64 _firstChunk;          // Chunks dropped since the last clear(); frames are numbered from there
+    int _count;
+    qint64 _bytes;
+    mutable qint64 _resident;
+    qint64 _packedSize;           // Of the packed chunks, packed and unpacked
+    qint64 _packedRawSize;
+    mutable QList<quint64> _hot;  // Numbers of the packed chunks held unpacked, most recently read first
+    qint64 _maxBytes;
+    bool _hexMode;
+    TimestampMode _timestampMode;
+    TextDecoder::Encoding _encoding;
+
+    qint64 _markFrame; // Frame number of the marked match or -1
+    int _markOffset;
+    int _markLength;
+
+    QThread _indexThread;
+    ScrollbackIndex *_index; // Lives in _indexThread
+    std::atomic<int> _search; // Of the latest find(); read by the search running in _indexThread
+};
+
+Q_DECLARE_TYPEINFO(ScrollbackModel::AttrRun, Q_PRIMITIVE_TYPE);
+
+#endif // SCROLLBACKMODEL_H
@@ -0,0 +1,554 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "serialworker.h"
+#include "tracer.h"
+#include "clock.h"
+
+#include <QtDebug>
+
+#include <cstring>
+
+//**********************************************************************************************************************
+SerialWorker::SerialWorker(CaptureLogger &logger, QObject *parent) :
+    QObject(parent),
+    _port(new QSerialPort(this)),
+    _logger(logger),
+    _rxQueue(RX_QUEUE_LEN),
+    _injected(),
+    _txQueue(TX_QUEUE_LEN),
+    _rxNotified(false),
+    _rxStalled(false),
+    _txScheduled(false),
+    _txBacklog(),
+    _txCurrent(),
+    _txOffset(0),
+    _sendFile(this),
+    _sendData(nullptr),
+    _sendSize(0),
+    _sendOffset(0),
+    _sendBytesPerSec(0),
+    _sendLineDelayMs(0),
+    _linePause(LinePause::NONE),
+    _sendClock(),
+    _sendProgressClock(),
+    _paceTimer(new QTimer(this)),
+    _triggers(),
+    _matches(),
+    _watchWaits(false),
+    _waitRx(),
+    _waitScanned(0),
+    _wait(-1),
+    _waitLiteral(),
+    _waitRegex()
+{
+    qRegisterMetaType<PortSettings>();
+    qRegisterMetaType<QList<Trigger>>("QList<Trigger>");
+    qRegisterMetaType<QList<QByteArray>>("QList<QByteArray>");
+
+    _paceTimer->setSingleShot(true);
+    _paceTimer->setTimerType(Qt::PreciseTimer);
+
+    QObject::connect(_port, SIGNAL(readyRead()), this, SLOT(drain()));
+    QObject::connect(_port, SIGNAL(bytesWritten(qint64)), this, SLOT(flushWrites()));
+    QObject::connect(_paceTimer, SIGNAL(timeout()), this, SLOT(flushWrites()));
+}
+
+//**********************************************************************************************************************
+SerialWorker::~SerialWorker()
+{
+    _port->close();
+}
+
+//**********************************************************************************************************************
+bool SerialWorker::readChunk(QByteArray &chunk, qint64 &timestamp, bool &transmitted)
+{
+    RxChunk rx;
+    if (!_rxQueue.pop(rx))
+    {
+        // Queue looks empty; re-arm notification and check again in case a chunk raced in before the flag was cleared
+        _rxNotified.store(false);
+        if (!_rxQueue.pop(rx))
+            return false;
+    }
+
+    chunk = rx.data;
+    timestamp = rx.timestamp;
+    transmitted = rx.transmitted;
+
+    // Freed a slot; let the I/O thread pick up whatever it had to leave in the port buffer
+    if (_rxStalled.exchange(false))
+        QMetaObject::invokeMethod(this, "drain", Qt::QueuedConnection);
+
+    return true;
+}
+
+//**********************************************************************************************************************
+bool SerialWorker::queueWrite(const QByteArray &data)
+{
+    if (!_txQueue.push(data))
+        return false;
+
+    if (!_txScheduled.exchange(true))
+        QMetaObject::invokeMethod(this, "flushWrites", Qt::QueuedConnection);
+
+    return true;
+}
+
+//**********************************************************************************************************************
+void SerialWorker::open(const PortSettings &settings)
+{
+    if (_port->isOpen())
+        _port->close();
+
+    configure(settings);
+    _triggers.reset();
+
+    if (_port->open(QIODevice::ReadWrite))
+    {
+        emit openChanged(true);
+    }
+    else
+    {
+        qWarning() << "Could not connect\nError code: " << _port->error() << "\nError description: "
+                   << _port->errorString();
+
+        emit openFailed(_port->errorString());
+    }
+}
+
+//**********************************************************************************************************************
+void SerialWorker::close()
+{
+    _port->close();
+
+    // Anything not yet drained belongs to the closed session
+    QByteArray discard;
+    while (_txQueue.pop(discard))
+        ;
+
+    _txBacklog.clear();
+    _txCurrent.clear();
+    if (_sendData)
+        finishSend("Port closed");
+
+    emit openChanged(false);
+}
+
+//**********************************************************************************************************************
+void SerialWorker::applySettings(const PortSettings &settings)
+{
+    configure(settings);
+}
+
+//**********************************************************************************************************************
+void SerialWorker::sendFile(const QString &fileName, qint64 bytesPerSec, int lineDelayMs)
+{
+    if (_sendData)
+    {
+        emit sendFinished(0, 0, "Already sending " + _sendFile.fileName());
+        return;
+    }
+
+    if (!_port->isOpen())
+    {
+        emit sendFinished(0, 0, "Port is not open");
+        return;
+    }
+
+    _sendFile.setFileName(fileName);
+    if (!_sendFile.open(QIODevice::ReadOnly))
+    {
+        emit sendFinished(0, 0, _sendFile.errorString());
+        return;
+    }
+
+    _sendSize = _sendFile.size();
+    if (_sendSize == 0)
+    {
+        _sendFile.close();
+        emit sendFinished(0, 0, QString());
+        return;
+    }
+
+    _sendData = _sendFile.map(0, _sendSize);
+    if (!_sendData)
+    {
+        QString errorString = _sendFile.errorString();
+        _sendFile.close();
+        emit sendFinished(0, 0, errorString);
+        return;
+    }
+
+    // Whatever was typed before the file goes out before it
+    QByteArray data;
+    while (_txQueue.pop(data))
+        _txBacklog << data;
+
+    _sendOffset = 0;
+    _sendBytesPerSec = qMax(Q_INT64_C(0), bytesPerSec);
+    _sendLineDelayMs = qMax(0, lineDelayMs);
+    _linePause = LinePause::NONE;
+    _sendClock.start();
+    _sendProgressClock.start();
+
+    emit sendProgress(0, _sendSize);
+
+    flushWrites();
+}
+
+//**********************************************************************************************************************
+void SerialWorker::cancelSend()
+{
+    if (_sendData)
+        finishSend("Cancelled");
+}
+
+//**********************************************************************************************************************
+void SerialWorker::setTriggers(const QList<Trigger> &triggers)
+{
+    _triggers.setTriggers(triggers);
+}
+
+//**********************************************************************************************************************
+void SerialWorker::setRxEom(const QList<QByteArray> &delimiters)
+{
+    _triggers.setDelimiters(delimiters);
+    _triggers.reset();
+}
+
+//**********************************************************************************************************************
+void SerialWorker::inject(const QByteArray &data, qint64 timestamp, bool transmitted)
+{
+    // Queued like port data; if the queue is full, it waits here for readChunk() to make room
+    _injected.append({ data, timestamp, transmitted });
+    drain();
+}
+
+//**********************************************************************************************************************
+void SerialWorker::watchWaits(bool watch)
+{
+    _watchWaits = watch;
+    _waitRx.clear();
+    _waitScanned = 0;
+    _wait = -1;
+}
+
+//**********************************************************************************************************************
+void SerialWorker::startWait(int wait, const QByteArray &literal, const QString &regex)
+{
+    _wait = wait;
+    _waitLiteral.setPattern(literal);
+    _waitRegex.setPattern(regex);
+    _waitRegex.optimize();
+    _waitScanned = 0;
+
+    // Data read before may already match
+    runWait(Clock::now());
+}
+
+//**********************************************************************************************************************
+void SerialWorker::drain()
+{
+    TRACE_SPAN("SerialWorker::drain");
+
+    while (!_injected.isEmpty() || _port->bytesAvailable() > 0)
+    {
+        if (_rxQueue.isFull())
+        {
+            // Consumer is behind; QSerialPort keeps buffering from the device, so leave the data there until
+            // readChunk() frees a slot and reschedules us. Re-check after raising the flag in case that just happened.
+            _rxStalled.store(true);
+            if (_rxQueue.isFull())
+                break;
+
+            _rxStalled.store(false);
+        }
+
+        // Trigger latency counts from now even for replayed data, which is shown with its own stamp
+        qint64 readNs = Clock::now();
+        bool replayed = !_injected.isEmpty();
+        RxChunk rx;
+        if (replayed)
+        {
+            rx = _injected.takeFirst();
+        }
+        else
+        {
+            rx = { _port->readAll(), readNs, false };
+            _logger.log(CaptureLogger::Direction::RECEIVED, rx.data);
+        }
+
+        _rxQueue.push(rx);
+
+        if (!_rxNotified.exchange(true))
+            emit readyRead();
+
+        if (!rx.transmitted && !_triggers.isEmpty())
+            runTriggers(rx.data, readNs, replayed);
+
+        if (!rx.transmitted && _watchWaits)
+        {
+            _waitRx.append(rx.data);
+            if (_waitRx.size() > MAX_WAIT_BYTES)
+            {
+                int drop = _waitRx.size() - MAX_WAIT_BYTES;
+                _waitRx.remove(0, drop);
+                _waitScanned = qMax(0, _waitScanned - drop);
+            }
+
+            runWait(readNs);
+        }
+    }
+}
+
+//**********************************************************************************************************************
+void SerialWorker::flushWrites()
+{
+    _txScheduled.store(false);
+
+    if (!_port->isOpen())
+    {
+        QByteArray discard;
+        while (_txQueue.pop(discard))
+            ;
+
+        return;
+    }
+
+    // Order: backlog from before a file send, the file, then everything queued since
+    while (_port->bytesToWrite() < TX_HIGH_WATER)
+    {
+        if (_txCurrent.isEmpty())
+        {
+            _txOffset = 0;
+            if (!_txBacklog.isEmpty())
+            {
+                _txCurrent = _txBacklog.takeFirst();
+            }
+            else if (_sendData)
+            {
+                if (!sendFileChunk())
+                    break;
+
+                continue;
+            }
+            else if (!_txQueue.pop(_txCurrent))
+            {
+                break;
+            }
+        }
+
+        int len = qMin(_txCurrent.size() - _txOffset, static_cast<int>(TX_CHUNK));
+        if (!writeChunk(_txCurrent.constData() + _txOffset, len))
+        {
+            _txCurrent.clear();
+            break;
+        }
+
+        _txOffset += len;
+        if (_txOffset >= _txCurrent.size())
+            _txCurrent.clear();
+    }
+}
+
+//**********************************************************************************************************************
+void SerialWorker::runTriggers(const QByteArray &data, qint64 readNs, bool replayed)
+{
+    _matches.clear();
+    _triggers.feed(data, _matches);
+
+    foreach (const TriggerEngine::Match &match, _matches)
+    {
+        const Trigger &trigger = _triggers.trigger(match.trigger);
+        if (trigger.action == Trigger::Action::SEND && replayed)
+            continue; // The log has the response as it was sent
+
+        if (trigger.action == Trigger::Action::SEND && !_triggers.response(match.trigger).isEmpty())
+        {
+            _txBacklog << _triggers.response(match.trigger);
+            flushWrites();
+        }
+
+        emit triggered(trigger.name, match.text, Clock::now() - readNs);
+    }
+}
+
+//**********************************************************************************************************************
+void SerialWorker::runWait(qint64 readNs)
+{
+    if (_wait < 0)
+        return;
+
+    int end = -1;
+    if (_waitRegex.pattern().isEmpty())
+    {
+        int len = _waitLiteral.pattern().size();
+        int pos = _waitLiteral.indexIn(_waitRx, qMax(0, _waitScanned - len + 1));
+        if (pos >= 0)
+            end = pos + len;
+    }
+    else
+    {
+        QRegularExpressionMatch m = _waitRegex.match(QString::fromLatin1(_waitRx));
+        if (m.hasMatch())
+            end = m.capturedEnd();
+    }
+
+    if (end < 0)
+    {
+        _waitScanned = _waitRx.size();
+        return;
+    }
+
+    // The next wait only sees what arrives after this match
+    _waitRx.remove(0, end);
+    _waitScanned = 0;
+
+    emit waitMatched(_wait, readNs);
+    _wait = -1;
+}
+
+//**********************************************************************************************************************
+bool SerialWorker::writeChunk(const char *data, qint64 len)
+{
+    // QSerialPort takes all of it into its buffer or fails
+    if (_port->write(data, len) != len)
+    {
+        qWarning() << "Write failed:" << _port->errorString();
+        return false;
+    }
+
+    _logger.log(CaptureLogger::Direction::TRANSMITTED, QByteArray(data, static_cast<int>(len)));
+
+    return true;
+}
+
+//**********************************************************************************************************************
+bool SerialWorker::sendFileChunk()
+{
+    // The line delay counts from when the line has left the port's buffer
+    if (_linePause == LinePause::DRAINING)
+    {
+        if (_port->bytesToWrite() > 0)
+            return false; // bytesWritten() calls again
+
+        _linePause = LinePause::DELAYING;
+        _paceTimer->start(_sendLineDelayMs);
+        return false;
+    }
+    else if (_linePause == LinePause::DELAYING)
+    {
+        if (_paceTimer->isActive())
+            return false;
+
+        _linePause = LinePause::NONE;
+    }
+
+    qint64 len = qMin(_sendSize - _sendOffset, static_cast<qint64>(TX_CHUNK));
+
+    // Pacing: stay at or below the byte rate measured from the start of the send
+    if (_sendBytesPerSec > 0)
+    {
+        qint64 allowed = static_cast<qint64>(_sendClock.nsecsElapsed() / 1e9 * _sendBytesPerSec) - _sendOffset;
+        if (allowed <= 0)
+        {
+            qint64 waitMs = (-allowed * 1000) / _sendBytesPerSec + 1;
+            _paceTimer->start(static_cast<int>(qMin(waitMs, Q_INT64_C(1000))));
+            return false;
+        }
+
+        len = qMin(len, allowed);
+    }
+
+    // With a line delay, every chunk ends at the end of a line
+    const char *data = reinterpret_cast<const char *>(_sendData) + _sendOffset;
+    bool lineEnd = false;
+    if (_sendLineDelayMs > 0)
+    {
+        const char *nl = static_cast<const char *>(memchr(data, '\n', static_cast<size_t>(len)));
+        if (nl)
+        {
+            len = nl - data + 1;
+            lineEnd = true;
+        }
+    }
+
+    if (!writeChunk(data, len))
+    {
+        finishSend(_port->errorString());
+        return false;
+    }
+
+    _sendOffset += len;
+
+    if (_sendOffset >= _sendSize)
+    {
+        finishSend(QString());
+        return true;
+    }
+
+    if (_sendProgressClock.elapsed() >= SEND_PROGRESS_MS)
+    {
+        _sendProgressClock.restart();
+        emit sendProgress(_sendOffset, _sendSize);
+    }
+
+    if (lineEnd)
+    {
+        _linePause = LinePause::DRAINING;
+        return false;
+    }
+
+    return true;
+}
+
+//**********************************************************************************************************************
+void SerialWorker::finishSend(const QString &errorString)
+{
+    qint64 sent = _sendOffset;
+    qint64 total = _sendSize;
+
+    _paceTimer->stop();
+    _sendFile.unmap(const_cast<uchar *>(_sendData));
+    _sendFile.close();
+    _sendData = nullptr;
+    _sendSize = 0;
+    _sendOffset = 0;
+
+    emit sendFinished(sent, total, errorString);
+}
+
+//**********************************************************************************************************************
+void SerialWorker::configure(const PortSettings &settings)
+{
+    if (!_port->isOpen())
+        _port->setPortName(settings.name);
+
+    _port->setBaudRate(settings.baudRate);
+    _port->setDataBits(settings.dataBits);
+    _port->setParity(settings.parity);
+    _port->setStopBits(settings.stopBits);
+    _port->setFlowControl(settings.flowControl);
+}
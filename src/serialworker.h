@@ -0,0 +1,189 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef SERIALWORKER_H
+#define SERIALWORKER_H
+
+#include "spscqueue.h"
+#include "capturelogger.h"
+#include "triggerengine.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QSerialPort>
+#include <QMetaType>
+#include <QFile>
+#include <QList>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QByteArrayMatcher>
+#include <QRegularExpression>
+#include <QVector>
+
+#include <atomic>
+
+//**********************************************************************************************************************
+struct PortSettings
+{
+    QString name;
+    qint32 baudRate = QSerialPort::Baud9600;
+    QSerialPort::DataBits dataBits = QSerialPort::Data8;
+    QSerialPort::Parity parity = QSerialPort::NoParity;
+    QSerialPort::StopBits stopBits = QSerialPort::OneStop;
+    QSerialPort::FlowControl flowControl = QSerialPort::NoFlowControl;
+};
+
+Q_DECLARE_METATYPE(PortSettings)
+
+//**********************************************************************************************************************
+// Owns the serial port and services it from a dedicated I/O thread.
+//
+// Received chunks are handed to the UI side through a lock-free SPSC queue and transmitted data comes back the same
+// way, so a busy UI never delays draining the device and the device never waits on the UI. readChunk() and
+// queueWrite() are the only members meant to be called from outside the I/O thread; everything else is reached
+// through queued slot invocations.
+//
+// Transmission keeps at most TX_HIGH_WATER bytes in the port's own buffer and continues as bytesWritten() reports
+// progress, so a large message or file never queues more than the device (or its flow control) accepts. Files are
+// streamed from a memory-mapped view, optionally paced to a byte rate and with a delay after each line.
+//
+// Triggers are matched here as data is read, before it is queued for display; SEND responses are written right away
+// and ahead of a file being sent, so the response time does not depend on how busy the UI is. Script waits (see
+// ScriptRunner) are matched here too: while watched, received data is kept for the next wait, and only a match is
+// reported to the UI thread.
+//
+// inject() takes data replayed from a capture log (see SessionReplayer) the same way as data read from the port, so
+// that triggers, framing and the display all see it as they would in a live session. It is not captured again.
+// Replayed transmitted data is passed on in the same queue, marked as such, so it stays in order with the received
+// data around it. Trigger SEND responses to replayed data are not written to the port and not reported, since the
+// log already holds what was sent in response.
+class SerialWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SerialWorker(CaptureLogger &logger, QObject *parent = nullptr);
+    ~SerialWorker();
+
+    // Consumer thread
+    // timestamp is Clock::now() when the chunk was read from the port; transmitted is only set for replayed data that
+    // was sent rather than received
+    bool readChunk(QByteArray &chunk, qint64 &timestamp, bool &transmitted);
+    bool queueWrite(const QByteArray &data);
+
+signals:
+    void readyRead(); // Emitted once per batch of chunks queued while the consumer was idle
+    void openChanged(bool isOpen);
+    void openFailed(QString errorString);
+    void sendProgress(qint64 sent, qint64 total);
+    void sendFinished(qint64 sent, qint64 total, QString errorString); // errorString is empty on success
+    void triggered(QString name, QByteArray match, qint64 latencyNs); // Latency from reading the data to responding
+    void waitMatched(int wait, qint64 timestamp); // Clock::now() when the matching data was read
+
+public slots:
+    void open(const PortSettings &settings);
+    void close();
+    void applySettings(const PortSettings &settings);
+    void sendFile(const QString &fileName, qint64 bytesPerSec, int lineDelayMs);
+    void cancelSend();
+    void setTriggers(const QList<Trigger> &triggers);
+    void setRxEom(const QList<QByteArray> &delimiters);
+    void inject(const QByteArray &data, qint64 timestamp, bool transmitted); // Clock::now() stamp to show it with
+    // Received data is kept for waits from watchWaits(true) on. A wait matches literal, or the regular expression
+    // regex if it is not empty, and drops the data up to its match; later waits only see what comes after.
+    void watchWaits(bool watch);
+    void startWait(int wait, const QByteArray &literal, const QString &regex);
+
+private slots:
+    void drain();
+    void flushWrites();
+
+private:
+    static const int RX_QUEUE_LEN = 1024;
+    static const int TX_QUEUE_LEN = 1024;
+    static const int TX_HIGH_WATER = 4096;       // Bytes left in QSerialPort's buffer before waiting for bytesWritten()
+    static const int TX_CHUNK = 1024;            // Largest single write
+    static const int SEND_PROGRESS_MS = 200;
+    static const int MAX_WAIT_BYTES = 65536;     // Received data kept for the next wait
+
+    enum class LinePause
+    {
+        NONE,
+        DRAINING, // Line handed to the port; waiting for it to go out
+        DELAYING  // Line is out; waiting for the line delay
+    };
+
+    void configure(const PortSettings &settings);
+    bool writeChunk(const char *data, qint64 len);
+    bool sendFileChunk();
+    void finishSend(const QString &errorString);
+    void runTriggers(const QByteArray &data, qint64 readNs, bool replayed);
+    void runWait(qint64 readNs);
+
+    QSerialPort *_port;
+    CaptureLogger &_logger;
+
+    struct RxChunk
+    {
+        QByteArray data;
+        qint64 timestamp;
+        bool transmitted; // Replayed data that was sent
+    };
+
+    SpscQueue<RxChunk> _rxQueue;
+    QList<RxChunk> _injected; // Waiting for room in _rxQueue, ahead of the port
+    SpscQueue<QByteArray> _txQueue;
+
+    std::atomic<bool> _rxNotified;
+    std::atomic<bool> _rxStalled;
+    std::atomic<bool> _txScheduled;
+
+    QList<QByteArray> _txBacklog; // Queued before the file being sent and trigger responses; goes out first
+    QByteArray _txCurrent;
+    int _txOffset;
+
+    QFile _sendFile;
+    const uchar *_sendData;
+    qint64 _sendSize;
+    qint64 _sendOffset;
+    qint64 _sendBytesPerSec; // 0 for no limit
+    int _sendLineDelayMs;
+    LinePause _linePause;
+    QElapsedTimer _sendClock;
+    QElapsedTimer _sendProgressClock;
+    QTimer *_paceTimer;
+
+    TriggerEngine _triggers;
+    QVector<TriggerEngine::Match> _matches;
+
+    bool _watchWaits;
+    QByteArray _waitRx;   // Received since the last match
+    int _waitScanned;     // Bytes of _waitRx a literal wait has already searched
+    int _wait;            // -1 if none
+    QByteArrayMatcher _waitLiteral;
+    QRegularExpression _waitRegex;
+};
+
+#endif // SERIALWORKER_H
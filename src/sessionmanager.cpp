@@ -0,0 +1,210 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "sessionmanager.h"
+
+#include <QSettings>
+
+//**********************************************************************************************************************
+SessionManager::SessionManager(QObject *parent) :
+    QAbstractListModel(parent),
+    _sessions(),
+    _currentIndex(0)
+{
+    QSettings settings;
+    QList<QVariant> ids = settings.value("sessions/ids").toList();
+    foreach (const QVariant &id, ids)
+    {
+        createSession(id.toInt());
+    }
+
+    // Always at least one; the first session uses the settings of single session versions
+    if (_sessions.isEmpty())
+        createSession(0);
+}
+
+//**********************************************************************************************************************
+SessionManager::~SessionManager()
+{}
+
+//**********************************************************************************************************************
+int SessionManager::currentIndex() const
+{
+    return _currentIndex;
+}
+
+//**********************************************************************************************************************
+void SessionManager::setCurrentIndex(int index)
+{
+    if (index < 0 || index >= _sessions.size() || index == _currentIndex)
+        return;
+
+    _currentIndex = index;
+
+    emit currentChanged();
+}
+
+//**********************************************************************************************************************
+SimpleTerminal *SessionManager::current() const
+{
+    return _sessions.at(_currentIndex).terminal;
+}
+
+//**********************************************************************************************************************
+SimpleTerminal *SessionManager::session(int index) const
+{
+    return _sessions.value(index, { -1, nullptr }).terminal;
+}
+
+//**********************************************************************************************************************
+int SessionManager::addSession()
+{
+    int id = 0;
+    foreach (const Session &session, _sessions)
+    {
+        id = qMax(id, session.id + 1);
+    }
+
+    beginInsertRows(QModelIndex(), _sessions.size(), _sessions.size());
+    createSession(id);
+    endInsertRows();
+
+    saveSessions();
+
+    emit countChanged();
+
+    return _sessions.size() - 1;
+}
+
+//**********************************************************************************************************************
+void SessionManager::removeSession(int index)
+{
+    if (index < 0 || index >= _sessions.size() || _sessions.size() == 1)
+        return;
+
+    beginRemoveRows(QModelIndex(), index, index);
+    Session session = _sessions.takeAt(index);
+    endRemoveRows();
+
+    // Closing a session forgets it; its port is closed when the terminal goes away
+    session.terminal->removeSettings();
+    session.terminal->deleteLater();
+
+    saveSessions();
+
+    emit countChanged();
+
+    if (_currentIndex >= index && _currentIndex > 0)
+        --_currentIndex;
+
+    emit currentChanged();
+}
+
+//**********************************************************************************************************************
+int SessionManager::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return _sessions.size();
+}
+
+//**********************************************************************************************************************
+QVariant SessionManager::data(const QModelIndex &index, int role) const
+{
+    if (index.row() < 0 || index.row() >= _sessions.size())
+        return QVariant();
+
+    SimpleTerminal *terminal = _sessions.at(index.row()).terminal;
+    switch (role)
+    {
+        case TerminalRole:
+            return QVariant::fromValue(terminal);
+
+        case Qt::DisplayRole:
+        case TitleRole:
+            return terminal->getPortName().isEmpty() ? tr("No Port") : terminal->getPortName();
+
+        default:
+            return QVariant();
+    }
+}
+
+//**********************************************************************************************************************
+QHash<int, QByteArray> SessionManager::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[TerminalRole] = "terminal";
+    roles[TitleRole] = "title";
+    return roles;
+}
+
+//**********************************************************************************************************************
+void SessionManager::sessionChanged()
+{
+    // Port name shows in the tab title
+    for (int i = 0; i < _sessions.size(); ++i)
+    {
+        if (_sessions.at(i).terminal == sender())
+        {
+            emit dataChanged(index(i), index(i), { TitleRole, Qt::DisplayRole });
+            break;
+        }
+    }
+}
+
+//**********************************************************************************************************************
+QString SessionManager::settingsGroup(int id)
+{
+    return id == 0 ? QString() : QString("sessions/%1").arg(id);
+}
+
+//**********************************************************************************************************************
+void SessionManager::createSession(int id)
+{
+    foreach (const Session &session, _sessions)
+    {
+        if (session.id == id)
+            return;
+    }
+
+    // Parented so QML never takes ownership
+    SimpleTerminal *terminal = new SimpleTerminal(settingsGroup(id), this);
+    QObject::connect(terminal, SIGNAL(statusTextChanged()), this, SLOT(sessionChanged()));
+
+    _sessions << Session{ id, terminal };
+}
+
+//**********************************************************************************************************************
+void SessionManager::saveSessions() const
+{
+    QList<QVariant> ids;
+    foreach (const Session &session, _sessions)
+    {
+        ids << session.id;
+    }
+
+    QSettings settings;
+    settings.setValue("sessions/ids", ids);
+}
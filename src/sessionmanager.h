@@ -0,0 +1,91 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef SESSIONMANAGER_H
+#define SESSIONMANAGER_H
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QHash>
+
+#include "simpleterminal.h"
+
+//**********************************************************************************************************************
+// Independent terminal sessions hosted in one process, one per view tab.
+//
+// Each session is a SimpleTerminal with its own serial I/O thread and its own settings group; the QML engine and the
+// ports watcher are shared. The list of sessions is persisted so they come back on the next start.
+class SessionManager : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+    Q_PROPERTY(int currentIndex READ currentIndex WRITE setCurrentIndex NOTIFY currentChanged)
+    Q_PROPERTY(SimpleTerminal *current READ current NOTIFY currentChanged)
+
+public:
+    enum Roles
+    {
+        TerminalRole = Qt::UserRole + 1,
+        TitleRole
+    };
+
+    explicit SessionManager(QObject *parent = nullptr);
+    ~SessionManager();
+
+    int currentIndex() const;
+    void setCurrentIndex(int index);
+    SimpleTerminal *current() const;
+    SimpleTerminal *session(int index) const;
+
+    Q_INVOKABLE int addSession();
+    Q_INVOKABLE void removeSession(int index);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void countChanged();
+    void currentChanged();
+
+private slots:
+    void sessionChanged();
+
+private:
+    struct Session
+    {
+        int id;
+        SimpleTerminal *terminal;
+    };
+
+    static QString settingsGroup(int id);
+
+    void createSession(int id);
+    void saveSessions() const;
+
+    QList<Session> _sessions;
+    int _currentIndex;
+};
+
+#endif // SESSIONMANAGER_H
@@ -0,0 +1,179 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+#include "sessionreplayer.h"
+#include "simpleterminal.h"
+#include "clock.h"
+#include "tracer.h"
+
+#include <QFileInfo>
+
+//**********************************************************************************************************************
+SessionReplayer::SessionReplayer(SimpleTerminal &terminal, QObject *parent) :
+    QObject(parent),
+    _terminal(terminal),
+    _reader(),
+    _name(),
+    _running(false),
+    _speed(1),
+    _fromNs(0),
+    _startNs(0),
+    _next(),
+    _pending(false),
+    _timer(this),
+    _records(0),
+    _bytes(0)
+{
+    _timer.setSingleShot(true);
+    _timer.setTimerType(Qt::PreciseTimer);
+
+    QObject::connect(&_timer, SIGNAL(timeout()), this, SLOT(step()));
+}
+
+//**********************************************************************************************************************
+bool SessionReplayer::start(const QString &fileName, double speed, qint64 offsetNs)
+{
+    if (isRunning())
+    {
+        _terminal.setError("Already replaying " + _name);
+        return false;
+    }
+
+    if (!_reader.open(fileName))
+    {
+        _terminal.setError("Could not open capture log: " + _reader.errorString());
+        return false;
+    }
+
+    if (_reader.firstTimestamp() < 0)
+    {
+        _reader.close();
+        _terminal.setError("Capture log is empty");
+        return false;
+    }
+
+    _name = QFileInfo(fileName).fileName();
+    _speed = speed;
+    _fromNs = _reader.firstTimestamp() + offsetNs;
+    _reader.seek(_fromNs);
+    _pending = false;
+    _records = 0;
+    _bytes = 0;
+    _startNs = Clock::now();
+
+    // Run from the event loop so the command's own output comes first
+    _running = true;
+    _timer.start(0);
+
+    return true;
+}
+
+//**********************************************************************************************************************
+void SessionReplayer::stop()
+{
+    if (isRunning())
+        finish("Stopped");
+}
+
+//**********************************************************************************************************************
+bool SessionReplayer::isRunning() const
+{
+    return _running;
+}
+
+//**********************************************************************************************************************
+void SessionReplayer::step()
+{
+    TRACE_SPAN("SessionReplayer::step");
+
+    qint64 now = Clock::now();
+    qint64 batch = 0;
+    forever
+    {
+        if (!_pending)
+        {
+            if (!_reader.next(_next))
+            {
+                finish();
+                return;
+            }
+
+            _pending = true;
+        }
+
+        qint64 dueNs = replayTime(_next.timestamp);
+        if (_speed > 0 && dueNs > now)
+        {
+            // Rounded up, so a record is never early; long gaps are waited out an hour at a time
+            _timer.start(static_cast<int>(qMin((dueNs - now + 999999) / 1000000, Q_INT64_C(3600000))));
+            return;
+        }
+
+        // Let the display catch up between batches, whatever the speed
+        if (batch >= FAST_BATCH_BYTES)
+        {
+            _timer.start(0);
+            return;
+        }
+
+        if (_next.direction == CaptureLogger::Direction::TRANSMITTED)
+            _terminal.replayTransmitted(_next.data, dueNs);
+        else
+            _terminal.replayReceived(_next.data, dueNs);
+
+        _pending = false;
+        ++_records;
+        _bytes += _next.data.size();
+        batch += _next.data.size();
+    }
+}
+
+//**********************************************************************************************************************
+void SessionReplayer::finish(const QString &error)
+{
+    _timer.stop();
+    _reader.close();
+    _running = false;
+
+    double secs = (Clock::now() - _startNs) / 1e9;
+    QString summary = QString("%1 records (%2 bytes) in %3 s").arg(_records).arg(_bytes).arg(secs, 0, 'f', 3);
+
+    if (error.isEmpty())
+    {
+        _terminal.modifyDspText(SimpleTerminal::DspType::COMMAND_RSP, "Replayed " + _name + ": " + summary);
+    }
+    else
+    {
+        _terminal.setError(QString("%1: %2 after %3").arg(_name).arg(error).arg(summary));
+    }
+
+    _next.data.clear();
+
+    emit finished();
+}
+
+//**********************************************************************************************************************
+qint64 SessionReplayer::replayTime(qint64 timestamp) const
+{
+    return _startNs + static_cast<qint64>((timestamp - _fromNs) / (_speed > 0 ? _speed : 1));
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+#ifndef SESSIONREPLAYER_H
+#define SESSIONREPLAYER_H
+
+#include "capturereader.h"
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+//**********************************************************************************************************************
+class SimpleTerminal;
+
+//**********************************************************************************************************************
+// Plays a capture log back into a terminal as if it were a live session.
+//
+// Received records go through the I/O thread (SerialWorker::inject()) and come out of SimpleTerminal::read() like
+// data from the port, so triggers, framing and the display run exactly as they would live. Transmitted records take
+// the same path, so they stay in order with the received data, and are shown as sent but not written to the port;
+// neither are trigger SEND responses to replayed data.
+//
+// Records are due at their capture time divided by the speed, counted from where the replay started; with speed 0
+// they go out as fast as possible. Either way each is shown stamped with its due time at the given speed (at speed 1
+// for speed 0), so timestamps keep the recorded spacing. At most FAST_BATCH_BYTES go out per event loop turn so the
+// display keeps up.
+class SessionReplayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int FAST_BATCH_BYTES = 65536;
+
+    explicit SessionReplayer(SimpleTerminal &terminal, QObject *parent = nullptr);
+
+    // Starts offsetNs into the recording; reports errors to the terminal
+    bool start(const QString &fileName, double speed, qint64 offsetNs);
+    void stop();
+    bool isRunning() const;
+
+signals:
+    void finished();
+
+private slots:
+    void step();
+
+private:
+    void finish(const QString &error = QString());
+    qint64 replayTime(qint64 timestamp) const; // Clock::now() a record captured at timestamp is due at
+
+    SimpleTerminal &_terminal;
+    CaptureReader _reader;
+    QString _name;
+    bool _running;
+    double _speed;   // 0 for as fast as possible
+    qint64 _fromNs;  // Capture time the replay started at
+    qint64 _startNs; // Clock::now() when it started
+    CaptureReader::Record _next;
+    bool _pending;   // _next is read but not yet due
+    QTimer _timer;
+
+    quint64 _records;
+    qint64 _bytes;
+};
+
+#endif // SESSIONREPLAYER_H
@@ -24,350 +24,1099 @@
 
 #include "simpleterminal.h"
 #include "commandparser.h"
+#include "tracer.h"
+#include "clock.h"
 
-#include <QApplication>
+#include <QCoreApplication>
+#include <QRegularExpression>
 #include <QSerialPort>
 #include <QSettings>
 
 
 
 //**********************************************************************************************************************
-SimpleTerminal::SimpleTerminal(QSerialPort *port, QObject *parent) :
+SimpleTerminal::SimpleTerminal(const QString &settingsGroup, QObject *parent) :
     QObject(parent),
+    _settingsGroup(settingsGroup),
     _statusText(QString()),
-    _port(port),
+    _logger(),
+    _ioThread(),
+    _worker(new SerialWorker(_logger)),
+    _portSettings(),
+    _isConnected(false),
+    _showReceived(true),
     _som(""),
     _eom("\r"),
+    _rxEom(),
+    _traceFile(),
+    _sendFileName(),
+    _sendStatus(),
+    _sendClock(),
+    _findText(),
+    _findRespond(false),
+    _triggers(),
+    _triggerStats(),
     _inputHistory(),
     _inputHistoryIdx(-1),
-    _is_msg_open(false),
-    _cmdParser(nullptr)
+    _lastDspType(DspType::NONE),
+    _framer(),
+    _frameEnds(),
+    _openFrameBytes(0),
+    _ansi(true),
+    _ansiParser(),
+    _line(MAX_FRAME_BYTES),
+    _scrollback(this),
+    _batcher(_scrollback, this),
+    _cmdParser(nullptr),
+    _script(*this, this),
+    _replay(*this, this),
+    _saveTimer()
 {
-    Q_CHECK_PTR(_port);
+    _ioThread.setObjectName(_settingsGroup.isEmpty() ? "SerialIO" : "SerialIO " + _settingsGroup);
+    _worker->moveToThread(&_ioThread);
+    QObject::connect(&_ioThread, SIGNAL(finished()), _worker, SLOT(deleteLater()));
 
     _cmdParser = new CommandParser(*this);
 
+    _saveTimer.setSingleShot(true);
+    _saveTimer.setInterval(SAVE_DELAY_MS);
+    QObject::connect(&_saveTimer, SIGNAL(timeout()), this, SLOT(saveSettings()));
+
     // Restore settings
     restoreSettings();
 
     refreshStatusText();
 
-    QObject::connect(_port, SIGNAL(readyRead()), this, SLOT(read()));
-    QObject::connect(_port, SIGNAL(baudRateChanged(qint32,QSerialPort::Directions)), this, SLOT(settingsChanged()));
-    QObject::connect(_port, SIGNAL(dataBitsChanged(QSerialPort::DataBits)), this, SLOT(settingsChanged()));
-    QObject::connect(_port, SIGNAL(flowControlChanged(QSerialPort::FlowControl)), this, SLOT(settingsChanged()));
-    QObject::connect(_port, SIGNAL(parityChanged(QSerialPort::Parity)), this, SLOT(settingsChanged()));
-    QObject::connect(_port, SIGNAL(stopBitsChanged(QSerialPort::StopBits)), this, SLOT(settingsChanged()));
+    QObject::connect(_worker, SIGNAL(readyRead()), this, SLOT(read()));
+    QObject::connect(_worker, SIGNAL(openChanged(bool)), this, SLOT(portOpenChanged(bool)));
+    QObject::connect(_worker, SIGNAL(openFailed(QString)), this, SLOT(portOpenFailed()));
+    QObject::connect(_worker, SIGNAL(sendProgress(qint64,qint64)), this, SLOT(sendProgress(qint64,qint64)));
+    QObject::connect(_worker, SIGNAL(sendFinished(qint64,qint64,QString)),
+                     this, SLOT(sendFinished(qint64,qint64,QString)));
+    QObject::connect(_worker, SIGNAL(triggered(QString,QByteArray,qint64)),
+                     this, SLOT(triggered(QString,QByteArray,qint64)));
+    QObject::connect(_worker, SIGNAL(waitMatched(int,qint64)), this, SIGNAL(waitMatched(int,qint64)));
+    QObject::connect(&_scrollback, SIGNAL(found(int,int)), this, SLOT(findDone(int,int)));
+    QObject::connect(&_logger, SIGNAL(writeFailed(QString)), this, SLOT(logWriteFailed(QString)));
+    QObject::connect(this, SIGNAL(portSettingsChanged()), this, SLOT(settingsChanged()));
     QObject::connect(this, SIGNAL(somChanged()), this, SLOT(settingsChanged()));
     QObject::connect(this, SIGNAL(eomChanged()), this, SLOT(settingsChanged()));
-
+    QObject::connect(this, SIGNAL(rxEomChanged()), this, SLOT(settingsChanged()));
+    QObject::connect(this, SIGNAL(maxFlushRateChanged()), this, SLOT(settingsChanged()));
+    QObject::connect(this, SIGNAL(maxScrollbackBytesChanged()), this, SLOT(settingsChanged()));
+    QObject::connect(this, SIGNAL(triggersChanged()), this, SLOT(settingsChanged()));
+    QObject::connect(this, SIGNAL(hexModeChanged()), this, SLOT(settingsChanged()));
+    QObject::connect(this, SIGNAL(timestampsChanged()), this, SLOT(settingsChanged()));
+    QObject::connect(this, SIGNAL(encodingChanged()), this, SLOT(settingsChanged()));
+    QObject::connect(this, SIGNAL(ansiChanged()), this, SLOT(settingsChanged()));
+    QObject::connect(&_batcher, SIGNAL(flushed()), this, SIGNAL(displayUpdated()));
+    QObject::connect(&_scrollback, SIGNAL(hexModeChanged()), this, SIGNAL(hexModeChanged()));
+    QObject::connect(&_scrollback, SIGNAL(timestampModeChanged()), this, SIGNAL(timestampsChanged()));
+    QObject::connect(&_scrollback, SIGNAL(encodingChanged()), this, SIGNAL(encodingChanged()));
+
+    _ioThread.start();
 }
 
 //**********************************************************************************************************************
 SimpleTerminal::~SimpleTerminal()
 {
+    if (_saveTimer.isActive())
+        saveSettings();
+
+    _ioThread.quit();
+    _ioThread.wait();
+
     delete _cmdParser;
 }
 
 //**********************************************************************************************************************
 void SimpleTerminal::modifyDspText(DspType type, const QString &text)
 {
-    // Format text according to type of message
-    static DspType last_type = DspType::NONE;
+    modifyDspText(type, text, QVector<ScrollbackModel::AttrRun>());
+}
 
-    // Need to end the last message?
-    if (last_type != type && _is_msg_open)
-        emit endMsg();
+//**********************************************************************************************************************
+void SimpleTerminal::modifyDspText(DspType type, const QString &text, const QVector<ScrollbackModel::AttrRun> &runs)
+{
+    TRACE_SPAN("SimpleTerminal::modifyDspText");
+
+    // Formatting according to type of message happens when the frame is displayed
+    setDspType(type);
 
     switch(type)
     {
         case DspType::READ_MESSAGE:
         {
-            static QString prev_msg("");
-
-            // Parse message and look for EOM string(s) - there could be 0 - n in this message
-            // Emit approriate details to system - end of message? Start of message? Append message?
-            QString msg(text.toHtmlEscaped());
-
-            // Find all occurences of EOM
-            int start_pos = 0;
-            int eom_pos = 0;
-            do
-            {
-                QString shared_msg(prev_msg + msg);
-                eom_pos = shared_msg.indexOf(_eom, start_pos);
-                if (eom_pos >= 0)
-                {
-                    // Found EOM!
-                    if (!_is_msg_open)
-                        emit startMsg();
-
-                    if (eom_pos < prev_msg.length())
-                        // Found EOM start before start of actual message; need to correct start position
-                        // to be first character after previous message
-                        start_pos += prev_msg.length();
-
-                    int len = (eom_pos + _eom.length()) - start_pos;
-
-                    emit appendMsg(shared_msg.mid(start_pos, len));
-                    emit endMsg();
-
-                    start_pos = eom_pos + _eom.length();
-                }
-                else if (start_pos < shared_msg.length())
-                {
-                    // No EOMs left; send rest of message
-                    if (!_is_msg_open)
-                        emit startMsg();
-
-                    emit appendMsg(shared_msg.mid(start_pos));
-                }
-            } while(eom_pos >= 0);
-
-            // Keep end of msg for next time
-            if (_eom.length() > 0)
-            {
-                int num_prev_msg_keep = _eom.length() - msg.length();
-                if (num_prev_msg_keep > 0)
-                    prev_msg = prev_msg.right(num_prev_msg_keep) + msg;
-
-                else
-                    prev_msg = msg.right(_eom.length() - 1);
-            }
-            else
-                prev_msg = "";
+            displayReceived(text.toUtf8());
 
             break;
         }
 
         case DspType::WRITE_MESSAGE:
         {
-            QString msg = "<span><b>" + text.toHtmlEscaped() + "</b></span>";
-            emit newMsg(msg);
+            _batcher.newMsg(ScrollbackModel::FrameType::SENT, text.toUtf8());
 
             break;
         }
 
         case DspType::COMMAND:
         {
-            QString msg = "<span style = \"color: blue;\"><b>$ " + text.toHtmlEscaped() + "</b></span>";
-            emit newMsg(msg);
+            _batcher.newMsg(ScrollbackModel::FrameType::COMMAND, text.toUtf8());
 
             break;
         }
 
         case DspType::COMMAND_RSP:
+        case DspType::ERROR:
         {
-            QString msg = "<span style = \"color: green;\">" + text + "</span>";
-            emit newMsg(msg);
+            // Run offsets from QChars to bytes of the UTF-8 frame
+            QByteArray data;
+            QVector<ScrollbackModel::AttrRun> byteRuns;
+            int pos = 0;
+            for (const ScrollbackModel::AttrRun &run : runs)
+            {
+                data += text.midRef(pos, static_cast<int>(run.offset) - pos).toUtf8();
+                pos = static_cast<int>(run.offset);
+                byteRuns.append({ static_cast<quint32>(data.size()), run.attr });
+            }
+            data += text.midRef(pos).toUtf8();
+
+            _batcher.newMsg(type == DspType::ERROR ? ScrollbackModel::FrameType::ERROR
+                                                   : ScrollbackModel::FrameType::COMMAND_RSP, data, byteRuns);
 
             break;
         }
 
-        case DspType::ERROR:
+        default:
+            break;
+    }
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::appendStyled(QString &text, QVector<ScrollbackModel::AttrRun> &runs, const QString &piece,
+                                  quint32 attr)
+{
+    quint32 offset = static_cast<quint32>(text.size());
+    if (!runs.isEmpty() && runs.last().offset == offset)
+        runs.last().attr = attr;
+    else if ((runs.isEmpty() ? 0 : runs.last().attr) != attr)
+        runs.append({ offset, attr });
+
+    text += piece;
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::displayReceived(const QByteArray &data, qint64 timestamp)
+{
+    TRACE_SPAN("SimpleTerminal::displayReceived");
+    TRACE_SPAN_ARG(data.size());
+
+    setDspType(DspType::READ_MESSAGE);
+
+    // A frame is stamped with the chunk its first byte arrived in
+    if (timestamp < 0)
+        timestamp = Clock::now();
+
+    // Split into frames at every EOM; an open frame is continued by the next chunk. Data stays raw bytes until shown.
+    _framer.scan(data, _frameEnds);
+
+    int start = 0;
+    foreach (int end, _frameEnds)
+    {
+        if (end > start || _batcher.isMsgOpen())
         {
-            QString msg = "<span style = \"color: red;\">ERROR: " + text + "</span>";
-            emit newMsg(msg);
+            appendReceived(data.constData() + start, end - start, timestamp);
+            if (_ansi)
+            {
+                _line.finish();
+                syncLine();
+            }
+            _batcher.endMsg();
+        }
 
-            break;
+        start = end;
+    }
+
+    if (start < data.size())
+        appendReceived(data.constData() + start, data.size() - start, timestamp);
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::appendReceived(const char *data, int len, qint64 timestamp)
+{
+    if (_ansi)
+    {
+        appendReceivedAnsi(data, len, timestamp);
+        return;
+    }
+
+    // Without EOMs (e.g. binary protocols) frames are capped so no single row grows without bound
+    do
+    {
+        if (!_batcher.isMsgOpen())
+        {
+            _batcher.startMsg(timestamp);
+            _openFrameBytes = 0;
         }
 
-        default:
+        int n = qMin(len, MAX_FRAME_BYTES - _openFrameBytes);
+
+        // A character cut in two would show as two replacement characters; it starts the next frame instead, which the
+        // next chunk continues if the character is not complete yet
+        bool cut = _openFrameBytes + n >= MAX_FRAME_BYTES;
+        if (cut && _scrollback.encoding() == TextDecoder::Encoding::UTF8)
+            n = TextDecoder::wholeLength(data, n);
+
+        _batcher.appendMsg(data, n);
+        _openFrameBytes += n;
+        data += n;
+        len -= n;
+
+        if (cut)
+            _batcher.endMsg();
+    } while (len > 0);
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::appendReceivedAnsi(const char *data, int len, qint64 timestamp)
+{
+    // Each frame is a line drawn by the parser; only what changed in it is passed on. The parser state carries over
+    // from frame to frame, so sequences and attributes may span chunks and frames.
+    do
+    {
+        if (!_batcher.isMsgOpen())
+        {
+            _batcher.startMsg(timestamp);
+            _line.clear();
+        }
+
+        // Overwriting text does not make the line longer, so the cap is on the line, not on the bytes fed
+        int n = qMin(len, MAX_FRAME_BYTES - _line.length());
+        if (n < len && _scrollback.encoding() == TextDecoder::Encoding::UTF8)
+            n = TextDecoder::wholeLength(data, n);
+
+        _ansiParser.feed(data, n, _line);
+        syncLine();
+        data += n;
+        len -= n;
+
+        if (len > 0)
+            _batcher.endMsg();
+    } while (len > 0);
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::syncLine()
+{
+    int from = _line.dirtyFrom();
+    if (from < 0)
+        return;
+
+    int firstRun = _line.firstRunFrom(from);
+    _batcher.rewriteMsg(from, _line.bytes().constData() + from, _line.length() - from,
+                        _line.runs().constData() + firstRun, _line.runs().size() - firstRun);
+    _line.markClean();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setDspType(DspType type)
+{
+    // Need to end the last message?
+    if (_lastDspType != type && _batcher.isMsgOpen())
+        _batcher.endMsg();
+
+    _lastDspType = type;
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::updateFramer()
+{
+    QList<QByteArray> delimiters;
+    if (_rxEom.isEmpty())
+    {
+        delimiters << _eom.toLatin1();
+    }
+    else
+    {
+        foreach (const QString &eom, _rxEom)
+        {
+            delimiters << eom.toLatin1();
+        }
+    }
+
+    _framer.setDelimiters(delimiters);
+
+    // Triggers frame the stream the same way on the I/O side
+    QMetaObject::invokeMethod(_worker, "setRxEom", Qt::QueuedConnection, Q_ARG(QList<QByteArray>, delimiters));
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::updateTriggers()
+{
+    QMetaObject::invokeMethod(_worker, "setTriggers", Qt::QueuedConnection, Q_ARG(QList<Trigger>, _triggers));
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setSOM(QString newSOM)
+{
+    _som = newSOM;
+
+    emit somChanged();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setEOM(QString newEOM)
+{
+    _eom = newEOM;
+    updateFramer();
+
+    emit eomChanged();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setRxEOM(const QStringList &delimiters)
+{
+    _rxEom = delimiters;
+    _rxEom.removeAll(QString());
+    updateFramer();
+
+    emit rxEomChanged();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setBaudRate(qint32 baudRate)
+{
+    _portSettings.baudRate = baudRate;
+
+    updatePortSettings();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setDataBits(QSerialPort::DataBits dataBits)
+{
+    _portSettings.dataBits = dataBits;
+
+    updatePortSettings();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setParity(QSerialPort::Parity parity)
+{
+    _portSettings.parity = parity;
+
+    updatePortSettings();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setStopBits(QSerialPort::StopBits stopBits)
+{
+    _portSettings.stopBits = stopBits;
+
+    updatePortSettings();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setFlowControl(QSerialPort::FlowControl flowControl)
+{
+    _portSettings.flowControl = flowControl;
+
+    updatePortSettings();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::updatePortSettings()
+{
+    QMetaObject::invokeMethod(_worker, "applySettings", Qt::QueuedConnection,
+                              Q_ARG(PortSettings, _portSettings));
+
+    emit portSettingsChanged();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setMaxFlushRate(int rate)
+{
+    _batcher.setMaxFlushRate(rate);
+
+    emit maxFlushRateChanged();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setMaxScrollbackBytes(qint64 maxBytes)
+{
+    _scrollback.setMaxBytes(maxBytes);
+
+    emit maxScrollbackBytesChanged();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setHexMode(bool hexMode)
+{
+    _scrollback.setHexMode(hexMode);
+}
+
+//**********************************************************************************************************************
+bool SimpleTerminal::setTimestamps(const QString &mode)
+{
+    if (mode == "off")
+        _scrollback.setTimestampMode(ScrollbackModel::TimestampMode::NONE);
+    else if (mode == "abs")
+        _scrollback.setTimestampMode(ScrollbackModel::TimestampMode::ABSOLUTE);
+    else if (mode == "delta")
+        _scrollback.setTimestampMode(ScrollbackModel::TimestampMode::DELTA);
+    else
+        return false;
+
+    return true;
+}
+
+//**********************************************************************************************************************
+bool SimpleTerminal::setEncoding(const QString &encoding)
+{
+    if (encoding == "utf8")
+        _scrollback.setEncoding(TextDecoder::Encoding::UTF8);
+    else if (encoding == "latin1")
+        _scrollback.setEncoding(TextDecoder::Encoding::LATIN1);
+    else if (encoding == "raw")
+        _scrollback.setEncoding(TextDecoder::Encoding::RAW);
+    else
+        return false;
+
+    return true;
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setAnsi(bool ansi)
+{
+    if (ansi == _ansi)
+        return;
+
+    // Received data from here on starts a new frame in the default attribute
+    if (_batcher.isMsgOpen())
+        _batcher.endMsg();
+    _ansiParser.reset();
+    _line.reset();
+    _ansi = ansi;
+
+    emit ansiChanged();
+}
+
+//**********************************************************************************************************************
+bool SimpleTerminal::showReceived() const
+{
+    return _showReceived;
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setShowReceived(bool show)
+{
+    _showReceived = show;
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::clearDisplay()
+{
+    // Drop output that was queued before the clear too
+    clearFind();
+    _batcher.clear();
+    _scrollback.clear();
+    _ansiParser.reset();
+    _line.reset();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::find(const QString &text, bool backward, bool respond)
+{
+    // Without text, repeat the last search
+    QByteArray needle = text.isEmpty() ? _findText : text.toUtf8();
+    if (needle.isEmpty())
+        return;
+
+    // Continue next to the current match; a new text may match right at it
+    int row = _scrollback.markRow();
+    int offset = _scrollback.markOffset();
+    if (row >= 0 && needle == _findText)
+        offset += backward ? -1 : 1;
+
+    _findText = needle;
+    _findRespond = respond;
+
+    _scrollback.find(needle, backward, row, offset);
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::clearFind()
+{
+    _scrollback.cancelFind();
+
+    if (_scrollback.markRow() < 0)
+        return;
+
+    _scrollback.clearMark();
+    emit found(-1);
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::findDone(int row, int offset)
+{
+    if (row < 0)
+    {
+        clearFind();
+        if (_findRespond)
+            setError("\"" + findText() + "\" not found");
+
+        emit notFound(findText());
+        return;
+    }
+
+    _scrollback.setMark(row, offset, _findText.size());
+    if (_findRespond)
+        modifyDspText(DspType::COMMAND_RSP, "Found at line " + QString::number(row + 1));
+
+    emit found(row);
+}
+
+//**********************************************************************************************************************
+QString SimpleTerminal::findText() const
+{
+    return QString::fromUtf8(_findText);
+}
+
+//**********************************************************************************************************************
+QList<Trigger> SimpleTerminal::triggers() const
+{
+    return _triggers;
+}
+
+//**********************************************************************************************************************
+bool SimpleTerminal::addTrigger(const Trigger &trigger)
+{
+    if (trigger.name.isEmpty() || trigger.pattern.isEmpty())
+    {
+        setError("A trigger needs a name and a pattern");
+        return false;
+    }
+
+    if (trigger.isRegex)
+    {
+        QRegularExpression regex(trigger.pattern);
+        if (!regex.isValid())
+        {
+            setError("Invalid pattern: " + regex.errorString());
+            return false;
+        }
+    }
+
+    removeTrigger(trigger.name);
+    _triggers << trigger;
+    _triggerStats.remove(trigger.name);
+    updateTriggers();
+
+    emit triggersChanged();
+
+    return true;
+}
+
+//**********************************************************************************************************************
+bool SimpleTerminal::removeTrigger(const QString &name)
+{
+    for (int i = 0; i < _triggers.size(); ++i)
+    {
+        if (_triggers.at(i).name == name)
+        {
+            _triggers.removeAt(i);
+            _triggerStats.remove(name);
+            updateTriggers();
+
+            emit triggersChanged();
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//**********************************************************************************************************************
+SimpleTerminal::TriggerStats SimpleTerminal::triggerStats(const QString &name) const
+{
+    return _triggerStats.value(name);
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::flushDisplay()
+{
+    // Hand pending output to the model now instead of on the next paced flush
+    _batcher.flush();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::resetHistoryIdx()
+{
+    _inputHistoryIdx = _inputHistory.size();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::parseInput(const QString &msg)
+{
+    runInput(msg);
+
+    // Add to history
+    if (_inputHistory.size() >= MAX_INPUT_HISTORY_LEN)
+        _inputHistory.removeFirst();
+
+    _inputHistory << msg;
+    _inputHistoryIdx = _inputHistory.size();
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::runInput(const QString &msg)
+{
+    if (msg.startsWith('/'))
+        _cmdParser->processCommand(msg);
+    else if (msg.startsWith("\\/"))
+        write(msg.mid(1));
+    else
+        write(msg);
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::setPort(QString port)
+{
+    _portSettings.name = port;
+
+    if (isConnected())
+    {
+        // Port name only takes effect on open; requests are serviced in order by the I/O thread
+        disconnect();
+        connect();
+    }
+
+    qDebug() << "Port set to " << _portSettings.name;
+
+    refreshStatusText();
+}
+
+//**********************************************************************************************************************
+QString SimpleTerminal::statusText() const
+{
+    return _statusText;
+}
+
+//**********************************************************************************************************************
+QString SimpleTerminal::errorText() const
+{
+    return _errorText;
+}
+
+//**********************************************************************************************************************
+bool SimpleTerminal::isConnected() const
+{
+    return _isConnected;
+}
+
+//**********************************************************************************************************************
+QString SimpleTerminal::getPortName() const
+{
+    return _portSettings.name;
+}
+
+//**********************************************************************************************************************
+QString SimpleTerminal::getSOM() const
+{
+    return _som;
+}
+
+//**********************************************************************************************************************
+QString SimpleTerminal::getEOM() const
+{
+    return _eom;
+}
+
+//**********************************************************************************************************************
+QStringList SimpleTerminal::getRxEOM() const
+{
+    return _rxEom;
+}
+
+//**********************************************************************************************************************
+qint32 SimpleTerminal::baudRate() const
+{
+    return _portSettings.baudRate;
+}
+
+//**********************************************************************************************************************
+QSerialPort::DataBits SimpleTerminal::dataBits() const
+{
+    return _portSettings.dataBits;
+}
+
+//**********************************************************************************************************************
+QSerialPort::Parity SimpleTerminal::parity() const
+{
+    return _portSettings.parity;
+}
+
+//**********************************************************************************************************************
+QSerialPort::StopBits SimpleTerminal::stopBits() const
+{
+    return _portSettings.stopBits;
+}
+
+//**********************************************************************************************************************
+QSerialPort::FlowControl SimpleTerminal::flowControl() const
+{
+    return _portSettings.flowControl;
+}
+
+//**********************************************************************************************************************
+int SimpleTerminal::maxFlushRate() const
+{
+    return _batcher.maxFlushRate();
+}
+
+//**********************************************************************************************************************
+qint64 SimpleTerminal::maxScrollbackBytes() const
+{
+    return _scrollback.maxBytes();
+}
+
+//**********************************************************************************************************************
+ScrollbackModel *SimpleTerminal::scrollback()
+{
+    return &_scrollback;
+}
+
+//**********************************************************************************************************************
+bool SimpleTerminal::hexMode() const
+{
+    return _scrollback.hexMode();
+}
+
+//**********************************************************************************************************************
+QString SimpleTerminal::timestamps() const
+{
+    switch (_scrollback.timestampMode())
+    {
+        case ScrollbackModel::TimestampMode::ABSOLUTE:
+            return "abs";
+
+        case ScrollbackModel::TimestampMode::DELTA:
+            return "delta";
+
+        case ScrollbackModel::TimestampMode::NONE:
+            break;
+    }
+
+    return "off";
+}
+
+//**********************************************************************************************************************
+QString SimpleTerminal::encoding() const
+{
+    switch (_scrollback.encoding())
+    {
+        case TextDecoder::Encoding::LATIN1:
+            return "latin1";
+
+        case TextDecoder::Encoding::RAW:
+            return "raw";
+
+        case TextDecoder::Encoding::UTF8:
             break;
     }
 
-    last_type = type;
+    return "utf8";
+}
+
+//**********************************************************************************************************************
+bool SimpleTerminal::ansi() const
+{
+    return _ansi;
+}
+
+//**********************************************************************************************************************
+int SimpleTerminal::getInputHistoryLen() const
+{
+    return _inputHistory.size();
+}
+
+//**********************************************************************************************************************
+QString SimpleTerminal::getInputHistoryIdx(int idx) const
+{
+    if (idx >= _inputHistory.length() || idx < 0)
+        return QString();
+
+    return _inputHistory[idx];
+}
+
+//**********************************************************************************************************************
+QString SimpleTerminal::getPrevHistory()
+{
+    QString retval;
+    if (_inputHistoryIdx >= 0 && _inputHistory.size() > 0)
+    {
+        if (--_inputHistoryIdx < 0)
+            _inputHistoryIdx = 0;
+
+        retval = _inputHistory[_inputHistoryIdx];
+    }
+
+    return retval;
+}
+
+//**********************************************************************************************************************
+QString SimpleTerminal::getNextHistory()
+{
+    QString retval;
+
+    if (_inputHistoryIdx >= 0 && _inputHistory.size() > 1)
+    {
+        if (++_inputHistoryIdx >= _inputHistory.size())
+        {
+            _inputHistoryIdx = _inputHistory.size();
+            retval = QString();
+        }
+        else
+            retval = _inputHistory[_inputHistoryIdx];
+    }
+
+    return retval;
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::connect()
+{
+    QMetaObject::invokeMethod(_worker, "open", Qt::QueuedConnection, Q_ARG(PortSettings, _portSettings));
+}
+
+//**********************************************************************************************************************
+void SimpleTerminal::disconnect()
+{
+    QMetaObject::invokeMethod(_worker, "close", Qt::QueuedConnection);
 }
 
 //**********************************************************************************************************************
-void SimpleTerminal::setSOM(QString newSOM)
+void SimpleTerminal::portOpenChanged(bool isOpen)
 {
-    _som = newSOM;
+    _isConnected = isOpen;
+    refreshStatusText();
+    emit connStateChanged();
 
-    emit somChanged();
+    qDebug() << (isOpen ? "Connected!" : "Disconnected");
 }
 
 //**********************************************************************************************************************
-void SimpleTerminal::setEOM(QString newEOM)
+void SimpleTerminal::portOpenFailed()
 {
-    _eom = newEOM;
+    setError("Connect attempt failed");
 
-    emit eomChanged();
+    emit connectFailed();
 }
 
 //**********************************************************************************************************************
-void SimpleTerminal::resetHistoryIdx()
+void SimpleTerminal::write(const QString &msg)
 {
-    _inputHistoryIdx = _inputHistory.size();
+    TRACE_SPAN("SimpleTerminal::write");
+
+    // SOM and EOM are escaped text, one byte per character like every other delimiter and pattern
+    QByteArray data = _som.toLatin1() + msg.toLocal8Bit() + _eom.toLatin1();
+    echo(data);
+
+    if (!transmit(data))
+    {
+        qWarning() << (isConnected() ? "Transmit queue full" : "Port is not open");
+
+        setError(isConnected() ? "Transmit queue full" : "Port is not open");
+    }
 }
 
 //**********************************************************************************************************************
-void SimpleTerminal::parseInput(const QString &msg)
+bool SimpleTerminal::transmit(const QByteArray &data)
 {
-    if (msg.startsWith('/'))
-        _cmdParser->processCommand(msg);
-    else if (msg.startsWith("\\/"))
-        write(msg.mid(1));
-    else
-        write(msg);
-
-    // Add to history
-    if (_inputHistory.size() >= MAX_INPUT_HISTORY_LEN)
-        _inputHistory.removeFirst();
-
-    _inputHistory << msg;
-    _inputHistoryIdx = _inputHistory.size();
+    return isConnected() && _worker->queueWrite(data);
 }
 
 //**********************************************************************************************************************
-void SimpleTerminal::setPort(QString port)
+void SimpleTerminal::echo(const QByteArray &data, qint64 timestamp)
 {
-    if (_port->isOpen())
+    // A pasted blob would swamp the display; say what was sent instead
+    if (data.size() > MAX_ECHO_BYTES)
     {
-        _port->disconnect();
-        _port->setPortName(port);
-        connect();
+        modifyDspText(DspType::COMMAND_RSP, QString("Sending %1 bytes").arg(data.size()));
     }
     else
     {
-        _port->setPortName(port);
+        setDspType(DspType::WRITE_MESSAGE);
+        _batcher.newMsg(ScrollbackModel::FrameType::SENT, data, QVector<ScrollbackModel::AttrRun>(), timestamp);
     }
+}
 
-    qDebug() << "Port set to " << _port->portName();
-
-    refreshStatusText();
+//**********************************************************************************************************************
+bool SimpleTerminal::runScript(const QString &fileName, bool echo)
+{
+    return _script.start(fileName, echo);
 }
 
 //**********************************************************************************************************************
-QString SimpleTerminal::statusText() const
+void SimpleTerminal::stopScript()
 {
-    return _statusText;
+    _script.stop();
 }
 
 //**********************************************************************************************************************
-QString SimpleTerminal::errorText() const
+bool SimpleTerminal::isRunningScript() const
 {
-    return _errorText;
+    return _script.isRunning();
 }
 
 //**********************************************************************************************************************
-bool SimpleTerminal::isConnected() const
+void SimpleTerminal::watchWaits(bool watch)
 {
-    return _port->isOpen();
+    QMetaObject::invokeMethod(_worker, "watchWaits", Qt::QueuedConnection, Q_ARG(bool, watch));
 }
 
 //**********************************************************************************************************************
-QString SimpleTerminal::getPortName() const
+void SimpleTerminal::startWait(int wait, const QByteArray &literal, const QString &regex)
 {
-    return _port->portName();
+    QMetaObject::invokeMethod(_worker, "startWait", Qt::QueuedConnection, Q_ARG(int, wait),
+                              Q_ARG(QByteArray, literal), Q_ARG(QString, regex));
 }
 
 //**********************************************************************************************************************
-QString SimpleTerminal::getSOM() const
+bool SimpleTerminal::startReplay(const QString &fileName, double speed, qint64 offsetNs)
 {
-    return _som;
+    return _replay.start(fileName, speed, offsetNs);
 }
 
 //**********************************************************************************************************************
-QString SimpleTerminal::getEOM() const
+void SimpleTerminal::stopReplay()
 {
-    return _eom;
+    _replay.stop();
 }
 
 //**********************************************************************************************************************
-int SimpleTerminal::getInputHistoryLen() const
+bool SimpleTerminal::isReplaying() const
 {
-    return _inputHistory.size();
+    return _replay.isRunning();
 }
 
 //**********************************************************************************************************************
-QString SimpleTerminal::getInputHistoryIdx(int idx) const
+void SimpleTerminal::replayReceived(const QByteArray &data, qint64 timestamp)
 {
-    if (idx >= _inputHistory.length() || idx < 0)
-        return QString();
+    QMetaObject::invokeMethod(_worker, "inject", Qt::QueuedConnection, Q_ARG(QByteArray, data),
+                              Q_ARG(qint64, timestamp), Q_ARG(bool, false));
+}
 
-    return _inputHistory[idx];
+//**********************************************************************************************************************
+void SimpleTerminal::replayTransmitted(const QByteArray &data, qint64 timestamp)
+{
+    // Behind the received data injected before it, so the two stay in recorded order
+    QMetaObject::invokeMethod(_worker, "inject", Qt::QueuedConnection, Q_ARG(QByteArray, data),
+                              Q_ARG(qint64, timestamp), Q_ARG(bool, true));
 }
 
 //**********************************************************************************************************************
-QString SimpleTerminal::getPrevHistory()
+bool SimpleTerminal::sendFile(const QString &fileName, qint64 bytesPerSec, int lineDelayMs)
 {
-    QString retval;
-    if (_inputHistoryIdx >= 0 && _inputHistory.size() > 0)
+    if (!isConnected())
     {
-        if (--_inputHistoryIdx < 0)
-            _inputHistoryIdx = 0;
+        setError("Port is not open");
+        return false;
+    }
 
-        retval = _inputHistory[_inputHistoryIdx];
+    if (isSending())
+    {
+        setError("Already sending " + _sendFileName);
+        return false;
     }
 
-    return retval;
+    _sendFileName = fileName;
+    _sendClock.start();
+    QMetaObject::invokeMethod(_worker, "sendFile", Qt::QueuedConnection, Q_ARG(QString, fileName),
+                              Q_ARG(qint64, bytesPerSec), Q_ARG(int, lineDelayMs));
+
+    return true;
 }
 
 //**********************************************************************************************************************
-QString SimpleTerminal::getNextHistory()
+void SimpleTerminal::cancelSend()
 {
-    QString retval;
+    QMetaObject::invokeMethod(_worker, "cancelSend", Qt::QueuedConnection);
+}
 
-    if (_inputHistoryIdx >= 0 && _inputHistory.size() > 1)
-    {
-        if (++_inputHistoryIdx >= _inputHistory.size())
-        {
-            _inputHistoryIdx = _inputHistory.size();
-            retval = QString();
-        }
-        else
-            retval = _inputHistory[_inputHistoryIdx];
-    }
+//**********************************************************************************************************************
+bool SimpleTerminal::isSending() const
+{
+    return !_sendFileName.isEmpty();
+}
 
-    return retval;
+//**********************************************************************************************************************
+void SimpleTerminal::sendProgress(qint64 sent, qint64 total)
+{
+    _sendStatus = QString("Sending %1%").arg(total > 0 ? sent * 100 / total : 100);
+    refreshStatusText();
 }
 
 //**********************************************************************************************************************
-void SimpleTerminal::connect()
+void SimpleTerminal::sendFinished(qint64 sent, qint64 total, const QString &errorString)
 {
-    if (_port->open(QIODevice::ReadWrite))
-    {
-        refreshStatusText();
-        emit connStateChanged();
+    QString fileName = _sendFileName;
+    double secs = qMax(_sendClock.elapsed(), Q_INT64_C(1)) / 1000.0;
+
+    _sendFileName.clear();
+    _sendStatus.clear();
+    refreshStatusText();
 
-        qDebug() << "Connected!";
+    if (errorString.isEmpty())
+    {
+        modifyDspText(DspType::COMMAND_RSP, QString("Sent %1 bytes from %2 in %3 s (%4 bytes/s)")
+                                            .arg(sent).arg(fileName).arg(secs, 0, 'f', 1)
+                                            .arg(static_cast<qint64>(sent / secs)));
     }
     else
     {
-        qWarning() << "Could not connect\nError code: " << _port->error() << "\nError description: "
-                   << _port->errorString();
-
-        setError("Connect attempt failed");
+        setError(QString("Sending %1 stopped after %2 of %3 bytes: %4").arg(fileName).arg(sent).arg(total)
+                 .arg(errorString));
     }
 }
 
 //**********************************************************************************************************************
-void SimpleTerminal::disconnect()
+void SimpleTerminal::triggered(const QString &name, const QByteArray &match, qint64 latencyNs)
 {
-    _port->close();
-    refreshStatusText();
-    emit connStateChanged();
+    // Matches may still arrive for a trigger that was just removed
+    int i = 0;
+    while (i < _triggers.size() && _triggers.at(i).name != name)
+        ++i;
 
-    qDebug() << "Disconnected";
-}
-
-//**********************************************************************************************************************
-void SimpleTerminal::write(const QString &msg)
-{
-    QString txMsg = _som + msg + _eom;
+    if (i == _triggers.size())
+        return;
 
-    qDebug() << "Write:" << txMsg << QByteArray(txMsg.toLocal8Bit()).toHex();
+    TriggerStats &stats = _triggerStats[name];
+    ++stats.count;
+    stats.totalNs += latencyNs;
+    stats.maxNs = qMax(stats.maxNs, latencyNs);
 
-    modifyDspText(DspType::WRITE_MESSAGE, txMsg);
-    if (_port->isOpen())
-        _port->write((txMsg).toLocal8Bit());
-    else
+    const Trigger &trigger = _triggers.at(i);
+    switch (trigger.action)
     {
-        qWarning() << "Port is not open\nError code: " << _port->error() << "\nError description: "
-                   << _port->errorString();
+        case Trigger::Action::SEND:
+            // Already sent by the I/O thread, as these bytes
+            echo(trigger.argument.toLatin1());
+            break;
 
-        setError("Port is not open");
+        case Trigger::Action::COMMAND:
+            runInput(trigger.argument);
+            break;
+
+        case Trigger::Action::MARK:
+        {
+            // Yellow background over the whole line; the response colour stays on the text
+            QString text;
+            QVector<ScrollbackModel::AttrRun> runs;
+            appendStyled(text, runs, name + ": " + QString::fromLatin1(match), MARK_BG);
+            modifyDspText(DspType::COMMAND_RSP, text, runs);
+            break;
+        }
     }
 }
 
@@ -379,216 +1128,248 @@ void SimpleTerminal::setError(const QString &msg)
 }
 
 //**********************************************************************************************************************
-void SimpleTerminal::restoreSettings()
+bool SimpleTerminal::startLog(const QString &fileName)
 {
-    QSettings settings;
-
-    // Baud Rate
-    _port->setBaudRate(settings.value("port/baudrate", _port->baudRate()).toInt());
+    bool ok = _logger.open(fileName);
+    if (!ok)
+        setError("Could not open log file: " + _logger.errorString());
 
-    // Data Bits
-    if (settings.contains("port/databits"))
-    {
-        qint32 dataBits = settings.value("port/databits").toInt();
-        switch (dataBits)
-        {
-            case 5:
-                _port->setDataBits(QSerialPort::Data5);
-                break;
-
-            case 6:
-                _port->setDataBits(QSerialPort::Data6);
-                break;
-
-            case 7:
-                _port->setDataBits(QSerialPort::Data7);
-                break;
+    settingsChanged();
 
-            default:
-            case 8:
-                _port->setDataBits(QSerialPort::Data8);
-                break;
-        }
-    }
+    return ok;
+}
 
-    // Parity
-    if (settings.contains("port/parity"))
-    {
-        QString parity = settings.value("port/parity").toString();
-        if (parity == "Even")
-        {
-            _port->setParity(QSerialPort::EvenParity);
-        }
-        else if (parity == "Odd")
-        {
-            _port->setParity(QSerialPort::OddParity);
-        }
-        else
-        {
-            _port->setParity(QSerialPort::NoParity);
-        }
-    }
+//**********************************************************************************************************************
+void SimpleTerminal::stopLog()
+{
+    _logger.close();
 
-    // Stop Bits
-    if (settings.contains("port/stopbits"))
-    {
-        float stopbits = settings.value("port/stopbits").toFloat();
-        if (stopbits == 1.0f)
-        {
-            _port->setStopBits(QSerialPort::OneStop);
-        }
-        else if (stopbits == 1.5f)
-        {
-            _port->setStopBits(QSerialPort::OneAndHalfStop);
-        }
-        else
-        {
-            _port->setStopBits(QSerialPort::TwoStop);
-        }
-    }
+    settingsChanged();
+}
 
-    // Flow Control
-    if (settings.contains("port/flowcontrol"))
-    {
-        QString flow = settings.value("port/flowcontrol").toString();
-        if (flow == "Hardware")
-        {
-            _port->setFlowControl(QSerialPort::HardwareControl);
-        }
-        else if (flow == "Software")
-        {
-            _port->setFlowControl(QSerialPort::SoftwareControl);
-        }
-        else
-        {
-            _port->setFlowControl(QSerialPort::NoFlowControl);
-        }
-    }
+//**********************************************************************************************************************
+void SimpleTerminal::logWriteFailed(const QString &error)
+{
+    setError(QString("Could not write log file: %1; records from here on are dropped").arg(error));
+}
 
-    // SOM
-    _som = settings.value("port/som", "").toString();
+//**********************************************************************************************************************
+const CaptureLogger &SimpleTerminal::logger() const
+{
+    return _logger;
+}
 
-    // EOM
-    _eom = settings.value("port/eom", "\r").toString();
+//**********************************************************************************************************************
+QString SimpleTerminal::traceFile() const
+{
+    return _traceFile;
+}
 
-    // Port
-    if (settings.contains("port/name"))
-    {
-        QString portName = settings.value("port/name").toString();
-        setPort(portName);
-    }
+//**********************************************************************************************************************
+void SimpleTerminal::setTraceFile(const QString &fileName)
+{
+    _traceFile = fileName;
 }
 
 //**********************************************************************************************************************
-void SimpleTerminal::saveSettings() const
+void SimpleTerminal::removeSettings()
 {
+    _saveTimer.stop();
+
     QSettings settings;
+    settings.beginGroup(_settingsGroup);
+    settings.remove("port");
+    settings.remove("display");
+    settings.remove("log");
+    settings.remove("triggers");
+}
 
-    // Baud Rate
-    settings.setValue("port/baudrate", _port->baudRate());
+//**********************************************************************************************************************
+Profile SimpleTerminal::profile() const
+{
+    Profile p;
+    p.port = _portSettings;
+    p.som = _som;
+    p.eom = _eom;
+    p.rxEom = _rxEom;
+    p.maxFlushRate = _batcher.maxFlushRate();
+    p.maxScrollbackBytes = _scrollback.maxBytes();
+    p.hexMode = _scrollback.hexMode();
+    p.timestampMode = _scrollback.timestampMode();
+    p.encoding = _scrollback.encoding();
+    p.ansi = _ansi;
+
+    return p;
+}
 
-    // Data Bits
-    switch (_port->dataBits())
+//**********************************************************************************************************************
+void SimpleTerminal::applyProfile(const Profile &profile)
+{
+    // Applied as a whole; the change signals below all land in one deferred save
+    bool reopen = isConnected() && profile.port.name != _portSettings.name;
+
+    _portSettings = profile.port;
+    _som = profile.som;
+    _eom = profile.eom;
+    _rxEom = profile.rxEom;
+    _rxEom.removeAll(QString());
+    updateFramer();
+
+    _batcher.setMaxFlushRate(profile.maxFlushRate);
+    _scrollback.setMaxBytes(profile.maxScrollbackBytes);
+    _scrollback.setHexMode(profile.hexMode);
+    _scrollback.setTimestampMode(profile.timestampMode);
+    _scrollback.setEncoding(profile.encoding);
+    setAnsi(profile.ansi);
+
+    updatePortSettings();
+    if (reopen)
     {
-        case QSerialPort::Data5:
-            settings.setValue("port/databits", 5);
-            break;
-
-        case QSerialPort::Data6:
-            settings.setValue("port/databits", 6);
-            break;
-
-        case QSerialPort::Data7:
-            settings.setValue("port/databits", 7);
-            break;
+        disconnect();
+        connect();
+    }
 
-        case QSerialPort::Data8:
-            settings.setValue("port/databits", 8);
-            break;
+    emit somChanged();
+    emit eomChanged();
+    emit rxEomChanged();
+    emit maxFlushRateChanged();
+    emit maxScrollbackBytesChanged();
 
-        case QSerialPort::UnknownDataBits:
-            qWarning() << "Unhandled Data Bits to save";
-            break;
-    }
+    refreshStatusText();
+}
 
-    // Parity
-    switch (_port->parity())
+//**********************************************************************************************************************
+bool SimpleTerminal::loadProfile(const QString &name)
+{
+    ProfileStore *store = ProfileStore::instance();
+    if (!store->contains(name))
     {
-        case QSerialPort::EvenParity:
-            settings.setValue("port/parity", "Even");
-            break;
+        setError("No profile " + name);
+        return false;
+    }
 
-        case QSerialPort::OddParity:
-            settings.setValue("port/parity", "Odd");
-            break;
+    applyProfile(store->profile(name));
 
-        case QSerialPort::NoParity:
-            settings.setValue("port/parity", "None");
-            break;
+    return true;
+}
 
-        case QSerialPort::UnknownParity:
-        case QSerialPort::MarkParity:
-        case QSerialPort::SpaceParity:
-            qWarning() << "Unhandled parity to save";
-            break;
+//**********************************************************************************************************************
+bool SimpleTerminal::saveProfile(const QString &name)
+{
+    if (!ProfileStore::instance()->setProfile(name, profile()))
+    {
+        setError("Invalid profile name " + name);
+        return false;
     }
 
-    // Stop Bits
-    switch (_port->stopBits())
-    {
-        case QSerialPort::OneStop:
-            settings.setValue("port/stopbits", 1.0);
-            break;
+    return true;
+}
 
-        case QSerialPort::OneAndHalfStop:
-            settings.setValue("port/stopbits", 1.5);
-            break;
+//**********************************************************************************************************************
+void SimpleTerminal::restoreSettings()
+{
+    QSettings settings;
+    settings.beginGroup(_settingsGroup);
 
-        case QSerialPort::TwoStop:
-            settings.setValue("port/stopbits", 2.0);
-            break;
+    applyProfile(Profile::load(settings));
 
-        case QSerialPort::UnknownDataBits:
-            qWarning() << "Unhandled parity to save";
-            break;
+    // Triggers
+    int triggerCount = settings.beginReadArray("triggers");
+    for (int i = 0; i < triggerCount; ++i)
+    {
+        settings.setArrayIndex(i);
+
+        Trigger trigger;
+        trigger.name = settings.value("name").toString();
+        trigger.pattern = settings.value("pattern").toString();
+        trigger.isRegex = settings.value("regex", false).toBool();
+        trigger.argument = settings.value("argument").toString();
+
+        QString action = settings.value("action").toString();
+        if (action == "send")
+            trigger.action = Trigger::Action::SEND;
+        else if (action == "command")
+            trigger.action = Trigger::Action::COMMAND;
+        else
+            trigger.action = Trigger::Action::MARK;
+
+        if (!trigger.name.isEmpty() && !trigger.pattern.isEmpty())
+            _triggers << trigger;
     }
+    settings.endArray();
+    updateTriggers();
 
-    // Flow Control
-    switch (_port->flowControl())
-    {
-        case QSerialPort::NoFlowControl:
-            settings.setValue("port/flowcontrol", "None");
-            break;
+    // Capture log
+    if (settings.contains("log/file") && !_logger.open(settings.value("log/file").toString()))
+        setError("Could not resume log file: " + _logger.errorString());
+}
 
-        case QSerialPort::HardwareControl:
-            settings.setValue("port/flowcontrol", "Hardware");
-            break;
+//**********************************************************************************************************************
+void SimpleTerminal::saveSettings() const
+{
+    QSettings settings;
+    settings.beginGroup(_settingsGroup);
 
-        case QSerialPort::SoftwareControl:
-            settings.setValue("port/flowcontrol", "Software");
-            break;
+    profile().save(settings);
 
-        case QSerialPort::UnknownFlowControl:
-            qWarning() << "Unhandled Flow Control to save";
-    }
+    // Triggers
+    settings.remove("triggers");
+    settings.beginWriteArray("triggers", _triggers.size());
+    for (int i = 0; i < _triggers.size(); ++i)
+    {
+        const Trigger &trigger = _triggers.at(i);
+        settings.setArrayIndex(i);
+        settings.setValue("name", trigger.name);
+        settings.setValue("pattern", trigger.pattern);
+        settings.setValue("regex", trigger.isRegex);
+        settings.setValue("argument", trigger.argument);
+
+        switch (trigger.action)
+        {
+            case Trigger::Action::SEND:
+                settings.setValue("action", "send");
+                break;
 
-    // SOM
-    settings.setValue("port/som", _som);
+            case Trigger::Action::COMMAND:
+                settings.setValue("action", "command");
+                break;
 
-    // EOM
-    settings.setValue("port/eom", _eom);
+            case Trigger::Action::MARK:
+                settings.setValue("action", "mark");
+                break;
+        }
+    }
+    settings.endArray();
 
-    // Port
-    settings.setValue("port/name", _port->portName());
+    // Capture log
+    if (_logger.isActive())
+        settings.setValue("log/file", _logger.fileName());
+    else
+        settings.remove("log/file");
 }
 
 //**********************************************************************************************************************
 void SimpleTerminal::read()
 {
-    QByteArray data = _port->readAll();
-    qDebug() << "Read: " << data << data.toHex();
+    TRACE_SPAN("SimpleTerminal::read");
+
+    QByteArray data;
+    qint64 timestamp;
+    bool transmitted;
+    while (_worker->readChunk(data, timestamp, transmitted))
+    {
+        // Replayed from a capture log
+        if (transmitted)
+        {
+            echo(data, timestamp);
+            continue;
+        }
+
+        emit received(data);
 
-    modifyDspText(DspType::READ_MESSAGE, QString(data));
+        if (_showReceived)
+            displayReceived(data, timestamp);
+    }
 }
 
 //**********************************************************************************************************************
@@ -614,10 +1395,10 @@ void SimpleTerminal::refreshStatusText()
     else
         newText += "<strong>Disconnected</strong>";
 
-    newText += " " + (getPortName() == "" ? "None" : getPortName()) + " " + QString::number( _port->baudRate());
+    newText += " " + (getPortName() == "" ? "None" : getPortName()) + " " + QString::number( _portSettings.baudRate);
 
     QString dataBits = "-";
-    switch (_port->dataBits())
+    switch (_portSettings.dataBits)
     {
         case QSerialPort::Data5:
             dataBits = "5";
@@ -641,7 +1422,7 @@ void SimpleTerminal::refreshStatusText()
     }
 
     QString parity = "-";
-    switch (_port->parity())
+    switch (_portSettings.parity)
     {
         case QSerialPort::NoParity:
             parity = "N";
@@ -663,7 +1444,7 @@ void SimpleTerminal::refreshStatusText()
     }
 
     QString stopBits = "-";
-    switch (_port->stopBits())
+    switch (_portSettings.stopBits)
     {
         case QSerialPort::OneStop:
             stopBits = "1";
@@ -685,7 +1466,7 @@ void SimpleTerminal::refreshStatusText()
     newText += " " + dataBits + parity + stopBits;
 
     QString flowControl = "-";
-    switch (_port->flowControl())
+    switch (_portSettings.flowControl)
     {
         case QSerialPort::HardwareControl:
             flowControl = "Hardware";
@@ -734,6 +1515,9 @@ void SimpleTerminal::refreshStatusText()
 
     newText += " " + EOM;
 
+    if (!_sendStatus.isEmpty())
+        newText += " " + _sendStatus;
+
     setStatusText(newText);
 
 }
@@ -743,5 +1527,6 @@ void SimpleTerminal::settingsChanged()
 {
     refreshStatusText();
 
-    saveSettings();
+    // A dialog or profile changes several settings in a row; write them out once
+    _saveTimer.start();
 }
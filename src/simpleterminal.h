@@ -30,6 +30,20 @@
 #include <QString>
 #include <QSerialPort>
 #include <QMap>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include "serialworker.h"
+#include "capturelogger.h"
+#include "eomframer.h"
+#include "displaybatcher.h"
+#include "scrollbackmodel.h"
+#include "profile.h"
+#include "scriptrunner.h"
+#include "sessionreplayer.h"
+#include "ansiparser.h"
+#include "terminalline.h"
 
 //**********************************************************************************************************************
 class CommandParser;
@@ -38,13 +52,25 @@ class CommandParser;
 class SimpleTerminal : public QObject
 {
     Q_OBJECT
-    Q_PROPERTY(int maxDspTxtChars MEMBER _maxDisplayTextChars NOTIFY maxDspTxtCharsChanged)
-    Q_PROPERTY(bool is_msg_open MEMBER _is_msg_open)
+    Q_PROPERTY(qint64 maxScrollbackBytes READ maxScrollbackBytes WRITE setMaxScrollbackBytes
+               NOTIFY maxScrollbackBytesChanged)
+    Q_PROPERTY(ScrollbackModel *scrollback READ scrollback CONSTANT)
+    Q_PROPERTY(bool hexMode READ hexMode WRITE setHexMode NOTIFY hexModeChanged)
+    Q_PROPERTY(QString timestamps READ timestamps WRITE setTimestamps NOTIFY timestampsChanged)
+    Q_PROPERTY(QString encoding READ encoding WRITE setEncoding NOTIFY encodingChanged)
+    Q_PROPERTY(bool ansi READ ansi WRITE setAnsi NOTIFY ansiChanged)
+    Q_PROPERTY(int maxFlushRate READ maxFlushRate WRITE setMaxFlushRate NOTIFY maxFlushRateChanged)
     Q_PROPERTY(QString statusText READ statusText NOTIFY statusTextChanged)
     Q_PROPERTY(QString errorText READ errorText NOTIFY errorTextChanged)
     Q_PROPERTY(bool connState READ isConnected NOTIFY connStateChanged)
     Q_PROPERTY(QString som READ getSOM WRITE setSOM NOTIFY somChanged)
     Q_PROPERTY(QString eom READ getEOM WRITE setEOM NOTIFY eomChanged)
+    Q_PROPERTY(QStringList rxEom READ getRxEOM WRITE setRxEOM NOTIFY rxEomChanged)
+    Q_PROPERTY(qint32 baudRate READ baudRate WRITE setBaudRate NOTIFY portSettingsChanged)
+    Q_PROPERTY(QSerialPort::DataBits dataBits READ dataBits WRITE setDataBits NOTIFY portSettingsChanged)
+    Q_PROPERTY(QSerialPort::Parity parity READ parity WRITE setParity NOTIFY portSettingsChanged)
+    Q_PROPERTY(QSerialPort::StopBits stopBits READ stopBits WRITE setStopBits NOTIFY portSettingsChanged)
+    Q_PROPERTY(QSerialPort::FlowControl flowControl READ flowControl WRITE setFlowControl NOTIFY portSettingsChanged)
 
 public:
     enum class DspType
@@ -57,7 +83,15 @@ public:
         ERROR
     };
 
-    explicit SimpleTerminal(QSerialPort *port, QObject *parent = nullptr);
+    struct TriggerStats
+    {
+        qint64 count = 0;
+        qint64 totalNs = 0; // Response latency, summed over all matches
+        qint64 maxNs = 0;
+    };
+
+    // Settings are kept under settingsGroup so several terminals can share a process
+    explicit SimpleTerminal(const QString &settingsGroup = QString(), QObject *parent = nullptr);
     ~SimpleTerminal();
 
     QString statusText() const;
@@ -66,16 +100,89 @@ public:
     Q_INVOKABLE QString getPortName() const;
     QString getSOM() const;
     QString getEOM() const;
+    QStringList getRxEOM() const;
+    qint32 baudRate() const;
+    QSerialPort::DataBits dataBits() const;
+    QSerialPort::Parity parity() const;
+    QSerialPort::StopBits stopBits() const;
+    QSerialPort::FlowControl flowControl() const;
     int getInputHistoryLen() const;
     Q_INVOKABLE QString getInputHistoryIdx(int idx) const;
     Q_INVOKABLE QString getPrevHistory();
     Q_INVOKABLE QString getNextHistory();
+    int maxFlushRate() const;
+    qint64 maxScrollbackBytes() const;
+    ScrollbackModel *scrollback();
+    bool hexMode() const;
+    QString timestamps() const;
+    QString encoding() const;
+    bool ansi() const;
+    bool showReceived() const;
 
     void modifyDspText(DspType type, const QString &text);
+    // Runs are attributes over text with offsets in QChars; only command responses and errors take them
+    void modifyDspText(DspType type, const QString &text, const QVector<ScrollbackModel::AttrRun> &runs);
+    // Appends piece to text in attr, adding a run where the attribute changes
+    static void appendStyled(QString &text, QVector<ScrollbackModel::AttrRun> &runs, const QString &piece,
+                             quint32 attr);
+    void displayReceived(const QByteArray &data, qint64 timestamp = -1); // Clock::now() stamp; now if -1
     void setSOM(QString newSOM = QString());
     void setEOM(QString newEOM = QString());
+    void setRxEOM(const QStringList &delimiters = QStringList());
+    void setBaudRate(qint32 baudRate);
+    void setDataBits(QSerialPort::DataBits dataBits);
+    void setParity(QSerialPort::Parity parity);
+    void setStopBits(QSerialPort::StopBits stopBits);
+    void setFlowControl(QSerialPort::FlowControl flowControl);
     Q_INVOKABLE void resetHistoryIdx();
+    Q_INVOKABLE void clearDisplay();
+    void flushDisplay();
+    void setMaxFlushRate(int rate);
+    void setMaxScrollbackBytes(qint64 maxBytes);
+    void setHexMode(bool hexMode);
+    bool setTimestamps(const QString &mode); // off, abs or delta
+    bool setEncoding(const QString &encoding); // utf8, latin1 or raw
+    void setAnsi(bool ansi);
+    void setShowReceived(bool show);
     void setError(const QString &msg);
+    bool startLog(const QString &fileName);
+    void stopLog();
+    const CaptureLogger &logger() const;
+    QString traceFile() const;
+    void setTraceFile(const QString &fileName);
+    void removeSettings(); // Also drops a pending save
+    Profile profile() const;
+    void applyProfile(const Profile &profile);
+    Q_INVOKABLE bool loadProfile(const QString &name);
+    Q_INVOKABLE bool saveProfile(const QString &name);
+    bool sendFile(const QString &fileName, qint64 bytesPerSec = 0, int lineDelayMs = 0);
+    void cancelSend();
+    bool isSending() const;
+    bool transmit(const QByteArray &data); // Queues data as is, without echo; false if it cannot be sent
+    // Shows data as sent, or how much of it there was if it is large; Clock::now() stamp, now if -1
+    void echo(const QByteArray &data, qint64 timestamp = -1);
+    bool runScript(const QString &fileName, bool echo = false);
+    void stopScript();
+    bool isRunningScript() const;
+    // Script waits, matched in the I/O thread as data is read; see SerialWorker::startWait()
+    void watchWaits(bool watch);
+    void startWait(int wait, const QByteArray &literal, const QString &regex);
+    bool startReplay(const QString &fileName, double speed = 1, qint64 offsetNs = 0); // speed 0: as fast as possible
+    void stopReplay();
+    bool isReplaying() const;
+    // Both go through the I/O thread to read(), in order, and are shown with the Clock::now() stamp given;
+    // transmitted data is shown as sent but not written to the port
+    void replayReceived(const QByteArray &data, qint64 timestamp);
+    void replayTransmitted(const QByteArray &data, qint64 timestamp);
+    // Starts a search of the scrollback, which ends with found() or notFound(); respond also answers in the display,
+    // as /find does
+    Q_INVOKABLE void find(const QString &text = QString(), bool backward = false, bool respond = false);
+    Q_INVOKABLE void clearFind();
+    QString findText() const;
+    QList<Trigger> triggers() const;
+    bool addTrigger(const Trigger &trigger); // Replaces a trigger of the same name
+    bool removeTrigger(const QString &name);
+    TriggerStats triggerStats(const QString &name) const;
 
 signals:
     void statusTextChanged();
@@ -83,12 +190,21 @@ signals:
     void connStateChanged();
     void somChanged();
     void eomChanged();
-    void maxDspTxtCharsChanged();
-    void startMsg();
-    void appendMsg(QString text);
-    void endMsg();
-    void newMsg(QString text);
-    void clearDisplayText();
+    void rxEomChanged();
+    void portSettingsChanged();
+    void maxScrollbackBytesChanged();
+    void maxFlushRateChanged();
+    void displayUpdated();
+    void hexModeChanged();
+    void timestampsChanged();
+    void encodingChanged();
+    void ansiChanged();
+    void received(const QByteArray &data); // Raw, as read from the port
+    void waitMatched(int wait, qint64 timestamp);
+    void connectFailed();
+    void found(int row); // -1 when the match is cleared
+    void notFound(const QString &text);
+    void triggersChanged();
 
 public slots:
     void parseInput(const QString &msg);
@@ -101,29 +217,78 @@ public slots:
     void refreshStatusText();
     void settingsChanged();
 
+private slots:
+    void portOpenChanged(bool isOpen);
+    void portOpenFailed();
+    void sendProgress(qint64 sent, qint64 total);
+    void sendFinished(qint64 sent, qint64 total, const QString &errorString);
+    void triggered(const QString &name, const QByteArray &match, qint64 latencyNs);
+    void findDone(int row, int offset);
+    void logWriteFailed(const QString &error);
+    void saveSettings() const;
 
 private:
     static const int MAX_INPUT_HISTORY_LEN = 64;
+    static const int MAX_FRAME_BYTES = 4096;
+    static const int MAX_ECHO_BYTES = 4096; // Larger messages are echoed as a summary
+    static const int SAVE_DELAY_MS = 500;   // Changes within this time are saved together
+    static const quint32 MARK_BG = 227u << AnsiParser::BG_SHIFT; // Yellow background of MARK trigger lines
 
     void setStatusText(const QString &text);
     void setErrorText(const QString &text);
+    void runInput(const QString &msg);
     void write(const QString &msg);
     void restoreSettings();
-    void saveSettings() const;
+    void updatePortSettings();
+    void updateFramer();
+    void updateTriggers();
+    void setDspType(DspType type);
+    void appendReceived(const char *data, int len, qint64 timestamp);
+    void appendReceivedAnsi(const char *data, int len, qint64 timestamp);
+    void syncLine();
 
+    QString _settingsGroup;
     QString _statusText;
     QString _errorText;
-    QSerialPort *_port;
+    CaptureLogger _logger; // Must outlive the I/O thread
+    QThread _ioThread;
+    SerialWorker *_worker;
+    PortSettings _portSettings;
+    bool _isConnected;
+    bool _showReceived; // Add received data to the scrollback
     QString _som;
     QString _eom;
+    QStringList _rxEom; // Receive-side EOMs; _eom when empty
+
+    QString _traceFile;    // Where /trace stop writes
+
+    QString _sendFileName; // Empty unless a file is being sent
+    QString _sendStatus;
+    QElapsedTimer _sendClock;
+
+    QByteArray _findText;
+    bool _findRespond; // For the search running
+
+    QList<Trigger> _triggers;
+    QMap<QString, TriggerStats> _triggerStats;
 
     QStringList _inputHistory;
     int _inputHistoryIdx;
 
-    int _maxDisplayTextChars = 1024 * 8;
-    bool _is_msg_open;  // Actively writing message to console
+    DspType _lastDspType;
+    EomFramer _framer;
+    QVector<int> _frameEnds;
+    int _openFrameBytes;
+    bool _ansi;              // Interpret escape sequences in received data
+    AnsiParser _ansiParser;
+    TerminalLine _line;      // The open received frame as drawn by _ansiParser
+    ScrollbackModel _scrollback;
+    DisplayBatcher _batcher;
 
     CommandParser *_cmdParser;
+    ScriptRunner _script;
+    SessionReplayer _replay;
+    QTimer _saveTimer;
 
 };
 
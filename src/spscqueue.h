@@ -0,0 +1,108 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+//**********************************************************************************************************************
+// Bounded, lock-free single-producer/single-consumer ring buffer.
+//
+// Exactly one thread may call push() and exactly one (other) thread may call pop(). Neither side ever blocks; push()
+// fails when the queue is full and pop() fails when it is empty.
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(std::size_t capacity)
+        : _buffer(capacity + 1), // One slot is always left empty to tell full from empty
+          _head(0),
+          _tail(0)
+    {}
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // Producer side
+    bool push(T item)
+    {
+        const std::size_t tail = _tail.load(std::memory_order_relaxed);
+        const std::size_t next = increment(tail);
+        if (next == _head.load(std::memory_order_acquire))
+            return false; // Full
+
+        _buffer[tail] = std::move(item);
+        _tail.store(next, std::memory_order_release);
+
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T &item)
+    {
+        const std::size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire))
+            return false; // Empty
+
+        item = std::move(_buffer[head]);
+        _buffer[head] = T(); // Don't keep a reference to the item alive in the slot
+        _head.store(increment(head), std::memory_order_release);
+
+        return true;
+    }
+
+    // Producer side
+    bool isFull() const
+    {
+        return increment(_tail.load(std::memory_order_relaxed)) == _head.load(std::memory_order_acquire);
+    }
+
+    bool isEmpty() const
+    {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const
+    {
+        return _buffer.size() - 1;
+    }
+
+private:
+    std::size_t increment(std::size_t idx) const
+    {
+        return (idx + 1 == _buffer.size()) ? 0 : idx + 1;
+    }
+
+    std::vector<T> _buffer;
+
+    // Keep producer and consumer indices on separate cache lines
+    alignas(64) std::atomic<std::size_t> _head;
+    alignas(64) std::atomic<std::size_t> _tail;
+};
+
+#endif // SPSCQUEUE_H
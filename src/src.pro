@@ -0,0 +1,38 @@
+TEMPLATE = app
+TARGET = yaTerm
+
+QT += qml quick widgets serialport
+CONFIG += c++17
+#QMAKE_CXXFLAGS += -std=c++11
+
+# Compile the QML in qml.qrc ahead of time instead of at every start
+CONFIG += qtquickcompiler
+
+include(core.pri)
+
+SOURCES += \
+    main.cpp \
+    portswatcher.cpp \
+    portlistmodel.cpp \
+    sessionmanager.cpp \
+    headlessterminal.cpp \
+    startupreport.cpp \
+    glyphatlas.cpp \
+    terminalitem.cpp
+
+RESOURCES += ../qml.qrc
+
+# Additional import path used to resolve QML modules in Qt Creator's code model
+QML_IMPORT_PATH =
+
+# Default rules for deployment.
+include(../deployment.pri)
+
+HEADERS += \
+    portswatcher.h \
+    portlistmodel.h \
+    sessionmanager.h \
+    headlessterminal.h \
+    startupreport.h \
+    glyphatlas.h \
+    terminalitem.h
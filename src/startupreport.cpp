@@ -22,59 +22,86 @@
  * SOFTWARE.
 ******************************************************************************/
 
-#include "stringlistmodel.h"
+#include "startupreport.h"
+#include "simpleterminal.h"
+
+#include <QQuickWindow>
+#include <QtDebug>
 
 //**********************************************************************************************************************
-StringListModel::StringListModel(QObject *parent) :
-    QAbstractListModel(parent)
-{}
+StartupReport::StartupReport(QObject *parent) :
+    QObject(parent),
+    _clock(),
+    _enabled(false),
+    _window(nullptr),
+    _frameSeen(false),
+    _firstFrameNs(0),
+    _portOpenSeen(false)
+{
+    _clock.start();
+}
 
 //**********************************************************************************************************************
-StringListModel::StringListModel(const StringListModel &listModel, QObject *parent) :
-    QAbstractListModel(parent)
+void StartupReport::setEnabled(bool enabled)
 {
-    _strings = listModel._strings;
+    _enabled = enabled;
 }
 
 //**********************************************************************************************************************
-StringListModel::~StringListModel()
-{}
+void StartupReport::mark(const QString &milestone)
+{
+    report(milestone, _clock.nsecsElapsed());
+}
 
 //**********************************************************************************************************************
-void StringListModel::setStringList(QStringList &list)
+void StartupReport::watch(QQuickWindow *window)
 {
-    _strings = list;
+    _window = window;
+
+    // frameSwapped() comes from the render thread; take the time there
+    QObject::connect(window, SIGNAL(frameSwapped()), this, SLOT(frameSwapped()), Qt::DirectConnection);
 }
 
 //**********************************************************************************************************************
-QStringList StringListModel::getStringList() const
+void StartupReport::watch(SimpleTerminal *terminal)
 {
-    return _strings;
+    QObject::connect(terminal, SIGNAL(connStateChanged()), this, SLOT(connStateChanged()));
 }
 
 //**********************************************************************************************************************
-int StringListModel::rowCount(const QModelIndex &parent) const
+void StartupReport::frameSwapped()
 {
-    Q_UNUSED(parent);
-    return _strings.count();
+    if (_frameSeen.exchange(true))
+        return;
+
+    _firstFrameNs = _clock.nsecsElapsed();
+    QMetaObject::invokeMethod(this, "firstFrame", Qt::QueuedConnection);
 }
 
 //**********************************************************************************************************************
-QVariant StringListModel::data(const QModelIndex &index, int role) const
+void StartupReport::firstFrame()
 {
-    if (index.row() < 0 || index.row() >= _strings.count())
-        return QVariant();
+    QObject::disconnect(_window, SIGNAL(frameSwapped()), this, SLOT(frameSwapped()));
+
+    report("first frame", _firstFrameNs);
+
+    emit firstFrameShown();
+}
 
-    if (role == Qt::DisplayRole)
-        return _strings[index.row()];
+//**********************************************************************************************************************
+void StartupReport::connStateChanged()
+{
+    SimpleTerminal *terminal = qobject_cast<SimpleTerminal *>(sender());
+    if (_portOpenSeen || !terminal || !terminal->isConnected())
+        return;
 
-    return QVariant();
+    _portOpenSeen = true;
+    mark("port open (" + terminal->getPortName() + ")");
 }
 
 //**********************************************************************************************************************
-QHash<int, QByteArray> StringListModel::roleNames() const
+void StartupReport::report(const QString &milestone, qint64 nsecs)
 {
-    QHash<int, QByteArray> roles;
-    roles[Qt::DisplayRole] = "display";
-    return roles;
+    if (_enabled)
+        qInfo().noquote() << QString("startup: %1 after %2 ms").arg(milestone).arg(nsecs / 1e6, 0, 'f', 1);
 }
@@ -0,0 +1,74 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef STARTUPREPORT_H
+#define STARTUPREPORT_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+#include <atomic>
+
+class QQuickWindow;
+class SimpleTerminal;
+
+//**********************************************************************************************************************
+// Startup milestones measured from the start of main(): QML loaded, first frame on screen and first port open. Each is
+// printed as it is reached when enabled (--startup-report); work that can wait should be started from
+// firstFrameShown().
+class StartupReport : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StartupReport(QObject *parent = nullptr);
+
+    void setEnabled(bool enabled);
+    void mark(const QString &milestone);
+    void watch(QQuickWindow *window);
+    void watch(SimpleTerminal *terminal);
+
+signals:
+    void firstFrameShown();
+
+private slots:
+    void frameSwapped();
+    void firstFrame();
+    void connStateChanged();
+
+private:
+    void report(const QString &milestone, qint64 nsecs);
+
+    QElapsedTimer _clock;
+    bool _enabled;
+    QQuickWindow *_window;
+    std::atomic<bool> _frameSeen;
+    std::atomic<qint64> _firstFrameNs;
+    bool _portOpenSeen;
+};
+
+#endif // STARTUPREPORT_H
@@ -0,0 +1,941 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+#include "terminalitem.h"
+
+#include "ansiparser.h"
+#include "scrollbackmodel.h"
+#include "tracer.h"
+
+#include <QClipboard>
+#include <QGuiApplication>
+#include <QKeyEvent>
+#include <QMatrix4x4>
+#include <QMouseEvent>
+#include <QQuickWindow>
+#include <QSGGeometryNode>
+#include <QSGMaterial>
+#include <QSGTexture>
+#include <QSGTransformNode>
+#include <QSet>
+#include <QVector2D>
+
+#include <algorithm>
+#include <climits>
+
+namespace
+{
+    const int TAB_WIDTH = 8;
+
+    const QRgb DEFAULT_FG = qRgb(0, 0, 0);
+    const QRgb FAINT_FG = qRgb(128, 128, 128);
+    const QRgb MARK_BG = qRgb(255, 255, 0);
+    const QRgb SELECTION_BG = qRgb(179, 215, 255);
+
+    struct Vertex
+    {
+        float x;
+        float y;
+        float u; // In atlas image pixels
+        float v;
+        uchar r;
+        uchar g;
+        uchar b;
+        uchar a;
+    };
+
+    //******************************************************************************************************************
+    const QSGGeometry::AttributeSet &vertexAttributes()
+    {
+        static const QSGGeometry::Attribute attributes[] = {
+            QSGGeometry::Attribute::createWithAttributeType(0, 2, QSGGeometry::FloatType,
+                                                            QSGGeometry::PositionAttribute),
+            QSGGeometry::Attribute::createWithAttributeType(1, 2, QSGGeometry::FloatType,
+                                                            QSGGeometry::TexCoordAttribute),
+            QSGGeometry::Attribute::createWithAttributeType(2, 4, QSGGeometry::UnsignedByteType,
+                                                            QSGGeometry::ColorAttribute)
+        };
+        static const QSGGeometry::AttributeSet set = { 3, sizeof(Vertex), attributes };
+        return set;
+    }
+
+    //******************************************************************************************************************
+    // Vertex colour times the coverage in the atlas; the texture is shared by all rows, so they batch together
+    class GlyphMaterial : public QSGMaterial
+    {
+    public:
+        explicit GlyphMaterial(QSGTexture *texture) :
+            texture(texture)
+        {
+            setFlag(Blending);
+        }
+
+        QSGMaterialType *type() const override
+        {
+            static QSGMaterialType type;
+            return &type;
+        }
+
+        QSGMaterialShader *createShader() const override;
+
+        int compare(const QSGMaterial *other) const override
+        {
+            const GlyphMaterial *m = static_cast<const GlyphMaterial *>(other);
+            return texture == m->texture ? 0 : (texture < m->texture ? -1 : 1);
+        }
+
+        QSGTexture *texture; // Owned by the TerminalNode
+    };
+
+    //******************************************************************************************************************
+    class GlyphShader : public QSGMaterialShader
+    {
+    public:
+        const char *vertexShader() const override
+        {
+            return "attribute highp vec4 position;\n"
+                   "attribute highp vec2 texCoord;\n"
+                   "attribute lowp vec4 color;\n"
+                   "uniform highp mat4 matrix;\n"
+                   "uniform highp vec2 textureScale;\n"
+                   "uniform lowp float opacity;\n"
+                   "varying highp vec2 coord;\n"
+                   "varying lowp vec4 fragColor;\n"
+                   "void main() {\n"
+                   "    coord = texCoord * textureScale;\n"
+                   "    fragColor = color * opacity;\n"
+                   "    gl_Position = matrix * position;\n"
+                   "}\n";
+        }
+
+        const char *fragmentShader() const override
+        {
+            return "uniform lowp sampler2D atlas;\n"
+                   "varying highp vec2 coord;\n"
+                   "varying lowp vec4 fragColor;\n"
+                   "void main() {\n"
+                   "    gl_FragColor = fragColor * texture2D(atlas, coord).a;\n"
+                   "}\n";
+        }
+
+        char const *const *attributeNames() const override
+        {
+            static const char *const names[] = { "position", "texCoord", "color", nullptr };
+            return names;
+        }
+
+        void updateState(const RenderState &state, QSGMaterial *newMaterial, QSGMaterial *) override
+        {
+            if (state.isMatrixDirty())
+                program()->setUniformValue(_matrix, state.combinedMatrix());
+            if (state.isOpacityDirty())
+                program()->setUniformValue(_opacity, state.opacity());
+
+            QSGTexture *texture = static_cast<GlyphMaterial *>(newMaterial)->texture;
+            QSize size = texture->textureSize();
+            program()->setUniformValue(_textureScale, QVector2D(1.0f / size.width(), 1.0f / size.height()));
+            texture->bind();
+        }
+
+    protected:
+        void initialize() override
+        {
+            _matrix = program()->uniformLocation("matrix");
+            _opacity = program()->uniformLocation("opacity");
+            _textureScale = program()->uniformLocation("textureScale");
+        }
+
+    private:
+        int _matrix = -1;
+        int _opacity = -1;
+        int _textureScale = -1;
+    };
+
+    //******************************************************************************************************************
+    QSGMaterialShader *GlyphMaterial::createShader() const
+    {
+        return new GlyphShader;
+    }
+
+    //******************************************************************************************************************
+    // One row in view, placed by its transform; the geometry only changes with the row
+    class RowNode : public QSGTransformNode
+    {
+    public:
+        explicit RowNode(QSGTexture *texture) :
+            geometry(vertexAttributes(), 0),
+            material(texture)
+        {
+            geometry.setDrawingMode(QSGGeometry::DrawTriangles);
+            node.setGeometry(&geometry);
+            node.setMaterial(&material);
+            appendChildNode(&node);
+        }
+
+        ~RowNode() override
+        {
+            removeChildNode(&node);
+        }
+
+        QSGGeometry geometry;
+        GlyphMaterial material;
+        QSGGeometryNode node;
+        quint64 version = 0;
+        int selectedFrom = 0;
+        int selectedTo = 0;
+    };
+
+    //******************************************************************************************************************
+    class TerminalNode : public QSGNode
+    {
+    public:
+        ~TerminalNode() override
+        {
+            // The rows use the texture
+            qDeleteAll(rows);
+            delete texture;
+        }
+
+        QHash<qint64, RowNode *> rows;
+        QSGTexture *texture = nullptr;
+        int atlasVersion = -1;
+    };
+
+    //******************************************************************************************************************
+    int glyphStyle(quint32 attr)
+    {
+        return (attr & AnsiParser::BOLD ? GlyphAtlas::BOLD : 0) | (attr & AnsiParser::ITALIC ? GlyphAtlas::ITALIC : 0);
+    }
+
+    //******************************************************************************************************************
+    // Inverse on the default colours is white text on black; bg is left fully transparent if there is no background
+    // to draw
+    void cellColors(quint32 attr, QRgb &fg, QRgb &bg)
+    {
+        int fgIndex = attr & AnsiParser::FG_MASK;
+        int bgIndex = (attr & AnsiParser::BG_MASK) >> AnsiParser::BG_SHIFT;
+        if (attr & AnsiParser::INVERSE)
+        {
+            int inverseFg = bgIndex ? bgIndex : 16;
+            bgIndex = fgIndex ? fgIndex : 1;
+            fgIndex = inverseFg;
+        }
+
+        if (fgIndex)
+            fg = AnsiParser::color(fgIndex - 1);
+        else
+            fg = attr & AnsiParser::FAINT ? FAINT_FG : DEFAULT_FG;
+
+        bg = bgIndex ? AnsiParser::color(bgIndex - 1) : 0;
+        if (attr & ScrollbackModel::MARKED)
+            bg = MARK_BG;
+    }
+}
+
+//**********************************************************************************************************************
+TerminalItem::TerminalItem(QQuickItem *parent) :
+    QQuickItem(parent),
+    _model(),
+    _font(),
+    _atlas(),
+    _wrap(true),
+    _viewX(0),
+    _viewY(0),
+    _contentWidth(0),
+    _removed(0),
+    _nextVersion(1),
+    _rows(),
+    _placed(),
+    _sampled(),
+    _sampledColumns(0),
+    _sampledLines(0),
+    _linesPerRow(1),
+    _anchor{ 0, 0 },
+    _cursor{ 0, 0 }
+{
+    _font = _atlas.font();
+    setFlag(ItemHasContents);
+    setAcceptedMouseButtons(Qt::LeftButton);
+}
+
+//**********************************************************************************************************************
+ScrollbackModel *TerminalItem::model() const
+{
+    return _model;
+}
+
+//**********************************************************************************************************************
+void TerminalItem::setModel(ScrollbackModel *model)
+{
+    if (model == _model)
+        return;
+
+    if (_model)
+        disconnect(_model, nullptr, this, nullptr);
+
+    _model = model;
+    if (_model)
+    {
+        connect(_model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(rowsInserted(QModelIndex,int,int)));
+        connect(_model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(rowsRemoved(QModelIndex,int,int)));
+        connect(_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)), this,
+                SLOT(dataChanged(QModelIndex,QModelIndex)));
+        connect(_model, SIGNAL(modelReset()), this, SLOT(modelReset()));
+    }
+
+    modelReset();
+    emit modelChanged();
+}
+
+//**********************************************************************************************************************
+QFont TerminalItem::font() const
+{
+    return _font;
+}
+
+//**********************************************************************************************************************
+void TerminalItem::setFont(const QFont &font)
+{
+    if (font == _font)
+        return;
+
+    _font = font;
+    _atlas.setFont(_font, window() ? window()->effectiveDevicePixelRatio() : _atlas.devicePixelRatio());
+    _rows.clear();
+    polish();
+
+    emit fontChanged();
+    emit contentSizeChanged();
+}
+
+//**********************************************************************************************************************
+bool TerminalItem::wrap() const
+{
+    return _wrap;
+}
+
+//**********************************************************************************************************************
+void TerminalItem::setWrap(bool wrap)
+{
+    if (wrap == _wrap)
+        return;
+
+    _wrap = wrap;
+    polish();
+    emit wrapChanged();
+}
+
+//**********************************************************************************************************************
+qreal TerminalItem::viewX() const
+{
+    return _viewX;
+}
+
+//**********************************************************************************************************************
+void TerminalItem::setViewX(qreal viewX)
+{
+    if (qFuzzyCompare(viewX, _viewX))
+        return;
+
+    // Only moves the rows
+    _viewX = viewX;
+    update();
+    emit viewChanged();
+}
+
+//**********************************************************************************************************************
+qreal TerminalItem::viewY() const
+{
+    return _viewY;
+}
+
+//**********************************************************************************************************************
+void TerminalItem::setViewY(qreal viewY)
+{
+    if (qFuzzyCompare(viewY, _viewY))
+        return;
+
+    _viewY = viewY;
+    polish();
+    emit viewChanged();
+}
+
+//**********************************************************************************************************************
+qreal TerminalItem::contentWidth() const
+{
+    return _contentWidth;
+}
+
+//**********************************************************************************************************************
+qreal TerminalItem::contentHeight() const
+{
+    return _model ? _model->rowCount() * _linesPerRow * lineHeight() : 0;
+}
+
+//**********************************************************************************************************************
+qreal TerminalItem::lineHeight() const
+{
+    return _atlas.cellSize().height();
+}
+
+//**********************************************************************************************************************
+bool TerminalItem::hasSelection() const
+{
+    return _anchor < _cursor || _cursor < _anchor;
+}
+
+//**********************************************************************************************************************
+qreal TerminalItem::rowY(int row) const
+{
+    return row * _linesPerRow * lineHeight();
+}
+
+//**********************************************************************************************************************
+void TerminalItem::copy()
+{
+    if (!_model || !hasSelection())
+        return;
+
+    Position begin = qMin(_anchor, _cursor);
+    Position end = qMax(_anchor, _cursor);
+    RowId count = _model->rowCount();
+
+    QString text;
+    QVector<Cell> built;
+    for (RowId id = qMax(begin.id, _removed); id <= end.id && id - _removed < count; ++id)
+    {
+        // Rows out of view are built just for their text
+        auto it = _rows.constFind(id);
+        if (it == _rows.constEnd())
+            buildCells(id, built, false);
+        const QVector<Cell> &cells = it != _rows.constEnd() ? it->cells : built;
+
+        int from, to;
+        selectionIn(id, cells.size(), from, to);
+        if (id > begin.id && !text.endsWith('\n'))
+            text += '\n';
+
+        for (int i = from; i < to; ++i)
+        {
+            uint c = cells.at(i).ucs4;
+            if (c != 0)
+                text += QString::fromUcs4(&c, 1);
+        }
+    }
+
+    QGuiApplication::clipboard()->setText(text);
+}
+
+//**********************************************************************************************************************
+void TerminalItem::selectAll()
+{
+    if (!_model || _model->rowCount() == 0)
+        return;
+
+    _anchor = { _removed, 0 };
+    _cursor = { _removed + _model->rowCount() - 1, INT_MAX };
+    update();
+    emit selectionChanged();
+}
+
+//**********************************************************************************************************************
+void TerminalItem::clearSelection()
+{
+    if (!hasSelection())
+        return;
+
+    _anchor = _cursor;
+    update();
+    emit selectionChanged();
+}
+
+//**********************************************************************************************************************
+QSGNode *TerminalItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    TRACE_SPAN("TerminalItem::updatePaintNode");
+
+    TerminalNode *root = static_cast<TerminalNode *>(oldNode);
+    if (!root)
+        root = new TerminalNode;
+
+    // New glyphs were added: upload the atlas again; slots have not moved, so the geometry stays
+    if (root->atlasVersion != _atlas.version())
+    {
+        QSGTexture *texture = window()->createTextureFromImage(_atlas.image());
+        texture->setFiltering(QSGTexture::Nearest);
+        for (RowNode *node : qAsConst(root->rows))
+        {
+            node->material.texture = texture;
+            node->node.markDirty(QSGNode::DirtyMaterial);
+        }
+
+        delete root->texture;
+        root->texture = texture;
+        root->atlasVersion = _atlas.version();
+    }
+
+    QHash<RowId, RowNode *> unused;
+    unused.swap(root->rows);
+
+    for (const Placed &placed : qAsConst(_placed))
+    {
+        const Row &row = _rows[placed.id];
+
+        RowNode *node = unused.take(placed.id);
+        if (!node)
+        {
+            node = new RowNode(root->texture);
+            root->appendChildNode(node);
+        }
+
+        int from, to;
+        selectionIn(placed.id, row.cells.size(), from, to);
+        if (node->version != row.version || node->selectedFrom != from || node->selectedTo != to)
+        {
+            buildGeometry(&node->geometry, row, from, to);
+            node->node.markDirty(QSGNode::DirtyGeometry);
+            node->version = row.version;
+            node->selectedFrom = from;
+            node->selectedTo = to;
+        }
+
+        QMatrix4x4 matrix;
+        matrix.translate(static_cast<float>(-_viewX), static_cast<float>(placed.y));
+        node->setMatrix(matrix);
+
+        root->rows.insert(placed.id, node);
+    }
+
+    qDeleteAll(unused);
+    return root;
+}
+
+//**********************************************************************************************************************
+void TerminalItem::updatePolish()
+{
+    TRACE_SPAN("TerminalItem::updatePolish");
+
+    if (window() && !qFuzzyCompare(window()->effectiveDevicePixelRatio(), _atlas.devicePixelRatio()))
+    {
+        _atlas.setFont(_font, window()->effectiveDevicePixelRatio());
+        _rows.clear();
+    }
+
+    _placed.clear();
+    int count = _model ? _model->rowCount() : 0;
+    qreal lineHeight = this->lineHeight();
+
+    if (contentHeight() > height() && _viewY + height() >= contentHeight() - 0.5)
+    {
+        // At the end: the last row sits on the bottom edge, however many lines the rows above it take
+        qreal y = height();
+        for (int r = count - 1; r >= 0 && y > 0; --r)
+        {
+            y -= row(r + _removed).lineStarts.size() * lineHeight;
+            _placed.append({ r + _removed, y });
+        }
+
+        std::reverse(_placed.begin(), _placed.end());
+    }
+    else
+    {
+        int first = qBound(0, static_cast<int>(_viewY / (_linesPerRow * lineHeight)), count);
+        qreal y = first * _linesPerRow * lineHeight - _viewY;
+        for (int r = first; r < count && y < height(); ++r)
+        {
+            _placed.append({ r + _removed, y });
+            y += row(r + _removed).lineStarts.size() * lineHeight;
+        }
+    }
+
+    // Only the rows in view stay laid out
+    QSet<RowId> inView;
+    int width = 0;
+    for (const Placed &placed : qAsConst(_placed))
+    {
+        inView.insert(placed.id);
+        width = qMax(width, _rows[placed.id].width);
+    }
+
+    for (auto it = _rows.begin(); it != _rows.end();)
+        it = inView.contains(it.key()) ? it + 1 : _rows.erase(it);
+
+    qreal contentWidth = _wrap ? this->width() : qMax(this->width(), width * _atlas.cellSize().width());
+    qreal linesPerRow = _sampled.isEmpty() ? 1 : static_cast<qreal>(_sampledLines) / _sampled.size();
+    if (!qFuzzyCompare(contentWidth, _contentWidth) || !qFuzzyCompare(linesPerRow, _linesPerRow))
+    {
+        _contentWidth = contentWidth;
+        _linesPerRow = linesPerRow;
+        emit contentSizeChanged();
+    }
+
+    update();
+}
+
+//**********************************************************************************************************************
+void TerminalItem::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
+
+    if (newGeometry.size() != oldGeometry.size())
+        polish();
+}
+
+//**********************************************************************************************************************
+void TerminalItem::mousePressEvent(QMouseEvent *event)
+{
+    forceActiveFocus(Qt::MouseFocusReason);
+
+    // Shift extends the selection
+    _cursor = hit(event->localPos());
+    if (!(event->modifiers() & Qt::ShiftModifier))
+        _anchor = _cursor;
+
+    update();
+    emit selectionChanged();
+}
+
+//**********************************************************************************************************************
+void TerminalItem::mouseMoveEvent(QMouseEvent *event)
+{
+    _cursor = hit(event->localPos());
+
+    update();
+    emit selectionChanged();
+}
+
+//**********************************************************************************************************************
+void TerminalItem::keyPressEvent(QKeyEvent *event)
+{
+    if (event->matches(QKeySequence::Copy))
+        copy();
+    else if (event->matches(QKeySequence::SelectAll))
+        selectAll();
+    else
+        QQuickItem::keyPressEvent(event);
+}
+
+//**********************************************************************************************************************
+void TerminalItem::rowsInserted(const QModelIndex &, int, int)
+{
+    polish();
+    emit contentSizeChanged();
+}
+
+//**********************************************************************************************************************
+void TerminalItem::rowsRemoved(const QModelIndex &, int first, int last)
+{
+    // The model only drops rows from the front; the ids of the others stay
+    Q_ASSERT(first == 0);
+    _removed += last - first + 1;
+
+    for (auto it = _rows.begin(); it != _rows.end();)
+        it = it.key() < _removed ? _rows.erase(it) : it + 1;
+
+    for (auto it = _sampled.begin(); it != _sampled.end();)
+    {
+        if (it.key() < _removed)
+        {
+            _sampledLines -= *it;
+            it = _sampled.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (_anchor.id < _removed)
+        _anchor = { _removed, 0 };
+    if (_cursor.id < _removed)
+        _cursor = { _removed, 0 };
+
+    polish();
+    emit contentSizeChanged();
+}
+
+//**********************************************************************************************************************
+void TerminalItem::dataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    RowId from = topLeft.row() + _removed;
+    RowId to = bottomRight.row() + _removed;
+
+    for (auto it = _rows.begin(); it != _rows.end();)
+        it = it.key() >= from && it.key() <= to ? _rows.erase(it) : it + 1;
+
+    polish();
+}
+
+//**********************************************************************************************************************
+void TerminalItem::modelReset()
+{
+    _rows.clear();
+    _removed = 0;
+    _sampled.clear();
+    _sampledLines = 0;
+    _anchor = _cursor = { 0, 0 };
+    polish();
+
+    emit contentSizeChanged();
+    emit selectionChanged();
+}
+
+//**********************************************************************************************************************
+TerminalItem::Row &TerminalItem::row(RowId id)
+{
+    auto it = _rows.find(id);
+    if (it == _rows.end())
+    {
+        it = _rows.insert(id, Row());
+        buildCells(id, it->cells, true);
+    }
+
+    int columns = this->columns();
+    if (it->columns != columns || it->lineStarts.isEmpty())
+    {
+        layoutLines(*it, columns);
+        sample(id, it->lineStarts.size(), columns);
+    }
+
+    return *it;
+}
+
+//**********************************************************************************************************************
+void TerminalItem::buildCells(RowId id, QVector<Cell> &cells, bool withGlyphs)
+{
+    QString text;
+    QVector<ScrollbackModel::AttrRun> runs;
+    _model->rowText(static_cast<int>(id - _removed), text, runs);
+
+    cells.clear();
+    cells.reserve(text.size());
+
+    int run = 0;
+    quint32 attr = 0;
+    int column = 0; // Since the last '\n', for tab stops
+    for (int i = 0; i < text.size();)
+    {
+        while (run < runs.size() && runs.at(run).offset <= static_cast<quint32>(i))
+            attr = runs.at(run++).attr;
+
+        uint c = text.at(i++).unicode();
+        if (QChar::isHighSurrogate(c) && i < text.size() && text.at(i).isLowSurrogate())
+            c = QChar::surrogateToUcs4(static_cast<ushort>(c), text.at(i++).unicode());
+
+        if (c == '\r')
+            continue;
+
+        if (c == '\n')
+        {
+            cells.append({ c, attr, -1 });
+            column = 0;
+        }
+        else if (c == '\t')
+        {
+            // The tab itself, then blanks up to the stop
+            int pad = TAB_WIDTH - column % TAB_WIDTH;
+            cells.append({ c, attr, -1 });
+            for (int j = 1; j < pad; ++j)
+                cells.append({ 0, attr, -1 });
+            column += pad;
+        }
+        else
+        {
+            int slot = withGlyphs && c > ' ' ? _atlas.slot(c, glyphStyle(attr)) : -1;
+            cells.append({ c, attr, slot });
+            ++column;
+        }
+    }
+}
+
+//**********************************************************************************************************************
+void TerminalItem::layoutLines(Row &row, int columns)
+{
+    row.lineStarts.clear();
+    row.lineStarts.append(0);
+    row.width = 0;
+
+    // A '\n' at the very end starts no line of its own
+    int column = 0;
+    for (int i = 0; i < row.cells.size(); ++i)
+    {
+        if (row.cells.at(i).ucs4 == '\n')
+        {
+            row.width = qMax(row.width, column);
+            if (i + 1 < row.cells.size())
+                row.lineStarts.append(i + 1);
+            column = 0;
+            continue;
+        }
+
+        if (column == columns)
+        {
+            row.width = qMax(row.width, column);
+            row.lineStarts.append(i);
+            column = 0;
+        }
+
+        ++column;
+    }
+
+    row.width = qMax(row.width, column);
+    row.columns = columns;
+    row.version = _nextVersion++;
+}
+
+//**********************************************************************************************************************
+void TerminalItem::sample(RowId id, int lines, int columns)
+{
+    // Counts at other columns no longer say how the rows wrap
+    if (columns != _sampledColumns)
+    {
+        _sampled.clear();
+        _sampledLines = 0;
+        _sampledColumns = columns;
+    }
+
+    // A row laid out again (it changed) replaces its count, so a growing last row is not counted over and over
+    auto it = _sampled.find(id);
+    if (it != _sampled.end())
+    {
+        _sampledLines += lines - *it;
+        *it = lines;
+    }
+    else if (_sampled.size() < MAX_SAMPLED_ROWS)
+    {
+        _sampled.insert(id, lines);
+        _sampledLines += lines;
+    }
+}
+
+//**********************************************************************************************************************
+int TerminalItem::columns() const
+{
+    return _wrap ? qMax(1, static_cast<int>(width() / _atlas.cellSize().width())) : INT_MAX;
+}
+
+//**********************************************************************************************************************
+int TerminalItem::lineEnd(const Row &row, int line) const
+{
+    int start = row.lineStarts.at(line);
+    int end = line + 1 < row.lineStarts.size() ? row.lineStarts.at(line + 1) : row.cells.size();
+    if (end > start && row.cells.at(end - 1).ucs4 == '\n')
+        --end;
+
+    return end;
+}
+
+//**********************************************************************************************************************
+void TerminalItem::selectionIn(RowId id, int cellCount, int &from, int &to) const
+{
+    from = to = 0;
+    if (!hasSelection())
+        return;
+
+    Position begin = qMin(_anchor, _cursor);
+    Position end = qMax(_anchor, _cursor);
+    if (id < begin.id || id > end.id)
+        return;
+
+    from = id == begin.id ? qMin(begin.cell, cellCount) : 0;
+    to = id == end.id ? qMin(end.cell, cellCount) : cellCount;
+}
+
+//**********************************************************************************************************************
+void TerminalItem::buildGeometry(QSGGeometry *geometry, const Row &row, int selectedFrom, int selectedTo) const
+{
+    QVector<Vertex> vertices;
+    vertices.reserve(row.cells.size() * 6);
+
+    QSizeF cell = _atlas.cellSize();
+    QPointF solid = _atlas.slotCenter(0);
+
+    // Two triangles
+    auto quad = [&](const QRectF &rect, const QRectF &tex, QRgb rgb) {
+        auto vertex = [&](qreal x, qreal y, qreal u, qreal v) {
+            return Vertex{ float(x), float(y), float(u), float(v), static_cast<uchar>(qRed(rgb)),
+                           static_cast<uchar>(qGreen(rgb)), static_cast<uchar>(qBlue(rgb)), 255 };
+        };
+        Vertex tl = vertex(rect.left(), rect.top(), tex.left(), tex.top());
+        Vertex tr = vertex(rect.right(), rect.top(), tex.right(), tex.top());
+        Vertex bl = vertex(rect.left(), rect.bottom(), tex.left(), tex.bottom());
+        Vertex br = vertex(rect.right(), rect.bottom(), tex.right(), tex.bottom());
+        vertices << tl << tr << bl << tr << br << bl;
+    };
+
+    for (int line = 0; line < row.lineStarts.size(); ++line)
+    {
+        int start = row.lineStarts.at(line);
+        int end = lineEnd(row, line);
+        for (int i = start; i < end; ++i)
+        {
+            const Cell &c = row.cells.at(i);
+            QRectF rect(QPointF((i - start) * cell.width(), line * cell.height()), cell);
+
+            QRgb fg, bg;
+            cellColors(c.attr, fg, bg);
+            if (i >= selectedFrom && i < selectedTo)
+                bg = SELECTION_BG;
+
+            if (qAlpha(bg))
+                quad(rect, QRectF(solid, QSizeF()), bg);
+            if (c.slot >= 0)
+                quad(rect, _atlas.slotRect(c.slot), fg);
+            if (c.attr & AnsiParser::UNDERLINE)
+            {
+                QRectF under(rect.left(), rect.top() + _atlas.underlineY(), rect.width(), _atlas.lineWidth());
+                quad(under, QRectF(solid, QSizeF()), fg);
+            }
+        }
+    }
+
+    geometry->allocate(vertices.size());
+    std::copy(vertices.constBegin(), vertices.constEnd(), static_cast<Vertex *>(geometry->vertexData()));
+}
+
+//**********************************************************************************************************************
+TerminalItem::Position TerminalItem::hit(const QPointF &point)
+{
+    if (_placed.isEmpty())
+        return { _removed, 0 };
+
+    // The last row starting above the point
+    const Placed *placed = &_placed.first();
+    for (const Placed &p : qAsConst(_placed))
+    {
+        if (p.y <= point.y())
+            placed = &p;
+    }
+
+    const Row &row = this->row(placed->id);
+    if (point.y() < placed->y)
+        return { placed->id, 0 };
+
+    int line = static_cast<int>((point.y() - placed->y) / lineHeight());
+    if (line >= row.lineStarts.size())
+        return { placed->id, row.cells.size() };
+
+    int column = qMax(0, qRound((point.x() + _viewX) / _atlas.cellSize().width()));
+    int start = row.lineStarts.at(line);
+    return { placed->id, qMin(start + column, lineEnd(row, line)) };
+}
@@ -0,0 +1,176 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+#ifndef TERMINALITEM_H
+#define TERMINALITEM_H
+
+#include "glyphatlas.h"
+#include "scrollbackmodel.h"
+
+#include <QFont>
+#include <QHash>
+#include <QPointer>
+#include <QQuickItem>
+#include <QVector>
+
+class QSGGeometry;
+
+//**********************************************************************************************************************
+// Output pane drawn straight into the scene graph: the rows of a ScrollbackModel as monospace cells with glyphs from a
+// GlyphAtlas, one geometry node per row in view. Rows come from ScrollbackModel::rowText() as text and attribute runs,
+// so nothing is formatted as or parsed from HTML, and a row's geometry is only rebuilt when that row changes.
+//
+// The item is as large as the viewport; a Flickable around it scrolls by setting viewX and viewY against
+// contentWidth and contentHeight. The vertical position counts rows, each as many lines high as the rows laid out so
+// far take on average at the current width, so contentHeight follows how much the rows wrap while the layout only ever
+// visits rows in view. At the end (autoscroll), the last row is laid out from the bottom up.
+class TerminalItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(ScrollbackModel *model READ model WRITE setModel NOTIFY modelChanged)
+    Q_PROPERTY(QFont font READ font WRITE setFont NOTIFY fontChanged)
+    Q_PROPERTY(bool wrap READ wrap WRITE setWrap NOTIFY wrapChanged)
+    Q_PROPERTY(qreal viewX READ viewX WRITE setViewX NOTIFY viewChanged)
+    Q_PROPERTY(qreal viewY READ viewY WRITE setViewY NOTIFY viewChanged)
+    Q_PROPERTY(qreal contentWidth READ contentWidth NOTIFY contentSizeChanged)
+    Q_PROPERTY(qreal contentHeight READ contentHeight NOTIFY contentSizeChanged)
+    Q_PROPERTY(qreal lineHeight READ lineHeight NOTIFY fontChanged)
+    Q_PROPERTY(bool hasSelection READ hasSelection NOTIFY selectionChanged)
+
+public:
+    explicit TerminalItem(QQuickItem *parent = nullptr);
+
+    ScrollbackModel *model() const;
+    void setModel(ScrollbackModel *model);
+    QFont font() const;
+    void setFont(const QFont &font);
+    bool wrap() const;
+    void setWrap(bool wrap);
+    qreal viewX() const;
+    void setViewX(qreal viewX);
+    qreal viewY() const;
+    void setViewY(qreal viewY);
+    qreal contentWidth() const;
+    qreal contentHeight() const;
+    qreal lineHeight() const;
+    bool hasSelection() const;
+
+    Q_INVOKABLE qreal rowY(int row) const; // Content position of a row, for viewY
+    Q_INVOKABLE void copy();
+    Q_INVOKABLE void selectAll();
+    Q_INVOKABLE void clearSelection();
+
+signals:
+    void modelChanged();
+    void fontChanged();
+    void wrapChanged();
+    void viewChanged();
+    void contentSizeChanged();
+    void selectionChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    void updatePolish() override;
+    void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+
+private slots:
+    void rowsInserted(const QModelIndex &parent, int first, int last);
+    void rowsRemoved(const QModelIndex &parent, int first, int last);
+    void dataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void modelReset();
+
+private:
+    static const int MAX_SAMPLED_ROWS = 4096; // Rows whose line counts make up the estimate of lines per row
+
+    // Rows are keyed by their model row plus the rows dropped from the front since, which stays put as the model trims
+    typedef qint64 RowId;
+
+    struct Cell
+    {
+        uint ucs4;   // '\n' ends a line and takes no column; 0 pads a tab
+        quint32 attr;
+        int slot;    // In the atlas; -1 draws no glyph
+    };
+
+    struct Row
+    {
+        QVector<Cell> cells;
+        QVector<int> lineStarts; // First cell of each line for columns
+        int columns = 0;
+        int width = 0;           // Columns of the widest line
+        quint64 version = 0;     // New whenever the cells are
+    };
+
+    struct Placed
+    {
+        RowId id;
+        qreal y;
+    };
+
+    struct Position
+    {
+        RowId id;
+        int cell;
+
+        bool operator<(const Position &other) const
+        {
+            return id < other.id || (id == other.id && cell < other.cell);
+        }
+    };
+
+    Row &row(RowId id);
+    void buildCells(RowId id, QVector<Cell> &cells, bool withGlyphs);
+    void layoutLines(Row &row, int columns);
+    void sample(RowId id, int lines, int columns);
+    int columns() const;
+    int lineEnd(const Row &row, int line) const; // Past the last cell drawn on the line
+    void selectionIn(RowId id, int cellCount, int &from, int &to) const;
+    void buildGeometry(QSGGeometry *geometry, const Row &row, int selectedFrom, int selectedTo) const;
+    Position hit(const QPointF &point);
+
+    QPointer<ScrollbackModel> _model;
+    QFont _font;
+    GlyphAtlas _atlas;        // Read by the render thread while this thread is blocked
+    bool _wrap;
+    qreal _viewX;
+    qreal _viewY;
+    qreal _contentWidth;
+
+    RowId _removed;           // Rows dropped from the front of the model
+    quint64 _nextVersion;
+    QHash<RowId, Row> _rows;  // Laid out rows, the ones in view
+    QVector<Placed> _placed;  // Rows in view, top to bottom, for the next frame
+
+    QHash<RowId, int> _sampled; // Lines of rows laid out at _sampledColumns
+    int _sampledColumns;
+    qint64 _sampledLines;     // Of all of _sampled
+    qreal _linesPerRow;       // Their average as of the last layout; rows not laid out are taken to wrap alike
+
+    Position _anchor;         // Where the selection was started; selected up to _cursor
+    Position _cursor;
+};
+
+#endif // TERMINALITEM_H
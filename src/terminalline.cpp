@@ -0,0 +1,282 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+#include "terminalline.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+const int RESERVED_RUNS = 256;
+
+//**********************************************************************************************************************
+bool runBefore(const ScrollbackModel::AttrRun &run, int offset)
+{
+    return static_cast<int>(run.offset) < offset;
+}
+}
+
+//**********************************************************************************************************************
+TerminalLine::TerminalLine(int capacity) :
+    _capacity(capacity),
+    _bytes(),
+    _runs(),
+    _home(0),
+    _cursor(0),
+    _crPending(false),
+    _attr(0),
+    _dirtyFrom(-1)
+{
+    _bytes.reserve(capacity);
+    _runs.reserve(RESERVED_RUNS);
+}
+
+//**********************************************************************************************************************
+void TerminalLine::clear()
+{
+    // resize() rather than clear() keeps the reserved storage
+    _bytes.resize(0);
+    _runs.resize(0);
+    _home = 0;
+    _cursor = 0;
+    _dirtyFrom = -1;
+}
+
+//**********************************************************************************************************************
+void TerminalLine::reset()
+{
+    clear();
+    _crPending = false;
+    _attr = 0;
+}
+
+//**********************************************************************************************************************
+void TerminalLine::finish()
+{
+    if (_crPending)
+        appendEnding("\r", 1);
+}
+
+//**********************************************************************************************************************
+int TerminalLine::length() const
+{
+    return _bytes.size();
+}
+
+//**********************************************************************************************************************
+const QByteArray &TerminalLine::bytes() const
+{
+    return _bytes;
+}
+
+//**********************************************************************************************************************
+const QVector<ScrollbackModel::AttrRun> &TerminalLine::runs() const
+{
+    return _runs;
+}
+
+//**********************************************************************************************************************
+int TerminalLine::firstRunFrom(int offset) const
+{
+    return static_cast<int>(std::lower_bound(_runs.constBegin(), _runs.constEnd(), offset, runBefore) -
+                            _runs.constBegin());
+}
+
+//**********************************************************************************************************************
+int TerminalLine::dirtyFrom() const
+{
+    return _dirtyFrom;
+}
+
+//**********************************************************************************************************************
+void TerminalLine::markClean()
+{
+    _dirtyFrom = -1;
+}
+
+//**********************************************************************************************************************
+void TerminalLine::print(const char *data, int len)
+{
+    _crPending = false;
+    write(_cursor, data, len, _attr);
+    _cursor = qMin(_cursor + len, _capacity);
+}
+
+//**********************************************************************************************************************
+void TerminalLine::control(char c)
+{
+    switch (c)
+    {
+        case '\r':
+            _crPending = true;
+            _cursor = _home;
+            break;
+
+        case '\n':
+            // The scrollback has no line below to move to; the line feed ends the line where it is
+            if (_crPending)
+                appendEnding("\r\n", 2);
+            else
+                appendEnding("\n", 1);
+            _home = _cursor;
+            break;
+
+        case '\b':
+            cursorBack(1);
+            break;
+
+        default:
+            // Tabs and the like are kept and shown as they would be without escape sequences
+            print(&c, 1);
+            break;
+    }
+}
+
+//**********************************************************************************************************************
+void TerminalLine::setAttr(quint32 attr)
+{
+    _attr = attr;
+}
+
+//**********************************************************************************************************************
+void TerminalLine::cursorForward(int n)
+{
+    _crPending = false;
+    _cursor = qMin(_cursor + n, _capacity);
+}
+
+//**********************************************************************************************************************
+void TerminalLine::cursorBack(int n)
+{
+    _crPending = false;
+    _cursor = qMax(_cursor - n, _home);
+}
+
+//**********************************************************************************************************************
+void TerminalLine::cursorColumn(int column)
+{
+    _crPending = false;
+    _cursor = qBound(_home, _home + column, _capacity);
+}
+
+//**********************************************************************************************************************
+void TerminalLine::eraseLine(int mode)
+{
+    _crPending = false;
+
+    switch (mode)
+    {
+        case 0:
+            truncate(_cursor);
+            break;
+
+        case 1:
+            // Up to and including the cursor
+            write(_home, nullptr, qMin(_cursor + 1, _bytes.size()) - _home, 0);
+            break;
+
+        case 2:
+            truncate(_home);
+            break;
+
+        default:
+            break;
+    }
+}
+
+//**********************************************************************************************************************
+void TerminalLine::write(int at, const char *data, int len, quint32 attr)
+{
+    // Cells the cursor skipped over are blank
+    if (at > _bytes.size())
+        write(_bytes.size(), nullptr, at - _bytes.size(), 0);
+
+    len = qMin(len, _capacity - at);
+    if (len <= 0)
+        return;
+
+    int end = at + len;
+    int oldSize = _bytes.size();
+    quint32 tailAttr = end < oldSize ? attrAt(end) : attr;
+
+    // Replace the runs starting within the overwritten text by one for attr, and one for the text after it
+    int first = firstRunFrom(at);
+    int last = first;
+    while (last < _runs.size() && static_cast<int>(_runs.at(last).offset) <= end)
+        ++last;
+
+    if (last > first)
+        _runs.erase(_runs.begin() + first, _runs.begin() + last);
+
+    quint32 before = first > 0 ? _runs.at(first - 1).attr : 0;
+    if (attr != before)
+        _runs.insert(first++, { static_cast<quint32>(at), attr });
+    if (tailAttr != attr)
+        _runs.insert(first, { static_cast<quint32>(end), tailAttr });
+
+    if (end > oldSize)
+        _bytes.resize(end);
+
+    if (data)
+        std::memcpy(_bytes.data() + at, data, len);
+    else
+        std::memset(_bytes.data() + at, ' ', len);
+
+    touch(at);
+}
+
+//**********************************************************************************************************************
+void TerminalLine::appendEnding(const char *data, int len)
+{
+    // In the attribute of the text before, so an ending never starts a run of its own
+    int end = _bytes.size();
+    write(end, data, len, end > 0 ? attrAt(end - 1) : 0);
+    _cursor = _bytes.size();
+    _crPending = false;
+}
+
+//**********************************************************************************************************************
+void TerminalLine::truncate(int len)
+{
+    if (len >= _bytes.size())
+        return;
+
+    _bytes.resize(len);
+    _runs.resize(firstRunFrom(len));
+    touch(len);
+}
+
+//**********************************************************************************************************************
+quint32 TerminalLine::attrAt(int offset) const
+{
+    int idx = firstRunFrom(offset + 1);
+    return idx > 0 ? _runs.at(idx - 1).attr : 0;
+}
+
+//**********************************************************************************************************************
+void TerminalLine::touch(int offset)
+{
+    if (_dirtyFrom < 0 || offset < _dirtyFrom)
+        _dirtyFrom = offset;
+}
@@ -0,0 +1,86 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+#ifndef TERMINALLINE_H
+#define TERMINALLINE_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include "ansiparser.h"
+#include "scrollbackmodel.h"
+
+//**********************************************************************************************************************
+// The line an AnsiParser is drawing into: text bytes plus attribute runs, and a cursor that carriage return, backspace
+// and cursor sequences move about. Text written before the end overwrites what is there, so progress bars and
+// spinners redrawn with CR end up as one line. The line never grows past its capacity; text past it is dropped.
+//
+// Line endings are kept as received: a CR only moves the cursor once text follows it, and CR, LF and CR+LF at the
+// end of a line are stored as bytes. Text after an LF starts a new line within the same frame, which the cursor
+// cannot move back into.
+//
+// Storage is reserved up front, so as a rule nothing is allocated while data is fed. dirtyFrom() tells the lowest
+// offset changed since markClean(); only the line from there on has to be passed on.
+class TerminalLine : public AnsiParser::Handler
+{
+public:
+    explicit TerminalLine(int capacity);
+
+    void clear();  // Empty with the cursor at the start; the attribute and a pending CR carry on
+    void reset();  // Also back to the default attribute
+    void finish(); // The frame ends here; stores a pending CR
+
+    int length() const;
+    const QByteArray &bytes() const;
+    const QVector<ScrollbackModel::AttrRun> &runs() const;
+    int firstRunFrom(int offset) const; // Index of the first run at offset or after it
+
+    int dirtyFrom() const; // -1 if nothing changed
+    void markClean();
+
+    void print(const char *data, int len) override;
+    void control(char c) override;
+    void setAttr(quint32 attr) override;
+    void cursorForward(int n) override;
+    void cursorBack(int n) override;
+    void cursorColumn(int column) override;
+    void eraseLine(int mode) override;
+
+private:
+    void write(int at, const char *data, int len, quint32 attr); // Spaces if data is null
+    void appendEnding(const char *data, int len);
+    void truncate(int len);
+    quint32 attrAt(int offset) const;
+    void touch(int offset);
+
+    int _capacity;
+    QByteArray _bytes;
+    QVector<ScrollbackModel::AttrRun> _runs; // Sorted by offset, each a change from the one before
+    int _home;                               // Start of the line after the last LF
+    int _cursor;                             // May be past the end; the gap is filled when written to
+    bool _crPending;                         // CR seen, not known yet to end the line; the cursor is already home
+    quint32 _attr;
+    int _dirtyFrom;
+};
+
+#endif // TERMINALLINE_H
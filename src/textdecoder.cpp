@@ -0,0 +1,313 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "textdecoder.h"
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    //******************************************************************************************************************
+    // Per-byte output, built once
+    struct Tables
+    {
+        bool plain[256];
+        QString ascii[128]; // ASCII bytes that are not plain
+        QString hex[256];   // Bytes that are not text
+
+        Tables()
+        {
+            static const char digits[] = "0123456789ABCDEF";
+
+            for (int b = 0; b < 256; ++b)
+            {
+                plain[b] = b >= 0x20 && b < 0x7f;
+                hex[b] = QString("\\x") + digits[b >> 4] + digits[b & 0xf];
+            }
+
+            for (int b = 0; b < 0x80; ++b)
+                ascii[b] = QChar(b);
+
+            for (int b = 0; b < 0x20; ++b)
+                ascii[b] = QString("^") + QChar('@' + b);
+
+            ascii['\t'] = "\t";
+            ascii['\n'] = "\n";
+            ascii['\r'] = "\r";
+            ascii[0x7f] = "^?";
+        }
+    };
+
+    //******************************************************************************************************************
+    const Tables &tables()
+    {
+        static const Tables t;
+        return t;
+    }
+
+    //******************************************************************************************************************
+    // Length of the UTF-8 sequence lead starts, or 0 if it cannot start one
+    int sequenceLength(uchar lead)
+    {
+        if (lead >= 0xc2 && lead <= 0xdf)
+            return 2;
+        if (lead >= 0xe0 && lead <= 0xef)
+            return 3;
+        if (lead >= 0xf0 && lead <= 0xf4)
+            return 4;
+
+        return 0;
+    }
+
+    //******************************************************************************************************************
+    // Whether b can be byte k (from 0) of the sequence lead starts; rules out overlong forms, surrogates and code
+    // points past U+10FFFF
+    bool continues(uchar lead, int k, uchar b)
+    {
+        if (k == 1)
+        {
+            if (lead == 0xe0)
+                return b >= 0xa0 && b <= 0xbf;
+            if (lead == 0xed)
+                return b >= 0x80 && b <= 0x9f;
+            if (lead == 0xf0)
+                return b >= 0x90 && b <= 0xbf;
+            if (lead == 0xf4)
+                return b >= 0x80 && b <= 0x8f;
+        }
+
+        return (b & 0xc0) == 0x80;
+    }
+}
+
+//**********************************************************************************************************************
+TextDecoder::TextDecoder(Encoding encoding) :
+    _encoding(encoding),
+    _pending(),
+    _pendingLen(0)
+{}
+
+//**********************************************************************************************************************
+TextDecoder::Encoding TextDecoder::encoding() const
+{
+    return _encoding;
+}
+
+//**********************************************************************************************************************
+void TextDecoder::setEncoding(Encoding encoding)
+{
+    _encoding = encoding;
+    reset();
+}
+
+//**********************************************************************************************************************
+void TextDecoder::decode(const char *data, int len, QString &out)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+
+    if (_pendingLen > 0)
+    {
+        // Finish the held back sequence with the first bytes of data
+        uchar buffer[2 * MAX_SEQUENCE_LEN];
+        int take = qMin(len, MAX_SEQUENCE_LEN);
+        std::memcpy(buffer, _pending, _pendingLen);
+        std::memcpy(buffer + _pendingLen, bytes, take);
+
+        int n = _pendingLen + take;
+        int done = decodeSome(buffer, n, false, out);
+        if (done == 0)
+        {
+            // Still incomplete, so all of data was taken
+            std::memcpy(_pending, buffer, n);
+            _pendingLen = n;
+            return;
+        }
+
+        // The held back bytes were a valid start, so they were all decoded
+        bytes += done - _pendingLen;
+        len -= done - _pendingLen;
+        _pendingLen = 0;
+    }
+
+    int done = decodeSome(bytes, len, false, out);
+    _pendingLen = len - done;
+    std::memcpy(_pending, bytes + done, _pendingLen);
+}
+
+//**********************************************************************************************************************
+void TextDecoder::flush(QString &out)
+{
+    if (_pendingLen > 0)
+        decodeSome(_pending, _pendingLen, true, out);
+
+    _pendingLen = 0;
+}
+
+//**********************************************************************************************************************
+void TextDecoder::reset()
+{
+    _pendingLen = 0;
+}
+
+//**********************************************************************************************************************
+QString TextDecoder::toText(const char *data, int len, Encoding encoding)
+{
+    QString text;
+    text.reserve(len);
+
+    TextDecoder(encoding).decodeSome(reinterpret_cast<const uchar *>(data), len, true, text);
+
+    return text;
+}
+
+//**********************************************************************************************************************
+int TextDecoder::wholeLength(const char *data, int len)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+
+    // Only the last MAX_SEQUENCE_LEN - 1 bytes can belong to an unfinished sequence
+    for (int i = len - 1; i >= 0 && i >= len - (MAX_SEQUENCE_LEN - 1); --i)
+    {
+        if ((bytes[i] & 0xc0) != 0x80)
+            return sequenceLength(bytes[i]) > len - i ? i : len;
+    }
+
+    return len;
+}
+
+//**********************************************************************************************************************
+int TextDecoder::plainRun(const char *data, int len)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i del = _mm_set1_epi8(0x7f);
+
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+
+        // Signed compare: bytes from 0x80 up are negative, so they are below space too
+        __m128i special = _mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, del));
+
+        int mask = _mm_movemask_epi8(special);
+        if (mask != 0)
+            return i + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+#endif
+
+    const Tables &t = tables();
+    while (i < len && t.plain[static_cast<uchar>(data[i])])
+        ++i;
+
+    return i;
+}
+
+//**********************************************************************************************************************
+int TextDecoder::decodeSome(const uchar *data, int len, bool final, QString &out) const
+{
+    const Tables &t = tables();
+    const QString *ascii = t.ascii;
+    const QString *hex = t.hex;
+
+    int i = 0;
+    while (i < len)
+    {
+        int run = plainRun(reinterpret_cast<const char *>(data + i), len - i);
+        if (run > 0)
+        {
+            out.append(QLatin1String(reinterpret_cast<const char *>(data + i), run));
+            i += run;
+            if (i == len)
+                break;
+        }
+
+        uchar b = data[i];
+        if (b < 0x80)
+        {
+            out.append(ascii[b]);
+            ++i;
+        }
+        else if (_encoding == Encoding::LATIN1 && b >= 0xa0)
+        {
+            out.append(QChar(b));
+            ++i;
+        }
+        else if (_encoding != Encoding::UTF8)
+        {
+            // C1 controls in Latin-1, anything past ASCII when raw
+            out.append(hex[b]);
+            ++i;
+        }
+        else
+        {
+            int need = sequenceLength(b);
+            int k = 1;
+            while (k < need && i + k < len && continues(b, k, data[i + k]))
+                ++k;
+
+            if (need > 0 && k == need)
+            {
+                uint cp = b & (0x7fu >> need);
+                for (int j = 1; j < need; ++j)
+                    cp = (cp << 6) | (data[i + j] & 0x3fu);
+
+                if (cp < 0xa0)
+                {
+                    // C1 control
+                    out.append(hex[b]);
+                    out.append(hex[data[i + 1]]);
+                }
+                else if (cp >= 0x10000)
+                {
+                    out.append(QChar(QChar::highSurrogate(cp)));
+                    out.append(QChar(QChar::lowSurrogate(cp)));
+                }
+                else
+                {
+                    out.append(QChar(static_cast<ushort>(cp)));
+                }
+
+                i += need;
+            }
+            else if (need > 0 && i + k == len && !final)
+            {
+                break; // Completed by the next call
+            }
+            else
+            {
+                // One replacement for the lead byte and whatever valid continuation followed it
+                out.append(QChar(QChar::ReplacementCharacter));
+                i += k;
+            }
+        }
+    }
+
+    return i;
+}
@@ -0,0 +1,79 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef TEXTDECODER_H
+#define TEXTDECODER_H
+
+#include <QString>
+
+//**********************************************************************************************************************
+// Streaming decoder from received bytes to text for views that draw it themselves (TerminalItem).
+//
+// Bytes are decoded as UTF-8, Latin-1 or raw ASCII. Control bytes are shown from a lookup table in caret notation
+// (^@, ^[, ...) and bytes that are not text in the encoding as \xHH, so NULs and terminal control codes never reach the
+// view; tab, CR and LF are kept. A UTF-8 sequence cut off at the end
+// of the input is held back and completed by the next decode(). Runs of printable ASCII, nearly all typical traffic,
+// are found 16 bytes at a time and copied as they are.
+class TextDecoder
+{
+public:
+    enum class Encoding
+    {
+        UTF8,
+        LATIN1,
+        RAW     // ASCII only; all other bytes in hex
+    };
+
+    explicit TextDecoder(Encoding encoding = Encoding::UTF8);
+
+    Encoding encoding() const;
+    void setEncoding(Encoding encoding); // Also drops a held back sequence
+
+    // Appends data to out; a trailing incomplete UTF-8 sequence is held back for the next call
+    void decode(const char *data, int len, QString &out);
+    void flush(QString &out); // Ends the input; a held back sequence is shown as U+FFFD
+    void reset();
+
+    // Decodes a complete piece of data
+    static QString toText(const char *data, int len, Encoding encoding);
+
+    // Length of the longest prefix of data that does not end inside a UTF-8 sequence
+    static int wholeLength(const char *data, int len);
+
+    // Length of the leading run of bytes shown as they are: printable ASCII
+    static int plainRun(const char *data, int len);
+
+private:
+    static const int MAX_SEQUENCE_LEN = 4;
+
+    // Returns the number of bytes decoded; less than len only if final is false and data ends in an incomplete
+    // UTF-8 sequence
+    int decodeSome(const uchar *data, int len, bool final, QString &out) const;
+
+    Encoding _encoding;
+    uchar _pending[MAX_SEQUENCE_LEN];
+    int _pendingLen;
+};
+
+#endif // TEXTDECODER_H
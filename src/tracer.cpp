@@ -0,0 +1,279 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "tracer.h"
+
+#include <QThread>
+#include <QFile>
+#include <QByteArray>
+#include <QMutexLocker>
+#include <QtDebug>
+
+#include <chrono>
+
+//**********************************************************************************************************************
+struct Tracer::ThreadBuffer
+{
+    QByteArray threadName;
+    int tid;
+    bool inUse;  // By a running thread; otherwise free for the next one
+    std::atomic<quint64> written;
+    Event events[EVENTS_PER_THREAD];
+};
+
+//**********************************************************************************************************************
+// Gives a thread's buffer back when the thread exits
+struct Tracer::ThreadOwner
+{
+    ThreadBuffer *buffer = nullptr;
+
+    ~ThreadOwner()
+    {
+        if (buffer == nullptr)
+            return;
+
+        Tracer *tracer = instance();
+        QMutexLocker lock(&tracer->_mutex);
+        buffer->inUse = false;
+    }
+};
+
+std::atomic<bool> Tracer::_enabled(false);
+
+namespace
+{
+    thread_local qint64 renderStart = -1;
+}
+
+//**********************************************************************************************************************
+Tracer::Tracer(QObject *parent) :
+    QObject(parent),
+    _mutex(),
+    _buffers(),
+    _names()
+{}
+
+//**********************************************************************************************************************
+Tracer::~Tracer()
+{
+    _enabled = false;
+
+    qDeleteAll(_buffers);
+}
+
+//**********************************************************************************************************************
+Tracer *Tracer::instance()
+{
+    static Tracer tracer;
+    return &tracer;
+}
+
+//**********************************************************************************************************************
+qint64 Tracer::now()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//**********************************************************************************************************************
+void Tracer::record(const char *name, qint64 start, qint64 end, qint64 arg)
+{
+    if (!isEnabled())
+        return;
+
+    ThreadBuffer *buffer = threadBuffer();
+    quint64 idx = buffer->written.load(std::memory_order_relaxed);
+    buffer->events[idx % EVENTS_PER_THREAD] = { name, start, end, arg };
+    buffer->written.store(idx + 1, std::memory_order_release);
+}
+
+//**********************************************************************************************************************
+bool Tracer::start()
+{
+#ifdef YATERM_NO_TRACE
+    return false;
+#else
+    QMutexLocker lock(&_mutex);
+    foreach (ThreadBuffer *buffer, _buffers)
+    {
+        buffer->written = 0;
+    }
+
+    _enabled = true;
+
+    return true;
+#endif
+}
+
+//**********************************************************************************************************************
+void Tracer::stop()
+{
+    _enabled = false;
+}
+
+//**********************************************************************************************************************
+bool Tracer::writeChromeTrace(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qWarning() << "Could not open trace file" << fileName << ":" << file.errorString();
+        return false;
+    }
+
+    QMutexLocker lock(&_mutex);
+
+    QByteArray json("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    foreach (const ThreadBuffer *buffer, _buffers)
+    {
+        if (!first)
+            json.append(",\n");
+        first = false;
+
+        json.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + QByteArray::number(buffer->tid) +
+                    ",\"args\":{\"name\":\"" + buffer->threadName + "\"}}");
+
+        quint64 written = buffer->written.load(std::memory_order_acquire);
+        quint64 begin = written > EVENTS_PER_THREAD ? written - EVENTS_PER_THREAD : 0;
+        for (quint64 i = begin; i < written; ++i)
+        {
+            const Event &e = buffer->events[i % EVENTS_PER_THREAD];
+
+            json.append(",\n{\"name\":\"");
+            json.append(e.name);
+            json.append("\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+            json.append(QByteArray::number(buffer->tid));
+            json.append(",\"ts\":");
+            json.append(QByteArray::number(e.start / 1000.0, 'f', 3));
+            json.append(",\"dur\":");
+            json.append(QByteArray::number((e.end - e.start) / 1000.0, 'f', 3));
+            if (e.arg >= 0)
+            {
+                json.append(",\"args\":{\"bytes\":");
+                json.append(QByteArray::number(e.arg));
+                json.append("}");
+            }
+            json.append("}");
+        }
+
+        // Keep memory bounded for large traces
+        if (json.size() > 1024 * 1024)
+        {
+            file.write(json);
+            json.clear();
+        }
+    }
+    json.append("\n]}\n");
+
+    file.write(json);
+
+    return file.error() == QFile::NoError;
+}
+
+//**********************************************************************************************************************
+double Tracer::begin() const
+{
+    return isEnabled() ? static_cast<double>(now()) : -1.0;
+}
+
+//**********************************************************************************************************************
+void Tracer::end(const QString &name, double start)
+{
+    if (start < 0 || !isEnabled())
+        return;
+
+    record(intern(name), static_cast<qint64>(start), now());
+}
+
+//**********************************************************************************************************************
+void Tracer::renderBegin()
+{
+    renderStart = isEnabled() ? now() : -1;
+}
+
+//**********************************************************************************************************************
+void Tracer::renderEnd()
+{
+    if (renderStart >= 0)
+        record("render+swap", renderStart, now());
+
+    renderStart = -1;
+}
+
+//**********************************************************************************************************************
+Tracer::ThreadBuffer *Tracer::threadBuffer()
+{
+    thread_local ThreadOwner owner;
+    if (owner.buffer == nullptr)
+    {
+        Tracer *tracer = instance();
+        QMutexLocker lock(&tracer->_mutex);
+
+        // Reuse the buffer of a thread that has exited (its spans go) before making a new one
+        ThreadBuffer *buffer = nullptr;
+        foreach (ThreadBuffer *free, tracer->_buffers)
+        {
+            if (!free->inUse)
+            {
+                buffer = free;
+                break;
+            }
+        }
+
+        if (buffer == nullptr)
+        {
+            buffer = new ThreadBuffer();
+            buffer->tid = tracer->_buffers.size() + 1;
+            tracer->_buffers << buffer;
+        }
+
+        buffer->inUse = true;
+        buffer->threadName = QThread::currentThread()->objectName().toUtf8();
+        if (buffer->threadName.isEmpty())
+            buffer->threadName = "Thread " + QByteArray::number(buffer->tid);
+        buffer->written = 0;
+
+        owner.buffer = buffer;
+    }
+
+    return owner.buffer;
+}
+
+//**********************************************************************************************************************
+const char *Tracer::intern(const QString &name)
+{
+    // Names from QML are few and long lived; keep one copy of each so events can refer to it
+    QByteArray utf8 = name.toUtf8().replace('\\', "\\\\").replace('"', "\\\"");
+
+    QMutexLocker lock(&_mutex);
+    int idx = _names.indexOf(utf8);
+    if (idx < 0)
+    {
+        _names << utf8;
+        idx = _names.size() - 1;
+    }
+
+    return _names.at(idx).constData();
+}
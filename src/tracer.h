@@ -0,0 +1,135 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QMutex>
+
+#include <atomic>
+
+//**********************************************************************************************************************
+// Lightweight span tracing for the receive/display pipeline.
+//
+// Spans are recorded into a fixed-size ring buffer per thread (no locks or allocation once a thread has recorded its
+// first span) and can be dumped as Chrome trace-event JSON for chrome://tracing or Perfetto. Recording is off until
+// start() is called; a disabled span costs one relaxed atomic load. Build with CONFIG+=notrace (YATERM_NO_TRACE) to
+// compile the TRACE_* markers out entirely.
+//
+// A thread's buffer outlives the thread, so its spans can still be written out, and goes to the next thread that
+// starts tracing. Memory is bounded by the threads alive at once rather than every session's I/O thread ever opened.
+class Tracer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static Tracer *instance();
+    ~Tracer();
+
+    static bool isEnabled()
+    {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+
+    static qint64 now(); // Monotonic nanoseconds
+    static void record(const char *name, qint64 start, qint64 end, qint64 arg = -1);
+
+    bool start();
+    void stop();
+    bool writeChromeTrace(const QString &fileName) const;
+
+    // For QML handlers: var t = tracer.begin(); ...; tracer.end("name", t)
+    Q_INVOKABLE double begin() const;
+    Q_INVOKABLE void end(const QString &name, double start);
+
+public slots:
+    // Connected directly to QQuickWindow::beforeRendering() and frameSwapped() on the render thread
+    void renderBegin();
+    void renderEnd();
+
+private:
+    static const int EVENTS_PER_THREAD = 64 * 1024;
+
+    struct Event
+    {
+        const char *name;
+        qint64 start;
+        qint64 end;
+        qint64 arg;
+    };
+
+    struct ThreadBuffer;
+    struct ThreadOwner;
+
+    explicit Tracer(QObject *parent = nullptr);
+    static ThreadBuffer *threadBuffer();
+    const char *intern(const QString &name);
+
+    static std::atomic<bool> _enabled;
+
+    mutable QMutex _mutex; // Guards thread registration and interned names only
+    QList<ThreadBuffer *> _buffers;
+    QList<QByteArray> _names;
+};
+
+//**********************************************************************************************************************
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char *name) :
+        _name(name),
+        _start(Tracer::isEnabled() ? Tracer::now() : -1),
+        _arg(-1)
+    {}
+
+    ~TraceSpan()
+    {
+        if (_start >= 0)
+            Tracer::record(_name, _start, Tracer::now(), _arg);
+    }
+
+    void setArg(qint64 arg)
+    {
+        _arg = arg;
+    }
+
+private:
+    const char *_name;
+    qint64 _start;
+    qint64 _arg;
+};
+
+//**********************************************************************************************************************
+#ifndef YATERM_NO_TRACE
+#define TRACE_SPAN(name) TraceSpan traceSpan(name)
+#define TRACE_SPAN_ARG(arg) traceSpan.setArg(arg)
+#else
+#define TRACE_SPAN(name) (void)0
+#define TRACE_SPAN_ARG(arg) (void)0
+#endif
+
+#endif // TRACER_H
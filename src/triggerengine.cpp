@@ -0,0 +1,170 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#include "triggerengine.h"
+#include "tracer.h"
+
+//**********************************************************************************************************************
+TriggerEngine::TriggerEngine() :
+    _triggers(),
+    _framer(),
+    _ends(),
+    _frame()
+{
+    _frame.reserve(MAX_FRAME_BYTES);
+}
+
+//**********************************************************************************************************************
+void TriggerEngine::setTriggers(const QList<Trigger> &triggers)
+{
+    _triggers.clear();
+    _triggers.reserve(triggers.size());
+
+    foreach (const Trigger &trigger, triggers)
+    {
+        Compiled c;
+        c.trigger = trigger;
+        c.fired = false;
+
+        if (trigger.isRegex)
+        {
+            c.regex.setPattern(trigger.pattern);
+            c.regex.optimize();
+        }
+        else
+        {
+            c.literal.setPattern(trigger.pattern.toLatin1());
+        }
+
+        if (trigger.action == Trigger::Action::SEND)
+            c.response = trigger.argument.toLatin1();
+
+        _triggers.append(c);
+    }
+}
+
+//**********************************************************************************************************************
+void TriggerEngine::setDelimiters(const QList<QByteArray> &delimiters)
+{
+    _framer.setDelimiters(delimiters);
+}
+
+//**********************************************************************************************************************
+bool TriggerEngine::isEmpty() const
+{
+    return _triggers.isEmpty();
+}
+
+//**********************************************************************************************************************
+const Trigger &TriggerEngine::trigger(int i) const
+{
+    return _triggers.at(i).trigger;
+}
+
+//**********************************************************************************************************************
+const QByteArray &TriggerEngine::response(int i) const
+{
+    return _triggers.at(i).response;
+}
+
+//**********************************************************************************************************************
+void TriggerEngine::feed(const QByteArray &data, QVector<Match> &matches)
+{
+    TRACE_SPAN("TriggerEngine::feed");
+
+    _framer.scan(data, _ends);
+
+    int pos = 0;
+    foreach (int end, _ends)
+    {
+        append(data.constData() + pos, end - pos, matches);
+        endFrame();
+        pos = end;
+    }
+
+    append(data.constData() + pos, data.size() - pos, matches);
+}
+
+//**********************************************************************************************************************
+void TriggerEngine::reset()
+{
+    _framer.reset();
+    endFrame();
+}
+
+//**********************************************************************************************************************
+void TriggerEngine::append(const char *data, int len, QVector<Match> &matches)
+{
+    while (len > 0)
+    {
+        int n = qMin(len, MAX_FRAME_BYTES - _frame.size());
+        int oldSize = _frame.size();
+        _frame.append(data, n);
+        data += n;
+        len -= n;
+
+        QString text; // Regex subject, converted only if needed
+        for (int i = 0; i < _triggers.size(); ++i)
+        {
+            Compiled &c = _triggers[i];
+            if (c.fired)
+                continue;
+
+            if (c.trigger.isRegex)
+            {
+                if (text.isNull())
+                    text = QString::fromLatin1(_frame);
+
+                QRegularExpressionMatch m = c.regex.match(text);
+                if (m.hasMatch())
+                {
+                    c.fired = true;
+                    matches.append({ i, m.captured().toLatin1() });
+                }
+            }
+            else
+            {
+                // Only matches that end in the new bytes are left to find
+                int patternLen = c.literal.pattern().size();
+                if (patternLen > 0 && c.literal.indexIn(_frame, qMax(0, oldSize - patternLen + 1)) >= 0)
+                {
+                    c.fired = true;
+                    matches.append({ i, c.literal.pattern() });
+                }
+            }
+        }
+
+        if (_frame.size() >= MAX_FRAME_BYTES)
+            endFrame();
+    }
+}
+
+//**********************************************************************************************************************
+void TriggerEngine::endFrame()
+{
+    _frame.resize(0); // Keeps the capacity
+
+    for (int i = 0; i < _triggers.size(); ++i)
+        _triggers[i].fired = false;
+}
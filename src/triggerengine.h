@@ -0,0 +1,106 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+#ifndef TRIGGERENGINE_H
+#define TRIGGERENGINE_H
+
+#include "eomframer.h"
+
+#include <QByteArray>
+#include <QByteArrayMatcher>
+#include <QList>
+#include <QMetaType>
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+//**********************************************************************************************************************
+struct Trigger
+{
+    enum class Action
+    {
+        SEND,    // Send argument as is
+        COMMAND, // Run argument as if it was entered
+        MARK     // Highlight the match in the output
+    };
+
+    QString name;
+    QString pattern; // Literal text or, if isRegex, a regular expression; both match received bytes as Latin-1
+    bool isRegex = false;
+    Action action = Action::MARK;
+    QString argument;
+};
+
+Q_DECLARE_METATYPE(Trigger)
+
+//**********************************************************************************************************************
+// Matches triggers against the received stream, frame by frame.
+//
+// Patterns are compiled once when set. Received data is framed with the receive-side EOMs and every trigger is checked
+// against the frame as it grows, so a prompt that is never terminated (e.g. "Hit any key to stop autoboot") fires as
+// soon as it is complete. A trigger fires at most once per frame. Frames are cut at MAX_FRAME_BYTES like they are for
+// display.
+class TriggerEngine
+{
+public:
+    static const int MAX_FRAME_BYTES = 4096;
+
+    struct Match
+    {
+        int trigger;
+        QByteArray text;
+    };
+
+    TriggerEngine();
+
+    void setTriggers(const QList<Trigger> &triggers);
+    void setDelimiters(const QList<QByteArray> &delimiters);
+    bool isEmpty() const;
+    const Trigger &trigger(int i) const;
+    const QByteArray &response(int i) const; // Bytes to send for a SEND trigger
+
+    // Appends a match to matches for every trigger that fires on data
+    void feed(const QByteArray &data, QVector<Match> &matches);
+    void reset();
+
+private:
+    struct Compiled
+    {
+        Trigger trigger;
+        QByteArrayMatcher literal;
+        QRegularExpression regex;
+        QByteArray response;
+        bool fired; // In the current frame
+    };
+
+    void append(const char *data, int len, QVector<Match> &matches);
+    void endFrame();
+
+    QVector<Compiled> _triggers;
+    EomFramer _framer;
+    QVector<int> _ends;
+    QByteArray _frame; // Current frame so far
+};
+
+#endif // TRIGGERENGINE_H
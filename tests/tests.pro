@@ -0,0 +1,4 @@
+TEMPLATE = subdirs
+
+# Need openpty()
+linux: SUBDIRS += tst_pipeline
@@ -0,0 +1,620 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2014 Wesley Graba
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+******************************************************************************/
+
+// QtTest cases for the framing, command and write paths: correctness with randomized chunking, then QBENCHMARK
+// timings of the same paths so an optimization of them is both verified and measured.
+//
+//  * modifyDspText(READ_MESSAGE, ...) framing by EOM length and chunk size, including EOMs split between chunks
+//  * CommandParser::processCommand() dispatch
+//  * SimpleTerminal::write() SOM/EOM framing, through a pseudo-terminal so the transmitted bytes can be checked
+
+#include "simpleterminal.h"
+#include "commandparser.h"
+#include "scrollbackmodel.h"
+
+#include <QtTest>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QLoggingCategory>
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace
+{
+    //******************************************************************************************************************
+    quint32 nextRandom(quint32 &seed)
+    {
+        seed = seed * 1103515245 + 12345;
+        return seed >> 16;
+    }
+
+    //******************************************************************************************************************
+    // Printable lines of 1-160 bytes, each ended by the next of eoms in turn. frames gets each line with its EOM.
+    QByteArray makeTraffic(int bytes, const QByteArrayList &eoms, quint32 seed, QByteArrayList &frames)
+    {
+        QByteArray data;
+        data.reserve(bytes + 256);
+        frames.clear();
+
+        while (data.size() < bytes)
+        {
+            QByteArray frame;
+            int len = 1 + static_cast<int>(nextRandom(seed) % 160);
+            for (int i = 0; i < len; ++i)
+                frame.append(static_cast<char>(' ' + nextRandom(seed) % 95));
+
+            frame.append(eoms.at(frames.size() % eoms.size()));
+            data.append(frame);
+            frames << frame;
+        }
+
+        return data;
+    }
+
+    //******************************************************************************************************************
+    QStringList split(const QByteArray &data, int chunkSize)
+    {
+        QStringList chunks;
+        for (int pos = 0; pos < data.size(); pos += chunkSize)
+            chunks << QString::fromLatin1(data.mid(pos, chunkSize));
+
+        return chunks;
+    }
+
+    //******************************************************************************************************************
+    QStringList splitRandomly(const QByteArray &data, int maxChunkSize, quint32 seed)
+    {
+        QStringList chunks;
+        int pos = 0;
+        while (pos < data.size())
+        {
+            int len = 1 + static_cast<int>(nextRandom(seed) % static_cast<quint32>(maxChunkSize));
+            chunks << QString::fromLatin1(data.mid(pos, len));
+            pos += len;
+        }
+
+        return chunks;
+    }
+
+    //******************************************************************************************************************
+    // Cut one byte into every EOM of two bytes or more, and right before every one-byte EOM
+    QStringList splitInEoms(const QByteArrayList &frames, const QByteArrayList &eoms)
+    {
+        QStringList chunks;
+        QByteArray pending;
+        for (int i = 0; i < frames.size(); ++i)
+        {
+            const QByteArray &frame = frames.at(i);
+            int eomLen = eoms.at(i % eoms.size()).size();
+            int cut = frame.size() - eomLen + (eomLen > 1 ? 1 : 0);
+
+            pending += frame.left(cut);
+            chunks << QString::fromLatin1(pending);
+            pending = frame.mid(cut);
+        }
+
+        if (!pending.isEmpty())
+            chunks << QString::fromLatin1(pending);
+
+        return chunks;
+    }
+
+    //******************************************************************************************************************
+    QStringList toStrings(const QByteArrayList &eoms)
+    {
+        QStringList strings;
+        for (const QByteArray &eom : eoms)
+            strings << QString::fromLatin1(eom);
+
+        return strings;
+    }
+
+    //******************************************************************************************************************
+    QByteArrayList framesOf(const ScrollbackModel &model, ScrollbackModel::FrameType type)
+    {
+        QByteArrayList frames;
+        for (int row = 0; row < model.rowCount(); ++row)
+        {
+            if (model.frameType(row) == type)
+                frames << model.frameData(row);
+        }
+
+        return frames;
+    }
+
+    //******************************************************************************************************************
+    bool waitFor(const std::function<bool()> &done, int msecs)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        while (!done())
+        {
+            if (timer.elapsed() > msecs)
+                return false;
+
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        }
+
+        return true;
+    }
+}
+
+//**********************************************************************************************************************
+class TstPipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    TstPipeline();
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void readFraming_data();
+    void readFraming();
+    void readEomSplit_data();
+    void readEomSplit();
+    void benchRead_data();
+    void benchRead();
+
+    void commands();
+    void benchCommand_data();
+    void benchCommand();
+
+    void writeFraming_data();
+    void writeFraming();
+    void benchWrite_data();
+    void benchWrite();
+
+private:
+    static const int WRITE_BATCH = 256; // Stay well inside the transmit queue
+
+    void addEomRows();
+    void addSomEomRows();
+    QByteArray takeTransmitted();
+    bool waitTransmitted(int bytes);
+
+    SimpleTerminal *_terminal;
+
+    // Master side of the pseudo-terminal the terminal is connected to, and what it has transmitted so far
+    int _master;
+    int _slave;
+    std::thread _reader;
+    std::atomic<bool> _stopReader;
+    std::mutex _transmittedLock;
+    QByteArray _transmitted;
+    std::atomic<int> _transmittedSize;
+};
+
+//**********************************************************************************************************************
+TstPipeline::TstPipeline() :
+    _terminal(nullptr),
+    _master(-1),
+    _slave(-1),
+    _reader(),
+    _stopReader(false),
+    _transmittedLock(),
+    _transmitted(),
+    _transmittedSize(0)
+{}
+
+//**********************************************************************************************************************
+void TstPipeline::initTestCase()
+{
+    // Keep away from the real application's settings
+    QCoreApplication::setOrganizationName("No Org");
+    QCoreApplication::setOrganizationDomain("noorg.org");
+    QCoreApplication::setApplicationName("yaTerm-tst_pipeline");
+
+    // Command tracing would dominate the command timings
+    QLoggingCategory::setFilterRules("default.debug=false");
+
+    _terminal = new SimpleTerminal;
+    _terminal->setMaxScrollbackBytes(ScrollbackModel::DEFAULT_MAX_BYTES);
+    _terminal->setSOM();
+    _terminal->setEOM();
+    _terminal->setRxEOM();
+
+    char slaveName[256];
+    struct termios tio;
+    std::memset(&tio, 0, sizeof(tio));
+    cfmakeraw(&tio);
+    QVERIFY2(openpty(&_master, &_slave, slaveName, &tio, nullptr) == 0, std::strerror(errno));
+
+    _reader = std::thread([this]() {
+        char buffer[65536];
+        while (!_stopReader)
+        {
+            struct pollfd pfd = { _master, POLLIN, 0 };
+            if (poll(&pfd, 1, 50) <= 0)
+                continue;
+
+            ssize_t n = ::read(_master, buffer, sizeof(buffer));
+            if (n > 0)
+            {
+                std::lock_guard<std::mutex> lock(_transmittedLock);
+                _transmitted.append(buffer, static_cast<int>(n));
+                _transmittedSize.store(_transmitted.size());
+            }
+        }
+    });
+
+    _terminal->setPort(QString::fromLocal8Bit(slaveName));
+    _terminal->connect();
+    QVERIFY(waitFor([this]() { return _terminal->isConnected(); }, 5000));
+}
+
+//**********************************************************************************************************************
+void TstPipeline::cleanupTestCase()
+{
+    if (_terminal)
+    {
+        _terminal->disconnect();
+        waitFor([this]() { return !_terminal->isConnected(); }, 5000);
+    }
+
+    _stopReader = true;
+    if (_reader.joinable())
+        _reader.join();
+
+    delete _terminal;
+    _terminal = nullptr;
+
+    if (_slave >= 0)
+        ::close(_slave);
+    if (_master >= 0)
+        ::close(_master);
+}
+
+//**********************************************************************************************************************
+void TstPipeline::addEomRows()
+{
+    QTest::addColumn<QByteArrayList>("eoms");
+
+    QTest::newRow("CR") << QByteArrayList({ "\r" });
+    QTest::newRow("CR+LF") << QByteArrayList({ "\r\n" });
+    QTest::newRow("CR+LF x2") << QByteArrayList({ "\r\n\r\n" });
+    QTest::newRow("CR|LF|CR+LF") << QByteArrayList({ "\r", "\n", "\r\n" });
+}
+
+//**********************************************************************************************************************
+void TstPipeline::readFraming_data()
+{
+    addEomRows();
+}
+
+//**********************************************************************************************************************
+void TstPipeline::readFraming()
+{
+    QFETCH(QByteArrayList, eoms);
+
+    const int ROUNDS = 16;
+
+    _terminal->setRxEOM(toStrings(eoms));
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        QByteArrayList frames;
+        QByteArray traffic = makeTraffic(64 * 1024, eoms, 1000 + round, frames);
+
+        _terminal->clearDisplay();
+        for (const QString &chunk : splitRandomly(traffic, 1 + round * 4, 2000 + round))
+            _terminal->modifyDspText(SimpleTerminal::DspType::READ_MESSAGE, chunk);
+        _terminal->flushDisplay();
+
+        const ScrollbackModel &model = *_terminal->scrollback();
+        QCOMPARE(framesOf(model, ScrollbackModel::FrameType::RECEIVED), frames);
+        for (int row = 1; row < model.rowCount(); ++row)
+            QVERIFY(model.frameTimestamp(row) >= model.frameTimestamp(row - 1));
+    }
+
+    _terminal->setRxEOM();
+    _terminal->clearDisplay();
+}
+
+//**********************************************************************************************************************
+void TstPipeline::readEomSplit_data()
+{
+    addEomRows();
+}
+
+//**********************************************************************************************************************
+void TstPipeline::readEomSplit()
+{
+    QFETCH(QByteArrayList, eoms);
+
+    QByteArrayList frames;
+    makeTraffic(64 * 1024, eoms, 4242, frames);
+
+    _terminal->setRxEOM(toStrings(eoms));
+    _terminal->clearDisplay();
+    for (const QString &chunk : splitInEoms(frames, eoms))
+        _terminal->modifyDspText(SimpleTerminal::DspType::READ_MESSAGE, chunk);
+    _terminal->flushDisplay();
+
+    QCOMPARE(framesOf(*_terminal->scrollback(), ScrollbackModel::FrameType::RECEIVED), frames);
+
+    _terminal->setRxEOM();
+    _terminal->clearDisplay();
+}
+
+//**********************************************************************************************************************
+void TstPipeline::benchRead_data()
+{
+    QTest::addColumn<QByteArrayList>("eoms");
+    QTest::addColumn<int>("chunkSize");
+
+    const QList<QPair<const char *, QByteArrayList>> eomCases = {
+        { "CR", { "\r" } },
+        { "CR+LF", { "\r\n" } },
+        { "CR+LF x2", { "\r\n\r\n" } },
+        { "CR|LF|CR+LF", { "\r", "\n", "\r\n" } },
+    };
+
+    // 3 and 7 byte chunks split most multi-byte EOMs between chunks
+    for (const QPair<const char *, QByteArrayList> &eomCase : eomCases)
+    {
+        for (int chunkSize : { 3, 7, 16, 256, 4096 })
+        {
+            QString name = QString("%1, %2 B").arg(eomCase.first).arg(chunkSize);
+            QTest::newRow(qPrintable(name)) << eomCase.second << chunkSize;
+        }
+    }
+}
+
+//**********************************************************************************************************************
+void TstPipeline::benchRead()
+{
+    QFETCH(QByteArrayList, eoms);
+    QFETCH(int, chunkSize);
+
+    QByteArrayList frames;
+    QStringList chunks = split(makeTraffic(1024 * 1024, eoms, 12345, frames), chunkSize);
+
+    _terminal->setRxEOM(toStrings(eoms));
+    QBENCHMARK
+    {
+        _terminal->clearDisplay();
+        for (const QString &chunk : chunks)
+            _terminal->modifyDspText(SimpleTerminal::DspType::READ_MESSAGE, chunk);
+        _terminal->flushDisplay();
+    }
+
+    QCOMPARE(_terminal->scrollback()->rowCount(), frames.size());
+
+    _terminal->setRxEOM();
+    _terminal->clearDisplay();
+}
+
+//**********************************************************************************************************************
+void TstPipeline::commands()
+{
+    CommandParser parser(*_terminal);
+
+    parser.processCommand("/som >");
+    QCOMPARE(_terminal->getSOM(), QString(">"));
+    parser.processCommand("/rxeom \\r \\x0a");
+    QCOMPARE(_terminal->getRxEOM(), QStringList({ "\r", "\n" }));
+    parser.processCommand("/flushrate 30");
+    QCOMPARE(_terminal->maxFlushRate(), 30);
+    parser.processCommand("/som  \"> \"");
+    QCOMPARE(_terminal->getSOM(), QString("> "));
+
+    QStringList tokens;
+    QVERIFY(CommandParser::tokenize("a  \"b \\\" c\" 'd e' \"\"", tokens));
+    QCOMPARE(tokens, QStringList({ "a", "b \" c", "d e", "" }));
+    QVERIFY(!CommandParser::tokenize("\"open", tokens));
+
+    _terminal->clearDisplay();
+    parser.processCommand("/nosuchcommand");
+    _terminal->flushDisplay();
+    const ScrollbackModel &model = *_terminal->scrollback();
+    QCOMPARE(model.rowCount(), 2);
+    QVERIFY(model.frameType(1) == ScrollbackModel::FrameType::ERROR);
+    QVERIFY(model.frameData(1).contains("Invalid command"));
+
+    _terminal->setSOM();
+    _terminal->setRxEOM();
+    _terminal->setMaxFlushRate(DisplayBatcher::DEFAULT_MAX_FLUSH_RATE);
+    _terminal->clearDisplay();
+}
+
+//**********************************************************************************************************************
+void TstPipeline::benchCommand_data()
+{
+    QTest::addColumn<QString>("command");
+
+    for (const char *command : { "/som >", "/som \"> \"", "/rxeom \\r \\n", "/flushrate 60", "/hex off", "/help /som",
+                                 "/nosuchcommand" })
+        QTest::newRow(command) << QString(command);
+}
+
+//**********************************************************************************************************************
+void TstPipeline::benchCommand()
+{
+    QFETCH(QString, command);
+
+    const int CALLS = 1000;
+
+    CommandParser parser(*_terminal);
+    _terminal->clearDisplay();
+    QBENCHMARK
+    {
+        for (int i = 0; i < CALLS; ++i)
+            parser.processCommand(command);
+    }
+
+    _terminal->setSOM();
+    _terminal->setRxEOM();
+    _terminal->setMaxFlushRate(DisplayBatcher::DEFAULT_MAX_FLUSH_RATE);
+    _terminal->setHexMode(false);
+    _terminal->clearDisplay();
+}
+
+//**********************************************************************************************************************
+void TstPipeline::addSomEomRows()
+{
+    QTest::addColumn<QString>("som");
+    QTest::addColumn<QString>("eom");
+
+    QTest::newRow("none") << QString() << QString();
+    QTest::newRow("< CR+LF") << QString("<") << QString("\r\n");
+    QTest::newRow("STX ETX") << QString("\x02") << QString("\x03");
+    QTest::newRow("long") << QString("@@>") << QString("\r\n\r\n");
+}
+
+//**********************************************************************************************************************
+QByteArray TstPipeline::takeTransmitted()
+{
+    std::lock_guard<std::mutex> lock(_transmittedLock);
+    QByteArray data = _transmitted;
+    _transmitted.clear();
+    _transmittedSize.store(0);
+
+    return data;
+}
+
+//**********************************************************************************************************************
+bool TstPipeline::waitTransmitted(int bytes)
+{
+    return waitFor([&]() { return _transmittedSize.load() >= bytes; }, 5000);
+}
+
+//**********************************************************************************************************************
+void TstPipeline::writeFraming_data()
+{
+    addSomEomRows();
+}
+
+//**********************************************************************************************************************
+void TstPipeline::writeFraming()
+{
+    QFETCH(QString, som);
+    QFETCH(QString, eom);
+
+    const int MESSAGES = 2000;
+
+    _terminal->setSOM(som);
+    _terminal->setEOM(eom);
+    _terminal->clearDisplay();
+    takeTransmitted();
+
+    // Random messages in batches of random size, each batch let out before the next
+    QByteArrayList expected;
+    QByteArray expectedBytes;
+    quint32 seed = 777;
+    int sent = 0;
+    while (sent < MESSAGES)
+    {
+        int batch = 1 + static_cast<int>(nextRandom(seed) % WRITE_BATCH);
+        for (int i = 0; i < batch && sent < MESSAGES; ++i, ++sent)
+        {
+            QString msg;
+            int len = 1 + static_cast<int>(nextRandom(seed) % 64);
+            for (int j = 0; j < len; ++j)
+                msg.append(QChar(static_cast<char>('0' + nextRandom(seed) % 75)));
+
+            _terminal->parseInput(msg);
+            expected << (som + msg + eom).toLatin1();
+            expectedBytes += expected.last();
+        }
+
+        QVERIFY(waitTransmitted(expectedBytes.size()));
+    }
+    _terminal->flushDisplay();
+
+    QCOMPARE(takeTransmitted(), expectedBytes);
+    QCOMPARE(framesOf(*_terminal->scrollback(), ScrollbackModel::FrameType::SENT), expected);
+    QCOMPARE(framesOf(*_terminal->scrollback(), ScrollbackModel::FrameType::ERROR), QByteArrayList());
+
+    _terminal->setSOM();
+    _terminal->setEOM();
+    _terminal->clearDisplay();
+}
+
+//**********************************************************************************************************************
+void TstPipeline::benchWrite_data()
+{
+    addSomEomRows();
+}
+
+//**********************************************************************************************************************
+void TstPipeline::benchWrite()
+{
+    QFETCH(QString, som);
+    QFETCH(QString, eom);
+
+    QStringList messages;
+    int bytes = 0;
+    quint32 seed = 4242;
+    for (int i = 0; i < WRITE_BATCH; ++i)
+    {
+        QString msg;
+        int len = 1 + static_cast<int>(nextRandom(seed) % 64);
+        for (int j = 0; j < len; ++j)
+            msg.append(QChar(static_cast<char>('0' + nextRandom(seed) % 75)));
+
+        messages << msg;
+        bytes += som.size() + msg.size() + eom.size();
+    }
+
+    _terminal->setSOM(som);
+    _terminal->setEOM(eom);
+    takeTransmitted();
+
+    // One batch framed, queued and out of the port per iteration
+    QBENCHMARK
+    {
+        _terminal->clearDisplay();
+        for (const QString &msg : messages)
+            _terminal->parseInput(msg);
+
+        QVERIFY(waitTransmitted(bytes));
+        takeTransmitted();
+    }
+
+    _terminal->setSOM();
+    _terminal->setEOM();
+    _terminal->clearDisplay();
+}
+
+QTEST_GUILESS_MAIN(TstPipeline)
+
+#include "tst_pipeline.moc"
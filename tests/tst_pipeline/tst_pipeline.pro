@@ -0,0 +1,13 @@
+TEMPLATE = app
+TARGET = tst_pipeline
+
+QT += testlib
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+include(../../src/core.pri)
+
+LIBS += -lutil
+
+SOURCES += \
+    tst_pipeline.cpp